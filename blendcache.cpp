@@ -0,0 +1,240 @@
+#include "blendcache.hpp"
+#include "texturestorage.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+namespace myopengl {
+
+	namespace {
+
+		// Capas reservadas la primera vez; crece al doble al llenarse
+		const int InitialCapacity = 4;
+
+	}
+
+	bool BlendKey::operator==(const BlendKey& other) const
+	{
+		return std::memcmp(layers, other.layers, sizeof(layers)) == 0 &&
+			std::memcmp(weights, other.weights, sizeof(weights)) == 0;
+	}
+
+	size_t BlendCache::KeyHash::operator()(const BlendKey& key) const
+	{
+		size_t hash = 0;
+		for (int i = 0; i < 3; i++) {
+			uint32_t bits;
+			std::memcpy(&bits, &key.weights[i], sizeof(bits));
+			hash = hash * 31 + std::hash<int>()(key.layers[i]);
+			hash = hash * 31 + std::hash<uint32_t>()(bits);
+		}
+		return hash;
+	}
+
+	BlendKey makeBlendKey(const int layers[3], const float ratios[3])
+	{
+		BlendKey key;
+		float total = ratios[0] + ratios[1] + ratios[2];
+		for (int i = 0; i < 3; i++) {
+			float weight = total > 0.0f ? ratios[i] * ratios[i] / total : 0.0f;
+			key.layers[i] = weight > 0.0f ? layers[i] : 0;
+			// Sin -0.0f, que compara igual pero tiene otros bits en el hash
+			key.weights[i] = weight > 0.0f ? weight : 0.0f;
+		}
+		return key;
+	}
+
+	BlendCache::BlendCache(int maxCapacity)
+		: m_MaxCapacity(std::max(maxCapacity, 1))
+	{
+	}
+
+	bool BlendCache::setProgram(const char* vertexSource, const char* fragmentSource)
+	{
+		std::unique_ptr<Program> program(new Program());
+		if (!program->build(vertexSource, fragmentSource)) {
+			std::cout << "Blend cache: bake program failed to build" << std::endl;
+			return false;
+		}
+		m_Program = std::move(program);
+		m_SourcesUniform = m_Program->uniform<int>("sources");
+		m_LayersUniform = m_Program->uniform<int>("layers");
+		m_WeightsUniform = m_Program->uniform<glm::vec4>("weights");
+		m_LevelUniform = m_Program->uniform<int>("level");
+		invalidate();
+		return true;
+	}
+
+	void BlendCache::setSource(GLuint sourceArray, int width, int height)
+	{
+		if (width != m_Width || height != m_Height) {
+			// Las capas cocinadas tienen el tamaño del origen
+			if (m_Texture)
+				glDeleteTextures(1, &m_Texture);
+			m_Texture = 0;
+			m_Entries.clear();
+			m_Index.clear();
+			m_Width = width;
+			m_Height = height;
+			m_Levels = mipLevelCount(width, height);
+		}
+		if (sourceArray != m_Source) {
+			m_Source = sourceArray;
+			invalidate();
+		}
+	}
+
+	void BlendCache::invalidate()
+	{
+		for (Entry& entry : m_Entries)
+			entry.dirty = entry.used;
+		m_Pending = !m_Index.empty();
+	}
+
+	void BlendCache::allocate(int capacity)
+	{
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		allocateTextureStorage3D(GL_TEXTURE_2D_ARRAY, m_Levels, GL_RGBA8, m_Width, m_Height, capacity);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		// El contenido no se copia: las mezclas que ya había se cocinan otra vez
+		if (m_Texture)
+			glDeleteTextures(1, &m_Texture);
+		m_Texture = texture;
+		m_Entries.resize(capacity);
+		invalidate();
+	}
+
+	int BlendCache::get(const BlendKey& key)
+	{
+		if (!m_Program || !m_Source || m_Width <= 0 || m_Height <= 0)
+			return -1;
+
+		std::unordered_map<BlendKey, int, KeyHash>::const_iterator found = m_Index.find(key);
+		if (found != m_Index.end()) {
+			m_Entries[found->second].lastUsed = m_Frame;
+			return found->second;
+		}
+
+		if (!m_Texture)
+			allocate(std::min(InitialCapacity, m_MaxCapacity));
+
+		// Una capa libre, o la mezcla usada hace más tiempo que no se haya pedido este frame
+		int layer = -1;
+		for (int i = 0; i < (int)m_Entries.size(); i++) {
+			const Entry& entry = m_Entries[i];
+			if (!entry.used) {
+				layer = i;
+				break;
+			}
+			if (entry.lastUsed < m_Frame && (layer < 0 || entry.lastUsed < m_Entries[layer].lastUsed))
+				layer = i;
+		}
+		if (layer < 0) {
+			int capacity = (int)m_Entries.size();
+			if (capacity >= m_MaxCapacity)
+				return -1;
+			allocate(std::min(capacity * 2, m_MaxCapacity));
+			layer = capacity;
+		}
+
+		Entry& entry = m_Entries[layer];
+		if (entry.used)
+			m_Index.erase(entry.key);
+		entry.key = key;
+		entry.lastUsed = m_Frame;
+		entry.used = true;
+		entry.dirty = true;
+		m_Index[key] = layer;
+		m_Pending = true;
+		return layer;
+	}
+
+	void BlendCache::flush()
+	{
+		if (!m_Pending || !m_Program || !m_Texture)
+			return;
+		m_Pending = false;
+
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point start = Clock::now();
+
+		if (!m_Framebuffer)
+			glGenFramebuffers(1, &m_Framebuffer);
+		if (!m_VertexArray)
+			glGenVertexArrays(1, &m_VertexArray);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_Texture, 0, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Blend cache: framebuffer incomplete, nothing baked" << std::endl;
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			return;
+		}
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		// Triángulo que cubre el viewport, generado con gl_VertexID
+		glBindVertexArray(m_VertexArray);
+		m_Program->use();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_Source);
+		m_Program->set(m_SourcesUniform, 0);
+
+		int baked = 0;
+		for (int layer = 0; layer < (int)m_Entries.size(); layer++) {
+			Entry& entry = m_Entries[layer];
+			if (!entry.dirty)
+				continue;
+			entry.dirty = false;
+
+			m_Program->set(m_LayersUniform, entry.key.layers, 3);
+			m_Program->set(m_WeightsUniform, glm::vec4(entry.key.weights[0], entry.key.weights[1], entry.key.weights[2], 0.0f));
+			for (int level = 0; level < m_Levels; level++) {
+				glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_Texture, level, layer);
+				glViewport(0, 0, std::max(1, m_Width >> level), std::max(1, m_Height >> level));
+				m_Program->set(m_LevelUniform, level);
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+			}
+			baked++;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glBindVertexArray(0);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+		m_Bakes += baked;
+		m_LastBakeMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	void BlendCache::destroy()
+	{
+		if (m_Texture)
+			glDeleteTextures(1, &m_Texture);
+		if (m_Framebuffer)
+			glDeleteFramebuffers(1, &m_Framebuffer);
+		if (m_VertexArray)
+			glDeleteVertexArrays(1, &m_VertexArray);
+		m_Texture = 0;
+		m_Framebuffer = 0;
+		m_VertexArray = 0;
+		m_Program.reset();
+		m_Entries.clear();
+		m_Index.clear();
+	}
+
+	BlendCacheStats BlendCache::stats() const
+	{
+		BlendCacheStats stats;
+		stats.entries = (int)m_Index.size();
+		stats.capacity = (int)m_Entries.size();
+		stats.bakes = m_Bakes;
+		stats.lastBakeMilliseconds = m_LastBakeMilliseconds;
+		return stats;
+	}
+
+}
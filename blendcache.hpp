@@ -0,0 +1,99 @@
+#pragma once
+#include "shader.hpp"
+#include <GL/glew.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace myopengl {
+
+	// Mezcla de hasta tres capas del array de origen con sus pesos finales
+	struct BlendKey {
+		int layers[3] = { 0, 0, 0 };
+		float weights[3] = { 0.0f, 0.0f, 0.0f };
+
+		bool operator==(const BlendKey& other) const;
+	};
+
+	// Clave con los pesos que usan los shaders de multitextura: ratio * ratio / suma de
+	// ratios (0 si la suma es 0). Las capas con peso 0 se dejan en 0 para que las
+	// mezclas que solo se diferencian en ellas compartan capa.
+	BlendKey makeBlendKey(const int layers[3], const float ratios[3]);
+
+	struct BlendCacheStats {
+		int entries = 0;      // capas con una mezcla
+		int capacity = 0;     // capas reservadas
+		int bakes = 0;        // capas cocinadas, acumuladas desde el principio
+		double lastBakeMilliseconds = 0.0;  // CPU del último flush() que cocinó algo
+	};
+
+	// Mezclas de multitextura cocinadas, cada una en una capa de un GL_TEXTURE_2D_ARRAY
+	// RGBA8 del tamaño del array de origen. Cada nivel de mip se cocina a partir del
+	// mismo nivel de las capas de origen: la mezcla es lineal, así que el resultado es el
+	// que daba mezclar en el fragment shader, con una sola muestra en vez de tres. Solo se
+	// vuelve a cocinar al pedir una mezcla nueva o tras invalidate(). Cuando no quedan
+	// capas libres se reutiliza la mezcla usada hace más tiempo (nunca una pedida este
+	// frame) y si hace falta se reserva el doble de capas, hasta maxCapacity.
+	class BlendCache {
+	public:
+		explicit BlendCache(int maxCapacity = 64);
+		BlendCache(const BlendCache&) = delete;
+		BlendCache& operator=(const BlendCache&) = delete;
+
+		// Shaders del cocinado; si no compilan se conserva el programa anterior y devuelve false
+		bool setProgram(const char* vertexSource, const char* fragmentSource);
+		// Array con las capas a mezclar (cadena de mips completa). Si cambia el tamaño se
+		// reserva de nuevo y se vuelve a cocinar todo.
+		void setSource(GLuint sourceArray, int width, int height);
+		// El contenido del origen ha cambiado: se cocina todo otra vez en el siguiente flush()
+		void invalidate();
+
+		// Frame nuevo: las mezclas que no se pidan en él se pueden sustituir
+		void beginFrame() { m_Frame++; }
+		// Capa de texture() con la mezcla, o -1 si no hay sitio, origen o programa. La capa
+		// tiene contenido después del siguiente flush().
+		int get(const BlendKey& key);
+		// Cocina las capas pendientes. Necesita el contexto de GL; deja enlazados el
+		// framebuffer 0 y el VAO 0 y restaura el viewport.
+		void flush();
+		// Necesita el contexto de GL todavía vivo
+		void destroy();
+
+		GLuint texture() const { return m_Texture; }
+		BlendCacheStats stats() const;
+
+	private:
+		struct Entry {
+			BlendKey key;
+			uint64_t lastUsed = 0;
+			bool used = false;
+			bool dirty = false;
+		};
+
+		struct KeyHash {
+			size_t operator()(const BlendKey& key) const;
+		};
+
+		void allocate(int capacity);
+
+		int m_MaxCapacity;
+		std::unique_ptr<Program> m_Program;
+		Uniform<int> m_SourcesUniform;
+		Uniform<int> m_LayersUniform;
+		Uniform<glm::vec4> m_WeightsUniform;
+		Uniform<int> m_LevelUniform;
+		GLuint m_Source = 0;
+		int m_Width = 0, m_Height = 0, m_Levels = 0;
+		GLuint m_Texture = 0;
+		GLuint m_Framebuffer = 0;
+		GLuint m_VertexArray = 0;
+		std::vector<Entry> m_Entries;  // una por capa
+		std::unordered_map<BlendKey, int, KeyHash> m_Index;
+		uint64_t m_Frame = 1;
+		bool m_Pending = false;
+		int m_Bakes = 0;
+		double m_LastBakeMilliseconds = 0.0;
+	};
+
+}
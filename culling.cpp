@@ -0,0 +1,132 @@
+#include "culling.hpp"
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULLING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_SSE
+#endif
+
+namespace myopengl {
+
+	Frustum extractFrustum(const glm::mat4& viewProjection)
+	{
+		const glm::mat4& m = viewProjection;
+		// Filas de la matriz (glm guarda columnas)
+		glm::vec4 row[4];
+		for (int i = 0; i < 4; i++)
+			row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+		Frustum frustum;
+		frustum.planes[0] = row[3] + row[0]; // izquierda
+		frustum.planes[1] = row[3] - row[0]; // derecha
+		frustum.planes[2] = row[3] + row[1]; // abajo
+		frustum.planes[3] = row[3] - row[1]; // arriba
+		frustum.planes[4] = row[3] + row[2]; // near
+		frustum.planes[5] = row[3] - row[2]; // far
+
+		for (glm::vec4& plane : frustum.planes) {
+			float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+			plane = plane / length;
+		}
+		return frustum;
+	}
+
+	void BoundingSpheres::resize(size_t count)
+	{
+		m_X.resize(count);
+		m_Y.resize(count);
+		m_Z.resize(count);
+		m_Radius.resize(count);
+	}
+
+	static bool sphereVisible(const Frustum& frustum, float x, float y, float z, float radius)
+	{
+		for (const glm::vec4& plane : frustum.planes) {
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible)
+	{
+		size_t count = spheres.size();
+		const float* xs = spheres.x();
+		const float* ys = spheres.y();
+		const float* zs = spheres.z();
+		const float* radii = spheres.radius();
+
+		visible.resize(count);
+		uint32_t* out = visible.data();
+		size_t i = 0;
+
+#if defined(CULLING_AVX)
+		// Un plano por iteración contra 8 esferas; la máscara acumula los que siguen dentro
+		__m256 planes[6][4];
+		for (int p = 0; p < 6; p++)
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+
+		for (; i + 8 <= count; i += 8) {
+			__m256 x = _mm256_loadu_ps(xs + i);
+			__m256 y = _mm256_loadu_ps(ys + i);
+			__m256 z = _mm256_loadu_ps(zs + i);
+			__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radii + i));
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(planes[p][0], x), _mm256_mul_ps(planes[p][1], y)),
+					_mm256_add_ps(_mm256_mul_ps(planes[p][2], z), planes[p][3]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+			}
+
+			int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; lane < 8; lane++) {
+				*out = (uint32_t)(i + lane);
+				out += (mask >> lane) & 1;
+			}
+		}
+#elif defined(CULLING_SSE)
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; p++)
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+
+		for (; i + 4 <= count; i += 4) {
+			__m128 x = _mm_loadu_ps(xs + i);
+			__m128 y = _mm_loadu_ps(ys + i);
+			__m128 z = _mm_loadu_ps(zs + i);
+			__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radii + i));
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+					_mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; lane++) {
+				*out = (uint32_t)(i + lane);
+				out += (mask >> lane) & 1;
+			}
+		}
+#endif
+
+		// Resto (o todo, sin SIMD)
+		for (; i < count; i++) {
+			*out = (uint32_t)i;
+			out += sphereVisible(frustum, xs[i], ys[i], zs[i], radii[i]) ? 1 : 0;
+		}
+
+		size_t visibleCount = (size_t)(out - visible.data());
+		visible.resize(visibleCount);
+		return visibleCount;
+	}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace myopengl {
+
+	// Planos del frustum (a, b, c, d) normalizados, con la normal hacia dentro
+	struct Frustum {
+		glm::vec4 planes[6];
+	};
+
+	// Extrae los planos de projection * View (Gribb/Hartmann)
+	Frustum extractFrustum(const glm::mat4& viewProjection);
+
+	// Esferas envolventes en SoA: cada componente en su propio array para poder
+	// cargar 4 (SSE) u 8 (AVX) objetos de una vez
+	class BoundingSpheres {
+	public:
+		void resize(size_t count);
+		size_t size() const { return m_Radius.size(); }
+
+		void set(size_t index, const glm::vec3& center, float radius)
+		{
+			m_X[index] = center.x;
+			m_Y[index] = center.y;
+			m_Z[index] = center.z;
+			m_Radius[index] = radius;
+		}
+
+		const float* x() const { return m_X.data(); }
+		const float* y() const { return m_Y.data(); }
+		const float* z() const { return m_Z.data(); }
+		const float* radius() const { return m_Radius.data(); }
+
+	private:
+		std::vector<float> m_X, m_Y, m_Z, m_Radius;
+	};
+
+	// Deja en visible los índices de las esferas que tocan el frustum, en orden.
+	// Devuelve cuántas son visibles.
+	size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible);
+
+}
@@ -0,0 +1,127 @@
+#include "filewatcher.hpp"
+#include <algorithm>
+#include <iostream>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace myopengl {
+
+#if defined(__linux__)
+
+	FileWatcher::FileWatcher(std::chrono::milliseconds pollInterval)
+		: m_PollInterval(pollInterval)
+	{
+		m_Descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_Descriptor < 0)
+			std::cout << "File watcher: inotify_init1 failed: " << std::strerror(errno) << std::endl;
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+		if (m_Descriptor >= 0)
+			close(m_Descriptor);
+	}
+
+	bool FileWatcher::watch(const std::string& directory)
+	{
+		if (m_Descriptor < 0)
+			return false;
+		int watch = inotify_add_watch(m_Descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch < 0) {
+			std::cout << "File watcher: cannot watch " << directory << ": " << std::strerror(errno) << std::endl;
+			return false;
+		}
+		m_Directories[watch] = directory;
+		return true;
+	}
+
+	std::vector<std::string> FileWatcher::poll()
+	{
+		std::vector<std::string> changed;
+		if (m_Descriptor < 0)
+			return changed;
+
+		alignas(inotify_event) char buffer[4096];
+		for (;;) {
+			ssize_t length = read(m_Descriptor, buffer, sizeof(buffer));
+			if (length <= 0)
+				break;
+			for (char* p = buffer; p < buffer + length;) {
+				const inotify_event* event = (const inotify_event*)p;
+				p += sizeof(inotify_event) + event->len;
+
+				std::unordered_map<int, std::string>::const_iterator directory = m_Directories.find(event->wd);
+				if (directory == m_Directories.end() || event->len == 0 || (event->mask & IN_ISDIR))
+					continue;
+				std::string path = directory->second + "/" + event->name;
+				if (std::find(changed.begin(), changed.end(), path) == changed.end())
+					changed.push_back(path);
+			}
+		}
+		return changed;
+	}
+
+#else
+
+	FileWatcher::FileWatcher(std::chrono::milliseconds pollInterval)
+		: m_LastPoll(std::chrono::steady_clock::now()), m_PollInterval(pollInterval)
+	{
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+	}
+
+	bool FileWatcher::watch(const std::string& directory)
+	{
+		std::error_code error;
+		if (!std::filesystem::is_directory(directory, error)) {
+			std::cout << "File watcher: cannot watch " << directory << std::endl;
+			return false;
+		}
+		Directory watched;
+		watched.path = directory;
+		scan(watched, nullptr);
+		m_Directories.push_back(watched);
+		return true;
+	}
+
+	void FileWatcher::scan(Directory& directory, std::vector<std::string>* changed)
+	{
+		std::error_code error;
+		for (std::filesystem::directory_iterator it(directory.path, error), end; !error && it != end; it.increment(error)) {
+			if (!it->is_regular_file(error))
+				continue;
+			std::filesystem::file_time_type time = it->last_write_time(error);
+			if (error)
+				continue;
+			std::string path = directory.path + "/" + it->path().filename().string();
+			auto found = directory.times.find(path);
+			if (found == directory.times.end() || found->second != time) {
+				directory.times[path] = time;
+				if (changed)
+					changed->push_back(path);
+			}
+		}
+	}
+
+	std::vector<std::string> FileWatcher::poll()
+	{
+		std::vector<std::string> changed;
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - m_LastPoll < m_PollInterval)
+			return changed;
+		m_LastPoll = now;
+		for (Directory& directory : m_Directories)
+			scan(directory, &changed);
+		return changed;
+	}
+
+#endif
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace myopengl {
+
+	// Ficheros modificados dentro de directorios vigilados (sin recursión). En Linux usa
+	// inotify (escrituras cerradas y renombrados, que es como guardan muchos editores);
+	// en el resto compara la fecha de modificación como mucho cada pollInterval.
+	class FileWatcher {
+	public:
+		explicit FileWatcher(std::chrono::milliseconds pollInterval = std::chrono::milliseconds(250));
+		~FileWatcher();
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		bool watch(const std::string& directory);
+
+		// Rutas ("directorio/nombre") cambiadas desde la llamada anterior, sin repetidos.
+		// No bloquea; se llama una vez por frame.
+		std::vector<std::string> poll();
+
+	private:
+#if defined(__linux__)
+		int m_Descriptor = -1;
+		std::unordered_map<int, std::string> m_Directories;
+#else
+		struct Directory {
+			std::string path;
+			std::unordered_map<std::string, std::filesystem::file_time_type> times;
+		};
+
+		void scan(Directory& directory, std::vector<std::string>* changed);
+
+		std::vector<Directory> m_Directories;
+		std::chrono::steady_clock::time_point m_LastPoll;
+#endif
+		std::chrono::milliseconds m_PollInterval;
+	};
+
+}
@@ -0,0 +1,95 @@
+#include "framescheduler.hpp"
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+namespace myopengl {
+
+	FrameScheduler::FrameScheduler(double updateRate, int maxUpdatesPerFrame)
+		: m_FixedDelta(1.0 / updateRate), m_MaxUpdates(maxUpdatesPerFrame)
+	{
+#ifdef _WIN32
+		// Por defecto Sleep() tiene una granularidad de ~15.6 ms
+		timeBeginPeriod(1);
+#endif
+		m_LastFrame = Clock::now();
+		m_NextFrame = m_LastFrame;
+		m_CounterStart = m_LastFrame;
+	}
+
+	FrameScheduler::~FrameScheduler()
+	{
+#ifdef _WIN32
+		timeEndPeriod(1);
+#endif
+	}
+
+	void FrameScheduler::setFrameLimit(double framesPerSecond)
+	{
+		m_FrameLimit = framesPerSecond > 0.0 ? framesPerSecond : 0.0;
+		m_NextFrame = Clock::now();
+	}
+
+	int FrameScheduler::beginFrame()
+	{
+		Clock::time_point now = Clock::now();
+		m_FrameDelta = std::chrono::duration<double>(now - m_LastFrame).count();
+		m_LastFrame = now;
+
+		m_Accumulator += m_FrameDelta;
+		int steps = 0;
+		while (m_Accumulator >= m_FixedDelta && steps < m_MaxUpdates) {
+			m_Accumulator -= m_FixedDelta;
+			steps++;
+		}
+		if (m_Accumulator >= m_FixedDelta)
+			m_Accumulator = 0.0;
+
+		m_Updates += steps;
+		m_Frames++;
+		if (now - m_CounterStart >= std::chrono::seconds(1)) {
+			m_UpdatesPerSecond = m_Updates;
+			m_FramesPerSecond = m_Frames;
+			m_Updates = 0;
+			m_Frames = 0;
+			m_CounterStart = now;
+		}
+		return steps;
+	}
+
+	void FrameScheduler::endFrame()
+	{
+		if (m_FrameLimit <= 0.0)
+			return;
+
+		// El objetivo avanza un periodo exacto cada frame para no acumular deriva; si
+		// vamos tarde se reinicia desde ahora
+		Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_FrameLimit));
+		m_NextFrame += period;
+		Clock::time_point now = Clock::now();
+		if (m_NextFrame < now) {
+			m_NextFrame = now;
+			return;
+		}
+		sleepUntil(m_NextFrame);
+	}
+
+	void FrameScheduler::sleepUntil(Clock::time_point target)
+	{
+		// Dormir casi todo el tiempo y terminar con una espera activa corta, porque
+		// sleep_for puede despertar hasta un tick del planificador tarde
+		const Clock::duration spinMargin = std::chrono::microseconds(1500);
+		Clock::time_point now = Clock::now();
+		if (target - now > spinMargin)
+			std::this_thread::sleep_for(target - now - spinMargin);
+		while (Clock::now() < target)
+			std::this_thread::yield();
+	}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <chrono>
+
+namespace myopengl {
+
+	// Reloj del loop principal: la simulación avanza en pasos fijos de 1 / updateRate
+	// segundos y el render interpola entre los dos últimos pasos. Opcionalmente limita
+	// los FPS durmiendo hasta el siguiente frame en lugar de girar en vacío.
+	class FrameScheduler {
+	public:
+		explicit FrameScheduler(double updateRate = 60.0, int maxUpdatesPerFrame = 5);
+		~FrameScheduler();
+		FrameScheduler(const FrameScheduler&) = delete;
+		FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+		// 0 desactiva el límite
+		void setFrameLimit(double framesPerSecond);
+		double frameLimit() const { return m_FrameLimit; }
+
+		// Al empezar el frame: cuántos pasos fijos hay que simular. Si el frame tardó
+		// demasiado se descarta el tiempo sobrante en vez de acumular retraso.
+		int beginFrame();
+		// Al terminar el frame: espera hasta el momento del siguiente si hay límite
+		void endFrame();
+
+		double fixedDelta() const { return m_FixedDelta; }
+		// Fracción del siguiente paso ya transcurrida, para interpolar el estado [0, 1)
+		float alpha() const { return (float)(m_Accumulator / m_FixedDelta); }
+		// Tiempo real del último frame en segundos
+		double frameDelta() const { return m_FrameDelta; }
+
+		// Contadores del último segundo completo
+		int updatesPerSecond() const { return m_UpdatesPerSecond; }
+		int framesPerSecond() const { return m_FramesPerSecond; }
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		void sleepUntil(Clock::time_point target);
+
+		double m_FixedDelta;
+		int m_MaxUpdates;
+		double m_FrameLimit = 0.0;
+		double m_Accumulator = 0.0;
+		double m_FrameDelta = 0.0;
+
+		Clock::time_point m_LastFrame;
+		Clock::time_point m_NextFrame;
+		Clock::time_point m_CounterStart;
+		int m_Updates = 0, m_Frames = 0;
+		int m_UpdatesPerSecond = 0, m_FramesPerSecond = 0;
+	};
+
+}
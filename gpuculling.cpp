@@ -0,0 +1,269 @@
+#include "gpuculling.hpp"
+#include "culling.hpp"
+#include "texturestorage.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace myopengl {
+
+	namespace {
+
+		// Tamaño de grupo de los dos compute shaders
+		const GLuint CullGroupSize = 64;
+		const GLuint PyramidGroupSize = 8;
+
+	}
+
+	GpuCuller::GpuCuller(GLuint transformsBinding, GLuint outputBinding)
+		: m_TransformsBinding(transformsBinding), m_OutputBinding(outputBinding)
+	{
+	}
+
+	bool GpuCuller::supported()
+	{
+		return GLEW_VERSION_4_3 != 0;
+	}
+
+	bool GpuCuller::drawCountSupported()
+	{
+		return GLEW_ARB_indirect_parameters != 0;
+	}
+
+	bool GpuCuller::setPrograms(const char* cullSource, const char* pyramidSource)
+	{
+		std::unique_ptr<Program> cull(new Program());
+		std::unique_ptr<Program> pyramid(new Program());
+		if (!cull->buildCompute(cullSource) || !pyramid->buildCompute(pyramidSource)) {
+			std::cout << "GPU culling: compute programs failed to build" << std::endl;
+			return false;
+		}
+
+		m_CullProgram = std::move(cull);
+		m_PyramidProgram = std::move(pyramid);
+		m_CullProgram->bindStorageBlock("DrawTransforms", m_TransformsBinding);
+		m_CullProgram->bindStorageBlock("CulledCommands", m_OutputBinding);
+		m_CullProgram->bindStorageBlock("CulledRecords", m_OutputBinding + 1);
+		m_ObjectCountUniform = m_CullProgram->uniform<int>("objectCount");
+		m_FrustumCullingUniform = m_CullProgram->uniform<int>("frustumCulling");
+		m_FrustumUniform = m_CullProgram->uniform<glm::vec4>("frustumPlanes");
+		m_MeshCountUniform = m_CullProgram->uniform<int>("meshCount");
+		m_MeshFirstIndexUniform = m_CullProgram->uniform<int>("meshFirstIndex");
+		m_MeshBaseVertexUniform = m_CullProgram->uniform<int>("meshBaseVertex");
+		m_MeshExtentsUniform = m_CullProgram->uniform<glm::vec4>("meshExtents");
+		m_OcclusionUniform = m_CullProgram->uniform<int>("occlusion");
+		m_PyramidViewProjectionUniform = m_CullProgram->uniform<glm::mat4>("pyramidViewProjection");
+		m_SourceLevelUniform = m_PyramidProgram->uniform<int>("sourceLevel");
+		return true;
+	}
+
+	void GpuCuller::reserve(GLuint objectCount)
+	{
+		if (!m_CommandBuffer) {
+			glGenBuffers(1, &m_CommandBuffer);
+			glGenBuffers(1, &m_RecordBuffer);
+			glGenBuffers(1, &m_CounterBuffer);
+			glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_CounterBuffer);
+			glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+			glGenBuffers(ReadbackFrames, m_ReadbackBuffers);
+			for (int i = 0; i < ReadbackFrames; i++) {
+				glBindBuffer(GL_COPY_WRITE_BUFFER, m_ReadbackBuffers[i]);
+				glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), NULL, GL_STREAM_READ);
+			}
+		}
+		if (objectCount <= m_Capacity)
+			return;
+
+		m_Capacity = std::max(objectCount, m_Capacity * 2);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, m_Capacity * sizeof(DrawElementsCommand), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_RecordBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_Capacity * sizeof(DrawRecord), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	void GpuCuller::cull(GLuint objectCount, const MeshRange& mesh, const glm::vec3& meshExtents,
+		const glm::mat4& viewProjection, bool testFrustum, bool occlusion)
+	{
+		m_ObjectCount = 0;
+		if (!m_CullProgram || objectCount == 0)
+			return;
+		reserve(objectCount);
+		m_ObjectCount = objectCount;
+
+		// Contador a cero y, si el número de draws no sale del contador, también los
+		// comandos: los huecos que no llene el shader se dibujan con count 0
+		GLuint zero = 0;
+		glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_CounterBuffer);
+		glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(zero), &zero);
+		if (!drawCountSupported()) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+			glClearBufferSubData(GL_DRAW_INDIRECT_BUFFER, GL_R32UI, 0, objectCount * sizeof(DrawElementsCommand),
+				GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+
+		bool testOcclusion = occlusion && m_PyramidValid;
+		Frustum frustum = extractFrustum(viewProjection);
+		m_CullProgram->use();
+		m_CullProgram->set(m_ObjectCountUniform, (int)objectCount);
+		m_CullProgram->set(m_FrustumCullingUniform, testFrustum ? 1 : 0);
+		m_CullProgram->set(m_FrustumUniform, frustum.planes, 6);
+		m_CullProgram->set(m_MeshCountUniform, (int)mesh.indexCount);
+		m_CullProgram->set(m_MeshFirstIndexUniform, (int)mesh.firstIndex);
+		m_CullProgram->set(m_MeshBaseVertexUniform, mesh.baseVertex);
+		m_CullProgram->set(m_MeshExtentsUniform, glm::vec4(meshExtents, 0.0f));
+		m_CullProgram->set(m_OcclusionUniform, testOcclusion ? 1 : 0);
+		if (testOcclusion) {
+			m_CullProgram->set(m_PyramidViewProjectionUniform, m_PyramidViewProjection);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, m_PyramidTexture);
+		}
+
+		glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, m_CounterBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_OutputBinding, m_CommandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_OutputBinding + 1, m_RecordBuffer);
+		glDispatchCompute((objectCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+		// Los comandos se leen como indirectos, los registros desde el vertex shader y el
+		// contador como parámetro del draw y con la copia de abajo
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT |
+			GL_BUFFER_UPDATE_BARRIER_BIT);
+
+		// El contador se copia ahora y se lee cuando la copia de hace unos frames ha terminado
+		int slot = m_ReadbackFrame % ReadbackFrames;
+		glBindBuffer(GL_COPY_READ_BUFFER, m_CounterBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_ReadbackBuffers[slot]);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(GLuint));
+		if (m_ReadbackFences[slot])
+			glDeleteSync(m_ReadbackFences[slot]);
+		m_ReadbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_ReadbackFrame++;
+
+		int oldest = m_ReadbackFrame % ReadbackFrames;
+		GLsync fence = m_ReadbackFences[oldest];
+		if (fence) {
+			GLenum status = glClientWaitSync(fence, 0, 0);
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+				GLuint visible = 0;
+				glBindBuffer(GL_COPY_WRITE_BUFFER, m_ReadbackBuffers[oldest]);
+				glGetBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(visible), &visible);
+				m_VisibleCount = (int)visible;
+			}
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void GpuCuller::draw(GLenum mode, GLuint recordBinding)
+	{
+		if (m_ObjectCount == 0)
+			return;
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, recordBinding, m_RecordBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+		if (drawCountSupported()) {
+			glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_CounterBuffer);
+			glMultiDrawElementsIndirectCountARB(mode, GL_UNSIGNED_INT, (const void*)0, 0, (GLsizei)m_ObjectCount, 0);
+			glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+		}
+		else {
+			glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (const void*)0, (GLsizei)m_ObjectCount, 0);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	void GpuCuller::allocatePyramid(int width, int height)
+	{
+		if (m_DepthTexture)
+			glDeleteTextures(1, &m_DepthTexture);
+		if (m_PyramidTexture)
+			glDeleteTextures(1, &m_PyramidTexture);
+
+		// Storage inmutable (GL 4.2): completas aunque el sampler de la unidad use mips
+		glGenTextures(1, &m_DepthTexture);
+		glBindTexture(GL_TEXTURE_2D, m_DepthTexture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width, height);
+
+		m_PyramidLevels = mipLevelCount(width, height);
+		glGenTextures(1, &m_PyramidTexture);
+		glBindTexture(GL_TEXTURE_2D, m_PyramidTexture);
+		glTexStorage2D(GL_TEXTURE_2D, m_PyramidLevels, GL_R32F, width, height);
+
+		m_PyramidWidth = width;
+		m_PyramidHeight = height;
+		m_PyramidValid = false;
+	}
+
+	void GpuCuller::updateDepthPyramid(int width, int height, const glm::mat4& viewProjection)
+	{
+		if (!m_PyramidProgram || width <= 0 || height <= 0)
+			return;
+		if (width != m_PyramidWidth || height != m_PyramidHeight)
+			allocatePyramid(width, height);
+
+		// Profundidad del framebuffer por defecto; glCopyTexSubImage convierte el formato
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, m_DepthTexture);
+		glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+		// Nivel 0 copiado de la profundidad y cada nivel siguiente reducido del anterior
+		m_PyramidProgram->use();
+		int levelWidth = width, levelHeight = height;
+		for (int level = 0; level < m_PyramidLevels; level++) {
+			glBindTexture(GL_TEXTURE_2D, level == 0 ? m_DepthTexture : m_PyramidTexture);
+			m_PyramidProgram->set(m_SourceLevelUniform, level == 0 ? 0 : level - 1);
+			glBindImageTexture(0, m_PyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+			glDispatchCompute((levelWidth + PyramidGroupSize - 1) / PyramidGroupSize,
+				(levelHeight + PyramidGroupSize - 1) / PyramidGroupSize, 1);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+			levelWidth = std::max(1, levelWidth / 2);
+			levelHeight = std::max(1, levelHeight / 2);
+		}
+		glBindTexture(GL_TEXTURE_2D, m_PyramidTexture);
+
+		m_PyramidViewProjection = viewProjection;
+		m_PyramidValid = true;
+	}
+
+	void GpuCuller::resetReadback()
+	{
+		for (int i = 0; i < ReadbackFrames; i++) {
+			if (m_ReadbackFences[i])
+				glDeleteSync(m_ReadbackFences[i]);
+			m_ReadbackFences[i] = 0;
+		}
+		m_ReadbackFrame = 0;
+		m_VisibleCount = -1;
+	}
+
+	void GpuCuller::destroy()
+	{
+		if (m_CommandBuffer) {
+			glDeleteBuffers(1, &m_CommandBuffer);
+			glDeleteBuffers(1, &m_RecordBuffer);
+			glDeleteBuffers(1, &m_CounterBuffer);
+			glDeleteBuffers(ReadbackFrames, m_ReadbackBuffers);
+		}
+		resetReadback();
+		for (int i = 0; i < ReadbackFrames; i++)
+			m_ReadbackBuffers[i] = 0;
+		if (m_DepthTexture)
+			glDeleteTextures(1, &m_DepthTexture);
+		if (m_PyramidTexture)
+			glDeleteTextures(1, &m_PyramidTexture);
+		m_CommandBuffer = 0;
+		m_RecordBuffer = 0;
+		m_CounterBuffer = 0;
+		m_Capacity = 0;
+		m_ObjectCount = 0;
+		m_DepthTexture = 0;
+		m_PyramidTexture = 0;
+		m_PyramidWidth = 0;
+		m_PyramidHeight = 0;
+		m_PyramidValid = false;
+		m_CullProgram.reset();
+		m_PyramidProgram.reset();
+	}
+
+}
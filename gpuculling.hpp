@@ -0,0 +1,102 @@
+#pragma once
+#include "indirectdraw.hpp"
+#include "shader.hpp"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+
+namespace myopengl {
+
+	// Culling en un compute shader que escribe directamente los comandos de
+	// glMultiDrawElementsIndirect: un hilo por objeto prueba su esfera contra el frustum
+	// y, si se pide, contra una pirámide de máximos de la profundidad del frame anterior;
+	// los que pasan se compactan al principio del buffer indirecto con un contador
+	// atómico. La CPU no recorre los objetos ni sabe cuántos quedan: con
+	// ARB_indirect_parameters el número de draws lo lee la GPU del propio contador y sin
+	// él se emiten todos los huecos, con los que sobran a cero.
+	// Solo usa GL 4.3 (compute, SSBO, atomic counters e image load/store), así que
+	// funciona también en llvmpipe.
+	class GpuCuller {
+	public:
+		// transformsBinding es donde el llamante enlaza las matrices (mat4 por objeto) antes
+		// de cull(); los comandos y registros de salida usan outputBinding y outputBinding + 1
+		GpuCuller(GLuint transformsBinding, GLuint outputBinding);
+		GpuCuller(const GpuCuller&) = delete;
+		GpuCuller& operator=(const GpuCuller&) = delete;
+
+		static bool supported();
+		// glMultiDrawElementsIndirectCountARB: el número de draws sale del contador
+		static bool drawCountSupported();
+
+		// Shader de culling y de reducción de la pirámide; si no compilan se conservan los
+		// anteriores y devuelve false
+		bool setPrograms(const char* cullSource, const char* pyramidSource);
+
+		// Un comando por objeto visible, todos de la misma malla. meshExtents es el semieje
+		// de la caja de la malla sin escalar. Sin testFrustum solo se prueba la oclusión. Deja
+		// la unidad de textura 0 con la pirámide.
+		void cull(GLuint objectCount, const MeshRange& mesh, const glm::vec3& meshExtents,
+			const glm::mat4& viewProjection, bool testFrustum, bool occlusion);
+		// Dibuja lo que dejó cull() con el VAO y el programa enlazados; los registros
+		// {matriz, material} de cada draw quedan en recordBinding para gl_DrawID
+		void draw(GLenum mode, GLuint recordBinding);
+
+		// Copia la profundidad del framebuffer por defecto (ya dibujado) y reduce la
+		// pirámide para el cull() del frame siguiente. Deja la unidad de textura 0 con la
+		// pirámide y la imagen 0 enlazada.
+		void updateDepthPyramid(int width, int height, const glm::mat4& viewProjection);
+		bool hasDepthPyramid() const { return m_PyramidValid; }
+		// Si deja de actualizarse, la pirámide vieja no debe usarse al volver a activarla
+		void invalidateDepthPyramid() { m_PyramidValid = false; }
+
+		// Draws que pasaron el culling hace unos frames (el contador se lee con retraso
+		// para no esperar a la GPU); -1 hasta que hay un resultado
+		int visibleCount() const { return m_VisibleCount; }
+		// Descarta las lecturas pendientes del contador; visibleCount() vuelve a -1
+		void resetReadback();
+		GLuint commandBuffer() const { return m_CommandBuffer; }
+
+		// Necesita el contexto de GL todavía vivo
+		void destroy();
+
+	private:
+		static const int ReadbackFrames = 3;
+
+		void reserve(GLuint objectCount);
+		void allocatePyramid(int width, int height);
+
+		GLuint m_TransformsBinding;
+		GLuint m_OutputBinding;
+		std::unique_ptr<Program> m_CullProgram;
+		std::unique_ptr<Program> m_PyramidProgram;
+		Uniform<int> m_ObjectCountUniform;
+		Uniform<int> m_FrustumCullingUniform;
+		Uniform<glm::vec4> m_FrustumUniform;
+		Uniform<int> m_MeshCountUniform;
+		Uniform<int> m_MeshFirstIndexUniform;
+		Uniform<int> m_MeshBaseVertexUniform;
+		Uniform<glm::vec4> m_MeshExtentsUniform;
+		Uniform<int> m_OcclusionUniform;
+		Uniform<glm::mat4> m_PyramidViewProjectionUniform;
+		Uniform<int> m_SourceLevelUniform;
+
+		GLuint m_CommandBuffer = 0;
+		GLuint m_RecordBuffer = 0;
+		GLuint m_CounterBuffer = 0;
+		GLuint m_Capacity = 0;
+		GLuint m_ObjectCount = 0;
+
+		// Copias del contador para leerlo ReadbackFrames - 1 frames después
+		GLuint m_ReadbackBuffers[ReadbackFrames] = {};
+		GLsync m_ReadbackFences[ReadbackFrames] = {};
+		int m_ReadbackFrame = 0;
+		int m_VisibleCount = -1;
+
+		GLuint m_DepthTexture = 0;
+		GLuint m_PyramidTexture = 0;
+		int m_PyramidWidth = 0, m_PyramidHeight = 0, m_PyramidLevels = 0;
+		glm::mat4 m_PyramidViewProjection = glm::mat4(1.0f);
+		bool m_PyramidValid = false;
+	};
+
+}
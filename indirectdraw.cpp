@@ -0,0 +1,146 @@
+#include "indirectdraw.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace myopengl {
+
+	bool IndirectDrawList::supported()
+	{
+		return GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_program_interface_query;
+	}
+
+	bool IndirectDrawList::drawParametersSupported()
+	{
+		return GLEW_ARB_shader_draw_parameters != 0;
+	}
+
+	void IndirectDrawList::clear()
+	{
+		// Se conserva la lista anterior para comparar con los draws que se añadan
+		m_Count = 0;
+	}
+
+	void IndirectDrawList::add(const MeshRange& mesh, uint32_t transform, uint32_t material)
+	{
+		DrawElementsCommand command;
+		command.count = mesh.indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = mesh.firstIndex;
+		command.baseVertex = mesh.baseVertex;
+		// Solo lo usa el atributo de índice de draw; con gl_DrawIDARB da igual
+		command.baseInstance = (GLuint)m_Count;
+		DrawRecord record = { transform, material };
+
+		if (m_Count < m_Commands.size()) {
+			if (std::memcmp(&m_Commands[m_Count], &command, sizeof(command)) != 0 ||
+				std::memcmp(&m_Records[m_Count], &record, sizeof(record)) != 0) {
+				m_Commands[m_Count] = command;
+				m_Records[m_Count] = record;
+				m_Dirty = true;
+			}
+		}
+		else {
+			m_Commands.push_back(command);
+			m_Records.push_back(record);
+			m_Dirty = true;
+		}
+		m_Count++;
+	}
+
+	void IndirectDrawList::reserveDrawIds(size_t count)
+	{
+		if (count <= m_DrawIdCapacity && m_DrawIdBuffer)
+			return;
+		size_t capacity = std::max<size_t>(std::max(count, m_DrawIdCapacity * 2), 64);
+		std::vector<GLuint> ids(capacity);
+		for (size_t i = 0; i < capacity; i++)
+			ids[i] = (GLuint)i;
+		if (!m_DrawIdBuffer)
+			glGenBuffers(1, &m_DrawIdBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_DrawIdBuffer);
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+		m_DrawIdCapacity = capacity;
+	}
+
+	void IndirectDrawList::setupDrawIdAttribute(GLuint location)
+	{
+		reserveDrawIds(m_Count);
+		glBindBuffer(GL_ARRAY_BUFFER, m_DrawIdBuffer);
+		glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+		m_UseDrawIds = true;
+	}
+
+	void IndirectDrawList::upload()
+	{
+		if (m_Count < m_Commands.size()) {
+			m_Commands.resize(m_Count);
+			m_Records.resize(m_Count);
+			m_Dirty = true;
+		}
+		if (!m_Dirty)
+			return;
+		m_Dirty = false;
+
+		if (!m_CommandBuffer) {
+			glGenBuffers(1, &m_CommandBuffer);
+			glGenBuffers(1, &m_RecordBuffer);
+		}
+
+		size_t count = m_Commands.size();
+		if (count > m_Capacity) {
+			// Crece al doble para no reservar cada vez que aparece un draw más
+			m_Capacity = std::max(count, m_Capacity * 2);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, m_Capacity * sizeof(DrawElementsCommand), NULL, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_RecordBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, m_Capacity * sizeof(DrawRecord), NULL, GL_DYNAMIC_DRAW);
+		}
+		if (count > 0) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, count * sizeof(DrawElementsCommand), m_Commands.data());
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_RecordBuffer);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(DrawRecord), m_Records.data());
+			m_UploadedBytes += count * (sizeof(DrawElementsCommand) + sizeof(DrawRecord));
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		// El atributo de índice de draw necesita un valor por draw; el VAO apunta al
+		// mismo buffer, así que basta con hacerlo crecer
+		if (m_UseDrawIds)
+			reserveDrawIds(count);
+	}
+
+	void IndirectDrawList::draw(GLenum mode, GLuint recordBinding)
+	{
+		upload();
+		if (m_Commands.empty())
+			return;
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, recordBinding, m_RecordBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+		glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (const void*)0, (GLsizei)m_Commands.size(), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	void IndirectDrawList::destroy()
+	{
+		if (m_CommandBuffer)
+			glDeleteBuffers(1, &m_CommandBuffer);
+		if (m_RecordBuffer)
+			glDeleteBuffers(1, &m_RecordBuffer);
+		if (m_DrawIdBuffer)
+			glDeleteBuffers(1, &m_DrawIdBuffer);
+		m_CommandBuffer = 0;
+		m_RecordBuffer = 0;
+		m_DrawIdBuffer = 0;
+		m_Capacity = 0;
+		m_DrawIdCapacity = 0;
+		m_UseDrawIds = false;
+		m_Commands.clear();
+		m_Records.clear();
+		m_Count = 0;
+		m_Dirty = true;
+	}
+
+}
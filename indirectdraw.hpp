@@ -0,0 +1,85 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace myopengl {
+
+	// Comando de glMultiDrawElementsIndirect; el layout lo fija GL
+	struct DrawElementsCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// Malla dentro de los buffers de vértices e índices compartidos
+	struct MeshRange {
+		GLuint indexCount = 0;
+		GLuint firstIndex = 0;
+		GLint baseVertex = 0;
+	};
+
+	// Lo que el vertex shader lee con gl_DrawID: de dónde sacar la matriz y el material.
+	// Layout std430 de un uvec2.
+	struct DrawRecord {
+		uint32_t transform;
+		uint32_t material;
+	};
+
+	// Lista de draws de la escena en un GL_DRAW_INDIRECT_BUFFER, emitida entera con un
+	// solo glMultiDrawElementsIndirect. Cada draw puede ser una malla distinta y lleva en
+	// un shader storage buffer sus índices de transformación y de material, que el shader
+	// busca con gl_DrawIDARB (ARB_shader_draw_parameters). Sin esa extensión el índice
+	// del draw llega como atributo de instancia: baseInstance = índice del draw y un buffer
+	// 0, 1, 2... con divisor 1 (setupDrawIdAttribute()).
+	// Si la lista no cambia entre frames no se vuelve a subir.
+	class IndirectDrawList {
+	public:
+		// Necesita ARB_multi_draw_indirect y ARB_shader_storage_buffer_object (GL 4.3)
+		static bool supported();
+		static bool drawParametersSupported();
+
+		IndirectDrawList() = default;
+		IndirectDrawList(const IndirectDrawList&) = delete;
+		IndirectDrawList& operator=(const IndirectDrawList&) = delete;
+
+		void clear();
+		void add(const MeshRange& mesh, uint32_t transform, uint32_t material);
+		size_t size() const { return m_Count; }
+
+		// Atributo entero con el índice del draw para el modo sin gl_DrawIDARB; se
+		// configura en el VAO enlazado
+		void setupDrawIdAttribute(GLuint location);
+		// Hace crecer el buffer de índices de draw para draws que no pasan por add(), como
+		// los que escribe GpuCuller con el mismo VAO
+		void reserveDrawIds(size_t count);
+		// Sube la lista si ha cambiado, enlaza los registros en recordBinding y dibuja todo
+		// con el VAO y el programa enlazados. Necesita el contexto de GL.
+		void draw(GLenum mode, GLuint recordBinding);
+		// Necesita el contexto de GL todavía vivo
+		void destroy();
+
+		GLuint commandBuffer() const { return m_CommandBuffer; }
+		GLuint recordBuffer() const { return m_RecordBuffer; }
+		size_t uploadedBytes() const { return m_UploadedBytes; }
+
+	private:
+		void upload();
+
+		std::vector<DrawElementsCommand> m_Commands;
+		std::vector<DrawRecord> m_Records;
+		size_t m_Count = 0;  // draws añadidos desde clear()
+		bool m_Dirty = true;
+		GLuint m_CommandBuffer = 0;
+		GLuint m_RecordBuffer = 0;
+		size_t m_Capacity = 0;  // draws que caben en los dos buffers
+		GLuint m_DrawIdBuffer = 0;
+		size_t m_DrawIdCapacity = 0;
+		bool m_UseDrawIds = false;  // hay un VAO configurado con setupDrawIdAttribute()
+		size_t m_UploadedBytes = 0;
+	};
+
+}
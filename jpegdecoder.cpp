@@ -0,0 +1,1098 @@
+#include "jpegdecoder.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define JPEG_AVX
+#define JPEG_SSE
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JPEG_SSE
+#endif
+
+namespace myopengl {
+
+	namespace {
+
+		std::atomic<int> g_ImageDecoder{ (int)ImageDecoder::Simd };
+
+		// Posición natural de cada coeficiente en orden zigzag. Las 16 entradas extra
+		// absorben los saltos de run de un fichero corrupto sin escribir fuera del bloque.
+		const uint8_t ZigZag[64 + 16] = {
+			0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+			12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+			35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+			58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+			63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+		};
+
+		const int FastBits = 9;
+
+		struct HuffmanTable {
+			uint8_t fast[1 << FastBits];  // índice del símbolo para códigos de hasta FastBits, 255 si no
+			uint16_t code[256];
+			uint8_t values[256];
+			uint8_t size[257];
+			uint32_t maxCode[18];         // primer código que ya no cabe en cada longitud, alineado a 16 bits
+			int delta[17];                // índice del símbolo = código + delta[longitud]
+
+			bool build(const uint8_t counts[16], const uint8_t* symbols)
+			{
+				int k = 0;
+				for (int length = 0; length < 16; length++) {
+					for (int i = 0; i < counts[length]; i++) {
+						if (k >= 256)
+							return false;
+						size[k++] = (uint8_t)(length + 1);
+					}
+				}
+				size[k] = 0;
+				std::memcpy(values, symbols, k);
+
+				unsigned next = 0;
+				k = 0;
+				for (int length = 1; length <= 16; length++) {
+					delta[length] = k - (int)next;
+					while (size[k] == length)
+						code[k++] = (uint16_t)next++;
+					if (next > (1u << length))
+						return false;
+					maxCode[length] = next << (16 - length);
+					next <<= 1;
+				}
+				maxCode[17] = 0xffffffff;
+
+				std::memset(fast, 255, sizeof(fast));
+				for (int i = 0; i < k; i++) {
+					int length = size[i];
+					if (length <= FastBits) {
+						int first = code[i] << (FastBits - length);
+						int count = 1 << (FastBits - length);
+						for (int j = 0; j < count; j++)
+							fast[first + j] = (uint8_t)i;
+					}
+				}
+				return true;
+			}
+		};
+
+		// Lector de bits del segmento entrópico: quita el byte de relleno tras cada 0xFF y
+		// al llegar a un marcador sigue devolviendo ceros sin pasar de él
+		struct BitReader {
+			const uint8_t* p;
+			const uint8_t* end;
+			uint64_t buffer = 0;
+			int bits = 0;
+
+			BitReader(const uint8_t* begin, const uint8_t* finish) : p(begin), end(finish) {}
+
+			void fill()
+			{
+				while (bits <= 56) {
+					uint32_t byte = 0;
+					if (p < end) {
+						byte = *p;
+						if (byte == 0xFF) {
+							if (p + 1 < end && p[1] == 0x00)
+								p += 2;
+							else
+								byte = 0;
+						}
+						else {
+							p++;
+						}
+					}
+					buffer |= (uint64_t)byte << (56 - bits);
+					bits += 8;
+				}
+			}
+
+			int getBits(int count)
+			{
+				if (count == 0)
+					return 0;
+				if (bits < count)
+					fill();
+				int value = (int)(buffer >> (64 - count));
+				buffer <<= count;
+				bits -= count;
+				return value;
+			}
+
+			int getBit() { return getBits(1); }
+
+			// Valor con signo de count bits (tabla F.12 de la norma)
+			int receiveExtend(int count)
+			{
+				int value = getBits(count);
+				if (count > 0 && value < (1 << (count - 1)))
+					value += 1 - (1 << count);
+				return value;
+			}
+
+			// Símbolo de la tabla; -1 si el código no existe
+			int decode(const HuffmanTable& table)
+			{
+				if (bits < 16)
+					fill();
+				int index = table.fast[buffer >> (64 - FastBits)];
+				if (index < 255) {
+					int length = table.size[index];
+					buffer <<= length;
+					bits -= length;
+					return table.values[index];
+				}
+
+				uint32_t top = (uint32_t)(buffer >> 48);
+				int length = FastBits + 1;
+				while (top >= table.maxCode[length])
+					length++;
+				if (length == 17)
+					return -1;
+				int symbol = (int)(buffer >> (64 - length)) + table.delta[length];
+				if (symbol < 0 || symbol >= 256)
+					return -1;
+				buffer <<= length;
+				bits -= length;
+				return table.values[symbol];
+			}
+		};
+
+		struct Component {
+			int id = 0;
+			int h = 1, v = 1;
+			int quantTable = 0;
+			int dcTable = 0, acTable = 0;
+			int width = 0, height = 0;             // muestras con datos
+			int blocksWide = 0, blocksHigh = 0;    // bloques con datos (scans de una componente)
+			int blocksPerLine = 0, blocksPerColumn = 0; // con el relleno de MCU
+			std::vector<int16_t> coefficients;     // orden natural, sin cuantizar
+			std::vector<uint8_t> plane;            // blocksPerLine * 8 de ancho
+		};
+
+		struct Frame {
+			int width = 0, height = 0;
+			bool progressive = false;
+			int componentCount = 0;
+			Component components[3];
+			int hMax = 1, vMax = 1;
+			int mcusX = 0, mcusY = 0;
+			alignas(16) float quant[4][64];
+			bool quantDefined[4] = {};
+			HuffmanTable dc[4], ac[4];
+			bool dcDefined[4] = {}, acDefined[4] = {};
+			int restartInterval = 0;
+			int adobeTransform = -1;
+		};
+
+		struct Scan {
+			int count = 0;
+			int components[3] = {};
+			int ss = 0, se = 63, ah = 0, al = 0;
+		};
+
+		uint16_t readU16(const uint8_t* p)
+		{
+			return (uint16_t)((p[0] << 8) | p[1]);
+		}
+
+		// Estado de un tramo de la entropía: se reinicia en cada restart marker
+		struct ScanState {
+			int dcPredictor[3] = {};
+			int eobRun = 0;
+		};
+
+		bool decodeBlockBaseline(BitReader& reader, const Frame& frame, const Component& component, int16_t* block, int& predictor)
+		{
+			int t = reader.decode(frame.dc[component.dcTable]);
+			if (t < 0 || t > 16)
+				return false;
+			predictor += t ? reader.receiveExtend(t) : 0;
+			block[0] = (int16_t)predictor;
+
+			const HuffmanTable& ac = frame.ac[component.acTable];
+			for (int k = 1; k < 64;) {
+				int rs = reader.decode(ac);
+				if (rs < 0)
+					return false;
+				int run = rs >> 4, size = rs & 15;
+				if (size == 0) {
+					if (run != 15)
+						break;
+					k += 16;
+					continue;
+				}
+				k += run;
+				block[ZigZag[k]] = (int16_t)reader.receiveExtend(size);
+				k++;
+			}
+			return true;
+		}
+
+		bool decodeBlockDC(BitReader& reader, const Frame& frame, const Component& component, const Scan& scan,
+			int16_t* block, int& predictor)
+		{
+			if (scan.ah == 0) {
+				int t = reader.decode(frame.dc[component.dcTable]);
+				if (t < 0 || t > 16)
+					return false;
+				predictor += t ? reader.receiveExtend(t) : 0;
+				block[0] = (int16_t)(predictor * (1 << scan.al));
+			}
+			else if (reader.getBit()) {
+				block[0] = (int16_t)(block[0] | (1 << scan.al));
+			}
+			return true;
+		}
+
+		bool decodeBlockACFirst(BitReader& reader, const Frame& frame, const Component& component, const Scan& scan,
+			int16_t* block, int& eobRun)
+		{
+			if (eobRun > 0) {
+				eobRun--;
+				return true;
+			}
+			const HuffmanTable& ac = frame.ac[component.acTable];
+			for (int k = scan.ss; k <= scan.se;) {
+				int rs = reader.decode(ac);
+				if (rs < 0)
+					return false;
+				int run = rs >> 4, size = rs & 15;
+				if (size == 0) {
+					if (run < 15) {
+						eobRun = (1 << run) - 1;
+						if (run)
+							eobRun += reader.getBits(run);
+						break;
+					}
+					k += 16;
+					continue;
+				}
+				k += run;
+				block[ZigZag[k]] = (int16_t)(reader.receiveExtend(size) * (1 << scan.al));
+				k++;
+			}
+			return true;
+		}
+
+		// Refinamiento de AC: un bit más de cada coeficiente ya distinto de cero y los
+		// nuevos coeficientes de magnitud 1 (G.1.2.3 de la norma)
+		bool decodeBlockACRefine(BitReader& reader, const Frame& frame, const Component& component, const Scan& scan,
+			int16_t* block, int& eobRun)
+		{
+			const int positive = 1 << scan.al;
+			const int negative = -1 * (1 << scan.al);
+			auto refine = [&](int16_t& coefficient) {
+				if (reader.getBit() && (coefficient & positive) == 0)
+					coefficient = (int16_t)(coefficient + (coefficient >= 0 ? positive : negative));
+			};
+
+			int k = scan.ss;
+			if (eobRun == 0) {
+				const HuffmanTable& ac = frame.ac[component.acTable];
+				for (; k <= scan.se; k++) {
+					int rs = reader.decode(ac);
+					if (rs < 0)
+						return false;
+					int run = rs >> 4, size = rs & 15;
+					int value = 0;
+					if (size) {
+						if (size != 1)
+							return false;
+						value = reader.getBit() ? positive : negative;
+					}
+					else if (run != 15) {
+						eobRun = 1 << run;
+						if (run)
+							eobRun += reader.getBits(run);
+						break;
+					}
+
+					// Saltar run coeficientes a cero refinando los no nulos que haya entre medias
+					for (; k <= scan.se; k++) {
+						int16_t& coefficient = block[ZigZag[k]];
+						if (coefficient != 0)
+							refine(coefficient);
+						else if (run-- == 0)
+							break;
+					}
+					if (value && k <= scan.se)
+						block[ZigZag[k]] = (int16_t)value;
+				}
+			}
+			if (eobRun > 0) {
+				for (; k <= scan.se; k++) {
+					int16_t& coefficient = block[ZigZag[k]];
+					if (coefficient != 0)
+						refine(coefficient);
+				}
+				eobRun--;
+			}
+			return true;
+		}
+
+		bool decodeBlock(BitReader& reader, const Frame& frame, const Scan& scan, int scanComponent, int16_t* block, ScanState& state)
+		{
+			const Component& component = frame.components[scan.components[scanComponent]];
+			if (!frame.progressive)
+				return decodeBlockBaseline(reader, frame, component, block, state.dcPredictor[scanComponent]);
+			if (scan.ss == 0)
+				return decodeBlockDC(reader, frame, component, scan, block, state.dcPredictor[scanComponent]);
+			if (scan.ah == 0)
+				return decodeBlockACFirst(reader, frame, component, scan, block, state.eobRun);
+			return decodeBlockACRefine(reader, frame, component, scan, block, state.eobRun);
+		}
+
+		// Decodifica las unidades [first, last) del scan: MCUs si es entrelazado, bloques
+		// de la única componente si no
+		bool decodeUnits(Frame& frame, const Scan& scan, BitReader& reader, size_t first, size_t last)
+		{
+			ScanState state;
+			for (size_t unit = first; unit < last; unit++) {
+				if (scan.count == 1) {
+					Component& component = frame.components[scan.components[0]];
+					size_t bx = unit % component.blocksWide, by = unit / component.blocksWide;
+					int16_t* block = component.coefficients.data() + (by * component.blocksPerLine + bx) * 64;
+					if (!decodeBlock(reader, frame, scan, 0, block, state))
+						return false;
+					continue;
+				}
+
+				size_t mx = unit % frame.mcusX, my = unit / frame.mcusX;
+				for (int c = 0; c < scan.count; c++) {
+					Component& component = frame.components[scan.components[c]];
+					for (int v = 0; v < component.v; v++) {
+						for (int h = 0; h < component.h; h++) {
+							size_t bx = mx * component.h + h, by = my * component.v + v;
+							int16_t* block = component.coefficients.data() + (by * component.blocksPerLine + bx) * 64;
+							if (!decodeBlock(reader, frame, scan, c, block, state))
+								return false;
+						}
+					}
+				}
+			}
+			return true;
+		}
+
+		// Busca el final de los datos entrópicos (el siguiente marcador que no es RSTn) y
+		// apunta dónde empieza cada intervalo entre restart markers
+		const uint8_t* findScanEnd(const uint8_t* p, const uint8_t* end, std::vector<const uint8_t*>& intervals)
+		{
+			intervals.push_back(p);
+			while (p + 1 < end) {
+				const uint8_t* marker = (const uint8_t*)std::memchr(p, 0xFF, end - p - 1);
+				if (!marker)
+					return end;
+				uint8_t next = marker[1];
+				if (next == 0x00) {
+					p = marker + 2;
+				}
+				else if (next >= 0xD0 && next <= 0xD7) {
+					p = marker + 2;
+					intervals.push_back(p);
+				}
+				else if (next == 0xFF) {
+					p = marker + 1;
+				}
+				else {
+					return marker;
+				}
+			}
+			return end;
+		}
+
+		bool decodeScan(Frame& frame, const Scan& scan, const uint8_t* begin, const uint8_t* end,
+			const std::vector<const uint8_t*>& intervals, ThreadPool* pool)
+		{
+			size_t units = scan.count == 1 ?
+				(size_t)frame.components[scan.components[0]].blocksWide * frame.components[scan.components[0]].blocksHigh :
+				(size_t)frame.mcusX * frame.mcusY;
+
+			if (frame.restartInterval == 0 || intervals.size() < 2) {
+				BitReader reader(begin, end);
+				return decodeUnits(frame, scan, reader, 0, units);
+			}
+
+			// Con restart markers cada intervalo es independiente: predictores y EOB run
+			// empiezan de cero y el lector se realinea a byte
+			size_t interval = (size_t)frame.restartInterval;
+			size_t count = std::min(intervals.size(), (units + interval - 1) / interval);
+			std::atomic<bool> failed{ false };
+			auto body = [&](size_t first, size_t last) {
+				for (size_t i = first; i < last && !failed; i++) {
+					const uint8_t* segmentEnd = i + 1 < intervals.size() ? intervals[i + 1] - 2 : end;
+					BitReader reader(intervals[i], segmentEnd);
+					if (!decodeUnits(frame, scan, reader, i * interval, std::min(units, (i + 1) * interval)))
+						failed = true;
+				}
+			};
+			if (pool)
+				pool->parallelFor(count, 4, body);
+			else
+				body(0, count);
+			return !failed;
+		}
+
+		// IDCT 8x8 separable como producto de matrices: M[u][x] = c(u)/2 * cos((2x+1)uπ/16)
+		struct IdctMatrix {
+			alignas(32) float m[64];
+
+			IdctMatrix()
+			{
+				const double pi = 3.14159265358979323846;
+				for (int u = 0; u < 8; u++) {
+					double scale = u == 0 ? std::sqrt(0.125) : 0.5;
+					for (int x = 0; x < 8; x++)
+						m[u * 8 + x] = (float)(scale * std::cos((2 * x + 1) * u * pi / 16.0));
+				}
+			}
+		};
+
+		const IdctMatrix& idctMatrix()
+		{
+			static const IdctMatrix matrix;
+			return matrix;
+		}
+
+		inline uint8_t clampByte(int value)
+		{
+			return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+		}
+
+		void idctBlock(const int16_t* block, const float* quant, uint8_t* out, size_t stride)
+		{
+			// Bloques solo con DC (muy habituales): un valor plano
+			bool acZero = true;
+#if defined(JPEG_SSE)
+			__m128i any = _mm_and_si128(_mm_loadu_si128((const __m128i*)block), _mm_setr_epi16(0, -1, -1, -1, -1, -1, -1, -1));
+			for (int i = 8; i < 64; i += 8)
+				any = _mm_or_si128(any, _mm_loadu_si128((const __m128i*)(block + i)));
+			acZero = _mm_movemask_epi8(_mm_cmpeq_epi16(any, _mm_setzero_si128())) == 0xFFFF;
+#else
+			for (int i = 1; i < 64 && acZero; i++)
+				acZero = block[i] == 0;
+#endif
+			if (acZero) {
+				uint8_t value = clampByte((int)std::lround(block[0] * quant[0] * 0.125f + 128.0f));
+				for (int y = 0; y < 8; y++)
+					std::memset(out + y * stride, value, 8);
+				return;
+			}
+
+			const float* m = idctMatrix().m;
+			alignas(32) float temp[64];
+#if defined(JPEG_AVX)
+			// Pasada vertical: fila y = suma de las filas de frecuencia u por M[u][y]
+			__m256 rows[8];
+			for (int u = 0; u < 8; u++) {
+				__m128i coefficients = _mm_loadu_si128((const __m128i*)(block + u * 8));
+				__m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(coefficients, coefficients), 16);
+				__m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(coefficients, coefficients), 16);
+				__m256 values = _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(low), high, 1));
+				rows[u] = _mm256_mul_ps(values, _mm256_loadu_ps(quant + u * 8));
+			}
+			for (int y = 0; y < 8; y++) {
+				__m256 sum = _mm256_mul_ps(rows[0], _mm256_set1_ps(m[y]));
+				for (int u = 1; u < 8; u++)
+					sum = _mm256_add_ps(sum, _mm256_mul_ps(rows[u], _mm256_set1_ps(m[u * 8 + y])));
+				_mm256_store_ps(temp + y * 8, sum);
+			}
+			// Pasada horizontal: cada fila por la matriz, difundiendo sus 8 valores
+			for (int y = 0; y < 8; y++) {
+				__m256 sum = _mm256_set1_ps(128.0f);
+				for (int v = 0; v < 8; v++)
+					sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(temp[y * 8 + v]), _mm256_load_ps(m + v * 8)));
+				__m256i rounded = _mm256_cvtps_epi32(sum);
+				__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(rounded), _mm256_extractf128_si256(rounded, 1));
+				_mm_storel_epi64((__m128i*)(out + y * stride), _mm_packus_epi16(words, words));
+			}
+#elif defined(JPEG_SSE)
+			__m128 rows[8][2];
+			for (int u = 0; u < 8; u++) {
+				__m128i coefficients = _mm_loadu_si128((const __m128i*)(block + u * 8));
+				__m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(coefficients, coefficients), 16);
+				__m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(coefficients, coefficients), 16);
+				rows[u][0] = _mm_mul_ps(_mm_cvtepi32_ps(low), _mm_loadu_ps(quant + u * 8));
+				rows[u][1] = _mm_mul_ps(_mm_cvtepi32_ps(high), _mm_loadu_ps(quant + u * 8 + 4));
+			}
+			for (int y = 0; y < 8; y++) {
+				__m128 factor = _mm_set1_ps(m[y]);
+				__m128 sum0 = _mm_mul_ps(rows[0][0], factor);
+				__m128 sum1 = _mm_mul_ps(rows[0][1], factor);
+				for (int u = 1; u < 8; u++) {
+					factor = _mm_set1_ps(m[u * 8 + y]);
+					sum0 = _mm_add_ps(sum0, _mm_mul_ps(rows[u][0], factor));
+					sum1 = _mm_add_ps(sum1, _mm_mul_ps(rows[u][1], factor));
+				}
+				_mm_store_ps(temp + y * 8, sum0);
+				_mm_store_ps(temp + y * 8 + 4, sum1);
+			}
+			for (int y = 0; y < 8; y++) {
+				__m128 sum0 = _mm_set1_ps(128.0f);
+				__m128 sum1 = sum0;
+				for (int v = 0; v < 8; v++) {
+					__m128 value = _mm_set1_ps(temp[y * 8 + v]);
+					sum0 = _mm_add_ps(sum0, _mm_mul_ps(value, _mm_load_ps(m + v * 8)));
+					sum1 = _mm_add_ps(sum1, _mm_mul_ps(value, _mm_load_ps(m + v * 8 + 4)));
+				}
+				__m128i words = _mm_packs_epi32(_mm_cvtps_epi32(sum0), _mm_cvtps_epi32(sum1));
+				_mm_storel_epi64((__m128i*)(out + y * stride), _mm_packus_epi16(words, words));
+			}
+#else
+			float rows[64];
+			for (int i = 0; i < 64; i++)
+				rows[i] = block[i] * quant[i];
+			for (int y = 0; y < 8; y++) {
+				for (int v = 0; v < 8; v++) {
+					float sum = 0.0f;
+					for (int u = 0; u < 8; u++)
+						sum += rows[u * 8 + v] * m[u * 8 + y];
+					temp[y * 8 + v] = sum;
+				}
+			}
+			for (int y = 0; y < 8; y++) {
+				for (int x = 0; x < 8; x++) {
+					float sum = 128.0f;
+					for (int v = 0; v < 8; v++)
+						sum += temp[y * 8 + v] * m[v * 8 + x];
+					out[y * stride + x] = clampByte((int)std::lround(sum));
+				}
+			}
+#endif
+		}
+
+		// Fila y de una componente llevada a la resolución de la imagen. Con factor 2 usa
+		// el filtro triangular (3/4 y 1/4) de libjpeg y stbi; con otros, el más cercano.
+		const uint8_t* upsampleRow(const Frame& frame, const Component& component, int y, std::vector<int>& weighted,
+			std::vector<uint8_t>& row)
+		{
+			size_t stride = (size_t)component.blocksPerLine * 8;
+			int fx = frame.hMax / component.h, fy = frame.vMax / component.v;
+			bool exact = frame.hMax % component.h == 0 && frame.vMax % component.v == 0;
+			if (fx == 1 && fy == 1 && exact)
+				return component.plane.data() + (size_t)y * stride;
+
+			row.resize(frame.width);
+			if (!exact || fx > 2 || fy > 2) {
+				const uint8_t* source = component.plane.data() + (size_t)std::min(y * component.v / frame.vMax, component.height - 1) * stride;
+				for (int x = 0; x < frame.width; x++)
+					row[x] = source[std::min(x * component.h / frame.hMax, component.width - 1)];
+				return row.data();
+			}
+
+			// Vertical: 4 * la fila, o 3 * la cercana + la lejana
+			weighted.resize(component.width);
+			const uint8_t* nearRow = component.plane.data() + (size_t)std::min(y / fy, component.height - 1) * stride;
+			if (fy == 1) {
+				for (int x = 0; x < component.width; x++)
+					weighted[x] = nearRow[x] * 4;
+			}
+			else {
+				int far = std::clamp(y / 2 + ((y & 1) ? 1 : -1), 0, component.height - 1);
+				const uint8_t* farRow = component.plane.data() + (size_t)far * stride;
+				for (int x = 0; x < component.width; x++)
+					weighted[x] = nearRow[x] * 3 + farRow[x];
+			}
+
+			if (fx == 1) {
+				for (int x = 0; x < frame.width; x++)
+					row[x] = (uint8_t)((weighted[x] + 2) >> 2);
+				return row.data();
+			}
+			int last = component.width - 1;
+			for (int x = 0; x < frame.width; x++) {
+				int i = x >> 1;
+				int neighbour = (x & 1) ? std::min(i + 1, last) : std::max(i - 1, 0);
+				row[x] = (uint8_t)((weighted[i] * 3 + weighted[neighbour] + 8) >> 4);
+			}
+			return row.data();
+		}
+
+		// YCbCr (JFIF) a RGB de una fila, en planos separados
+		void convertYCbCr(const uint8_t* yRow, const uint8_t* cbRow, const uint8_t* crRow, int width,
+			uint8_t* red, uint8_t* green, uint8_t* blue)
+		{
+			int x = 0;
+#if defined(JPEG_SSE)
+			const __m128i zero = _mm_setzero_si128();
+			const __m128 offset = _mm_set1_ps(128.0f);
+			for (; x + 8 <= width; x += 8) {
+				__m128i y16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(yRow + x)), zero);
+				__m128i cb16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(cbRow + x)), zero);
+				__m128i cr16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(crRow + x)), zero);
+				__m128i r32[2], g32[2], b32[2];
+				for (int half = 0; half < 2; half++) {
+					__m128 luma = _mm_cvtepi32_ps(half ? _mm_unpackhi_epi16(y16, zero) : _mm_unpacklo_epi16(y16, zero));
+					__m128 cb = _mm_sub_ps(_mm_cvtepi32_ps(half ? _mm_unpackhi_epi16(cb16, zero) : _mm_unpacklo_epi16(cb16, zero)), offset);
+					__m128 cr = _mm_sub_ps(_mm_cvtepi32_ps(half ? _mm_unpackhi_epi16(cr16, zero) : _mm_unpacklo_epi16(cr16, zero)), offset);
+					r32[half] = _mm_cvtps_epi32(_mm_add_ps(luma, _mm_mul_ps(cr, _mm_set1_ps(1.402f))));
+					g32[half] = _mm_cvtps_epi32(_mm_sub_ps(luma, _mm_add_ps(_mm_mul_ps(cb, _mm_set1_ps(0.344136f)),
+						_mm_mul_ps(cr, _mm_set1_ps(0.714136f)))));
+					b32[half] = _mm_cvtps_epi32(_mm_add_ps(luma, _mm_mul_ps(cb, _mm_set1_ps(1.772f))));
+				}
+				__m128i r = _mm_packs_epi32(r32[0], r32[1]);
+				__m128i g = _mm_packs_epi32(g32[0], g32[1]);
+				__m128i b = _mm_packs_epi32(b32[0], b32[1]);
+				_mm_storel_epi64((__m128i*)(red + x), _mm_packus_epi16(r, r));
+				_mm_storel_epi64((__m128i*)(green + x), _mm_packus_epi16(g, g));
+				_mm_storel_epi64((__m128i*)(blue + x), _mm_packus_epi16(b, b));
+			}
+#endif
+			for (; x < width; x++) {
+				float luma = yRow[x], cb = cbRow[x] - 128.0f, cr = crRow[x] - 128.0f;
+				red[x] = clampByte((int)std::lround(luma + 1.402f * cr));
+				green[x] = clampByte((int)std::lround(luma - 0.344136f * cb - 0.714136f * cr));
+				blue[x] = clampByte((int)std::lround(luma + 1.772f * cb));
+			}
+		}
+
+		void writePixels(const Frame& frame, ThreadPool* pool, unsigned char* output, int outChannels, bool flipVertically)
+		{
+			bool rgb = frame.componentCount == 3;
+			// Adobe con transform 0: las componentes ya son RGB
+			bool convert = rgb && frame.adobeTransform != 0;
+
+			auto body = [&](size_t begin, size_t end) {
+				std::vector<int> weighted;
+				std::vector<uint8_t> rows[3];
+				std::vector<uint8_t> color(rgb ? (size_t)frame.width * 3 : 0);
+				for (size_t y = begin; y < end; y++) {
+					const uint8_t* samples[3] = {};
+					for (int c = 0; c < frame.componentCount; c++)
+						samples[c] = upsampleRow(frame, frame.components[c], (int)y, weighted, rows[c]);
+
+					const uint8_t* red = samples[0];
+					const uint8_t* green = samples[0];
+					const uint8_t* blue = samples[0];
+					if (rgb) {
+						if (convert) {
+							uint8_t* planes = color.data();
+							convertYCbCr(samples[0], samples[1], samples[2], frame.width,
+								planes, planes + frame.width, planes + 2 * frame.width);
+							red = planes;
+							green = planes + frame.width;
+							blue = planes + 2 * frame.width;
+						}
+						else {
+							green = samples[1];
+							blue = samples[2];
+						}
+					}
+
+					size_t outRow = flipVertically ? (size_t)(frame.height - 1 - y) : y;
+					unsigned char* out = output + outRow * frame.width * outChannels;
+					switch (outChannels) {
+					case 1:
+					case 2:
+						for (int x = 0; x < frame.width; x++) {
+							// Como stbi: la luma directa, o calculada si la imagen es RGB
+							uint8_t luma = rgb && !convert ? (uint8_t)((red[x] * 77 + green[x] * 150 + blue[x] * 29) >> 8) : samples[0][x];
+							out[x * outChannels] = luma;
+							if (outChannels == 2)
+								out[x * 2 + 1] = 255;
+						}
+						break;
+					case 3:
+						for (int x = 0; x < frame.width; x++) {
+							out[x * 3] = red[x];
+							out[x * 3 + 1] = green[x];
+							out[x * 3 + 2] = blue[x];
+						}
+						break;
+					default:
+						for (int x = 0; x < frame.width; x++) {
+							out[x * 4] = red[x];
+							out[x * 4 + 1] = green[x];
+							out[x * 4 + 2] = blue[x];
+							out[x * 4 + 3] = 255;
+						}
+						break;
+					}
+				}
+			};
+			if (pool)
+				pool->parallelFor(frame.height, 16, body);
+			else
+				body(0, frame.height);
+		}
+
+		bool parseFrame(Frame& frame, const uint8_t* p, size_t length, bool progressive)
+		{
+			if (length < 6 || p[0] != 8)
+				return false;
+			frame.height = readU16(p + 1);
+			frame.width = readU16(p + 3);
+			frame.componentCount = p[5];
+			frame.progressive = progressive;
+			// CMYK/YCCK y los de 2 componentes se quedan para stbi
+			if (frame.width == 0 || frame.height == 0 || (frame.componentCount != 1 && frame.componentCount != 3) ||
+				length < 6 + 3 * (size_t)frame.componentCount)
+				return false;
+
+			for (int c = 0; c < frame.componentCount; c++) {
+				Component& component = frame.components[c];
+				component.id = p[6 + c * 3];
+				component.h = p[7 + c * 3] >> 4;
+				component.v = p[7 + c * 3] & 15;
+				component.quantTable = p[8 + c * 3];
+				if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 || component.quantTable > 3)
+					return false;
+				frame.hMax = std::max(frame.hMax, component.h);
+				frame.vMax = std::max(frame.vMax, component.v);
+			}
+			// Con una sola componente los factores no cuentan: cada MCU es un bloque
+			if (frame.componentCount == 1) {
+				frame.components[0].h = frame.components[0].v = 1;
+				frame.hMax = frame.vMax = 1;
+			}
+
+			frame.mcusX = (frame.width + 8 * frame.hMax - 1) / (8 * frame.hMax);
+			frame.mcusY = (frame.height + 8 * frame.vMax - 1) / (8 * frame.vMax);
+			for (int c = 0; c < frame.componentCount; c++) {
+				Component& component = frame.components[c];
+				component.width = (frame.width * component.h + frame.hMax - 1) / frame.hMax;
+				component.height = (frame.height * component.v + frame.vMax - 1) / frame.vMax;
+				component.blocksWide = (component.width + 7) / 8;
+				component.blocksHigh = (component.height + 7) / 8;
+				component.blocksPerLine = frame.mcusX * component.h;
+				component.blocksPerColumn = frame.mcusY * component.v;
+				component.coefficients.assign((size_t)component.blocksPerLine * component.blocksPerColumn * 64, 0);
+			}
+			return true;
+		}
+
+		bool parseScan(Frame& frame, Scan& scan, const uint8_t* p, size_t length)
+		{
+			if (frame.componentCount == 0 || length < 1)
+				return false;
+			scan.count = p[0];
+			if (scan.count < 1 || scan.count > frame.componentCount || length < 4 + 2 * (size_t)scan.count)
+				return false;
+			for (int i = 0; i < scan.count; i++) {
+				int id = p[1 + i * 2];
+				int tables = p[2 + i * 2];
+				int index = -1;
+				for (int c = 0; c < frame.componentCount; c++)
+					if (frame.components[c].id == id)
+						index = c;
+				if (index < 0 || (tables >> 4) > 3 || (tables & 15) > 3)
+					return false;
+				scan.components[i] = index;
+				// Las tablas son por scan; se guardan en la componente para decodeBlock
+				frame.components[index].dcTable = tables >> 4;
+				frame.components[index].acTable = tables & 15;
+			}
+			const uint8_t* spectral = p + 1 + scan.count * 2;
+			scan.ss = spectral[0];
+			scan.se = spectral[1];
+			scan.ah = spectral[2] >> 4;
+			scan.al = spectral[2] & 15;
+
+			if (!frame.progressive)
+				return scan.ss == 0 && scan.se == 63;
+			if (scan.ss > scan.se || scan.se > 63 || scan.al > 13)
+				return false;
+			// Los AC progresivos van siempre de una en una componente
+			if (scan.ss > 0 && scan.count != 1)
+				return false;
+			return scan.ss > 0 || scan.se == 0;
+		}
+
+		bool tablesReady(const Frame& frame, const Scan& scan)
+		{
+			for (int i = 0; i < scan.count; i++) {
+				const Component& component = frame.components[scan.components[i]];
+				bool needsDC = scan.ss == 0 && scan.ah == 0;
+				bool needsAC = scan.se > 0;
+				if ((needsDC && !frame.dcDefined[component.dcTable]) || (needsAC && !frame.acDefined[component.acTable]))
+					return false;
+			}
+			return true;
+		}
+
+		bool readFile(const char* path, std::vector<unsigned char>& contents)
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file)
+				return false;
+			contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			return true;
+		}
+
+		bool isJpeg(const std::vector<unsigned char>& contents)
+		{
+			return contents.size() > 4 && contents[0] == 0xFF && contents[1] == 0xD8;
+		}
+
+		// Escaneo rápido de marcadores para el benchmark
+		void describeJpeg(const std::vector<unsigned char>& contents, bool& progressive, int& restartInterval)
+		{
+			progressive = false;
+			restartInterval = 0;
+			size_t i = 2;
+			while (i + 4 <= contents.size() && contents[i] == 0xFF) {
+				uint8_t marker = contents[i + 1];
+				if (marker == 0xDA)
+					break;
+				if (marker == 0xC2)
+					progressive = true;
+				if (marker == 0xDD && i + 6 <= contents.size())
+					restartInterval = readU16(&contents[i + 4]);
+				i += 2 + readU16(&contents[i + 2]);
+			}
+		}
+
+	}
+
+	void setImageDecoder(ImageDecoder decoder)
+	{
+		g_ImageDecoder = (int)decoder;
+	}
+
+	ImageDecoder imageDecoder()
+	{
+		return (ImageDecoder)g_ImageDecoder.load();
+	}
+
+	unsigned char* decodeJpeg(const unsigned char* data, size_t size, int* width, int* height, int* channels,
+		int desiredChannels, bool flipVertically, ThreadPool* pool)
+	{
+		if (size < 4 || data[0] != 0xFF || data[1] != 0xD8 || desiredChannels < 0 || desiredChannels > 4)
+			return nullptr;
+
+		std::unique_ptr<Frame> frame(new Frame());
+		bool frameSeen = false, scanSeen = false;
+		const uint8_t* p = data + 2;
+		const uint8_t* end = data + size;
+		std::vector<const uint8_t*> intervals;
+
+		for (;;) {
+			// Bytes de relleno entre marcadores
+			while (p < end && *p != 0xFF)
+				p++;
+			while (p < end && *p == 0xFF)
+				p++;
+			if (p >= end)
+				break;
+			uint8_t marker = *p++;
+			if (marker == 0xD9)
+				break;
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+				continue;
+			if (end - p < 2)
+				return nullptr;
+			size_t length = readU16(p);
+			if (length < 2 || length > (size_t)(end - p))
+				return nullptr;
+			const uint8_t* segment = p + 2;
+			size_t segmentLength = length - 2;
+			p += length;
+
+			switch (marker) {
+			case 0xDB: // DQT
+				for (size_t i = 0; i < segmentLength;) {
+					int precision = segment[i] >> 4, id = segment[i] & 15;
+					size_t tableSize = precision ? 128 : 64;
+					if (id > 3 || i + 1 + tableSize > segmentLength)
+						return nullptr;
+					for (int k = 0; k < 64; k++) {
+						int value = precision ? readU16(segment + i + 1 + k * 2) : segment[i + 1 + k];
+						frame->quant[id][ZigZag[k]] = (float)value;
+					}
+					frame->quantDefined[id] = true;
+					i += 1 + tableSize;
+				}
+				break;
+			case 0xC4: // DHT
+				for (size_t i = 0; i < segmentLength;) {
+					if (i + 17 > segmentLength)
+						return nullptr;
+					int tableClass = segment[i] >> 4, id = segment[i] & 15;
+					const uint8_t* counts = segment + i + 1;
+					size_t total = 0;
+					for (int k = 0; k < 16; k++)
+						total += counts[k];
+					if (id > 3 || tableClass > 1 || total > 256 || i + 17 + total > segmentLength)
+						return nullptr;
+					HuffmanTable& table = tableClass ? frame->ac[id] : frame->dc[id];
+					if (!table.build(counts, segment + i + 17))
+						return nullptr;
+					(tableClass ? frame->acDefined : frame->dcDefined)[id] = true;
+					i += 17 + total;
+				}
+				break;
+			case 0xC0: // baseline
+			case 0xC1: // secuencial extendido, Huffman
+			case 0xC2: // progresivo, Huffman
+				if (frameSeen || !parseFrame(*frame, segment, segmentLength, marker == 0xC2))
+					return nullptr;
+				frameSeen = true;
+				break;
+			case 0xDD: // DRI
+				if (segmentLength < 2)
+					return nullptr;
+				frame->restartInterval = readU16(segment);
+				break;
+			case 0xEE: // APP14: transform de Adobe
+				if (segmentLength >= 12 && std::memcmp(segment, "Adobe", 5) == 0)
+					frame->adobeTransform = segment[11];
+				break;
+			case 0xDA: { // SOS
+				Scan scan;
+				if (!frameSeen || !parseScan(*frame, scan, segment, segmentLength) || !tablesReady(*frame, scan))
+					return nullptr;
+				intervals.clear();
+				const uint8_t* scanEnd = findScanEnd(p, end, intervals);
+				if (!decodeScan(*frame, scan, p, scanEnd, intervals, pool))
+					return nullptr;
+				scanSeen = true;
+				p = scanEnd;
+				break;
+			}
+			default:
+				// Lossless, jerárquico o aritmético: stbi
+				if (marker >= 0xC3 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+					return nullptr;
+				break;
+			}
+		}
+		if (!frameSeen || !scanSeen)
+			return nullptr;
+		for (int c = 0; c < frame->componentCount; c++) {
+			if (!frame->quantDefined[frame->components[c].quantTable])
+				return nullptr;
+		}
+
+		// IDCT de todos los bloques (incluido el relleno de MCU), por filas de bloques
+		for (int c = 0; c < frame->componentCount; c++) {
+			Component& component = frame->components[c];
+			size_t stride = (size_t)component.blocksPerLine * 8;
+			component.plane.resize(stride * component.blocksPerColumn * 8);
+			const float* quant = frame->quant[component.quantTable];
+			auto body = [&](size_t begin, size_t end) {
+				for (size_t by = begin; by < end; by++) {
+					for (int bx = 0; bx < component.blocksPerLine; bx++) {
+						const int16_t* block = component.coefficients.data() + (by * component.blocksPerLine + bx) * 64;
+						idctBlock(block, quant, component.plane.data() + by * 8 * stride + bx * 8, stride);
+					}
+				}
+			};
+			if (pool)
+				pool->parallelFor(component.blocksPerColumn, 4, body);
+			else
+				body(0, component.blocksPerColumn);
+			std::vector<int16_t>().swap(component.coefficients);
+		}
+
+		int outChannels = desiredChannels ? desiredChannels : frame->componentCount;
+		unsigned char* output = (unsigned char*)std::malloc((size_t)frame->width * frame->height * outChannels);
+		if (!output)
+			return nullptr;
+		writePixels(*frame, pool, output, outChannels, flipVertically);
+
+		*width = frame->width;
+		*height = frame->height;
+		*channels = frame->componentCount;
+		return output;
+	}
+
+	unsigned char* loadImage(const char* path, int* width, int* height, int* channels, int desiredChannels)
+	{
+		stbi_set_flip_vertically_on_load(true);
+		if (imageDecoder() == ImageDecoder::Stbi)
+			return stbi_load(path, width, height, channels, desiredChannels);
+
+		std::vector<unsigned char> contents;
+		if (!readFile(path, contents) || contents.empty())
+			return nullptr;
+		if (isJpeg(contents)) {
+			unsigned char* pixels = decodeJpeg(contents.data(), contents.size(), width, height, channels,
+				desiredChannels, true, &ThreadPool::shared());
+			if (pixels)
+				return pixels;
+		}
+		return stbi_load_from_memory(contents.data(), (int)contents.size(), width, height, channels, desiredChannels);
+	}
+
+	void freeImage(unsigned char* pixels)
+	{
+		// stbi reserva con malloc (STBI_MALLOC por defecto), igual que decodeJpeg
+		stbi_image_free(pixels);
+	}
+
+	std::vector<JpegBenchmarkResult> benchmarkJpegDecode(const std::vector<std::string>& paths, ThreadPool* pool)
+	{
+		typedef std::chrono::steady_clock Clock;
+		auto millisecondsSince = [](Clock::time_point start) {
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		};
+
+		std::vector<JpegBenchmarkResult> results;
+		for (const std::string& path : paths) {
+			std::vector<unsigned char> contents;
+			if (!readFile(path.c_str(), contents) || !isJpeg(contents)) {
+				std::cout << "JPEG benchmark: cannot read " << path << std::endl;
+				continue;
+			}
+			JpegBenchmarkResult result;
+			result.path = path;
+			describeJpeg(contents, result.progressive, result.restartInterval);
+
+			int channels;
+			stbi_set_flip_vertically_on_load(true);
+			Clock::time_point start = Clock::now();
+			unsigned char* reference = stbi_load_from_memory(contents.data(), (int)contents.size(), &result.width, &result.height, &channels, 0);
+			double stbiMilliseconds = millisecondsSince(start);
+			if (!reference) {
+				std::cout << "JPEG benchmark: stbi cannot decode " << path << std::endl;
+				continue;
+			}
+
+			int width, height, ownChannels;
+			start = Clock::now();
+			unsigned char* single = decodeJpeg(contents.data(), contents.size(), &width, &height, &ownChannels, 0, true, nullptr);
+			double singleMilliseconds = millisecondsSince(start);
+			start = Clock::now();
+			unsigned char* threaded = decodeJpeg(contents.data(), contents.size(), &width, &height, &ownChannels, 0, true, pool);
+			double threadedMilliseconds = millisecondsSince(start);
+
+			double megabytes = (double)result.width * result.height * channels / (1024.0 * 1024.0);
+			result.stbiMegabytesPerSecond = megabytes * 1000.0 / stbiMilliseconds;
+			if (single && threaded && width == result.width && height == result.height && ownChannels == channels) {
+				result.singleMegabytesPerSecond = megabytes * 1000.0 / singleMilliseconds;
+				result.threadedMegabytesPerSecond = megabytes * 1000.0 / threadedMilliseconds;
+				size_t count = (size_t)width * height * channels;
+				uint64_t difference = 0;
+				for (size_t i = 0; i < count; i++)
+					difference += (uint64_t)std::abs((int)threaded[i] - (int)reference[i]);
+				result.meanDifference = (double)difference / count;
+			}
+			else {
+				std::cout << "JPEG benchmark: " << path << " not supported by the SIMD decoder" << std::endl;
+			}
+			std::free(single);
+			std::free(threaded);
+			stbi_image_free(reference);
+
+			std::cout << "JPEG benchmark " << path << " (" << result.width << "x" << result.height
+				<< (result.progressive ? ", progressive" : ", baseline") << ", restart interval " << result.restartInterval
+				<< "): stbi " << result.stbiMegabytesPerSecond << " MB/s, SIMD " << result.singleMegabytesPerSecond
+				<< " MB/s, SIMD threaded " << result.threadedMegabytesPerSecond << " MB/s, mean difference "
+				<< result.meanDifference << std::endl;
+			results.push_back(result);
+		}
+		return results;
+	}
+
+}
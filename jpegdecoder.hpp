@@ -0,0 +1,49 @@
+#pragma once
+#include "threadpool.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	// Backend con el que loadImage() decodifica los JPEG
+	enum class ImageDecoder {
+		Stbi,  // stbi_load, un hilo
+		Simd   // decodeJpeg(): IDCT y color con SIMD, repartido en el pool
+	};
+
+	void setImageDecoder(ImageDecoder decoder);
+	ImageDecoder imageDecoder();
+
+	// Igual que stbi_load con stbi_set_flip_vertically_on_load(true), que es como carga
+	// las imágenes todo el proyecto. Con ImageDecoder::Simd los JPEG Huffman de 8 bits
+	// (baseline o progresivos, gris o YCbCr) pasan por decodeJpeg(); el resto, y los JPEG
+	// que no soporta, por stbi. El resultado se libera con freeImage().
+	unsigned char* loadImage(const char* path, int* width, int* height, int* channels, int desiredChannels);
+	void freeImage(unsigned char* pixels);
+
+	// Decodifica un JPEG en memoria. channels recibe los canales de la imagen (1 o 3) y
+	// desiredChannels (0..4) fija los de la salida, como en stbi. La entropía es
+	// secuencial salvo que el fichero tenga restart markers: entonces cada intervalo se
+	// decodifica en un hilo. IDCT, upsampling del croma y conversión a RGB se reparten
+	// siempre por filas en el pool. Devuelve nullptr si el formato no está soportado;
+	// la memoria es de malloc, compatible con freeImage().
+	unsigned char* decodeJpeg(const unsigned char* data, size_t size, int* width, int* height, int* channels,
+		int desiredChannels, bool flipVertically, ThreadPool* pool);
+
+	// Velocidad de decodificación de cada fichero (MB/s de píxeles de salida) con stbi y
+	// con decodeJpeg en un hilo y en el pool, y la diferencia media por canal con stbi
+	struct JpegBenchmarkResult {
+		std::string path;
+		int width = 0, height = 0;
+		bool progressive = false;
+		int restartInterval = 0;
+		double stbiMegabytesPerSecond = 0.0;
+		double singleMegabytesPerSecond = 0.0;
+		double threadedMegabytesPerSecond = 0.0;
+		double meanDifference = 0.0;
+	};
+
+	std::vector<JpegBenchmarkResult> benchmarkJpegDecode(const std::vector<std::string>& paths, ThreadPool* pool);
+
+}
@@ -9,11 +9,34 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include "myopengl.hpp"
+#include "shader.hpp"
+#include "ringbuffer.hpp"
+#include "texture.hpp"
+#include "renderqueue.hpp"
+#include "culling.hpp"
+#include "transforms.hpp"
+#include "framescheduler.hpp"
+#include "textureloader.hpp"
+#include "texturecontainer.hpp"
+#include "mipmaps.hpp"
+#include "texturestreamer.hpp"
+#include "texturestorage.hpp"
+#include "jpegdecoder.hpp"
+#include "textureatlas.hpp"
+#include "texturemanager.hpp"
+#include "filewatcher.hpp"
+#include "blendcache.hpp"
+#include "materialtable.hpp"
+#include "splatmap.hpp"
+#include "indirectdraw.hpp"
+#include "gpuculling.hpp"
 #include <vector>
 #include <string>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <filesystem>
 
 
 using namespace myopengl;
@@ -27,8 +50,23 @@ glm::vec3 wasd_Movement = { 0.0f, 0.0f, 0.0f };
 int m_CurrentView = 0;
 
 float movementSpeed = 5.0f; // Velocidad base de movimiento
-float lastFrame = 0.0f;
-float deltaTime = 0.0f; // Tiempo entre frames
+
+// Estado que avanza en pasos fijos; el render interpola entre el paso anterior y el actual
+struct SimulationState {
+    glm::vec3 movement;
+    float yaw;
+    float pitch;
+    float angle; // rotacin comn de la escena
+};
+
+SimulationState interpolate(const SimulationState& a, const SimulationState& b, float t) {
+    SimulationState result;
+    result.movement = a.movement + (b.movement - a.movement) * t;
+    result.yaw = a.yaw + (b.yaw - a.yaw) * t;
+    result.pitch = a.pitch + (b.pitch - a.pitch) * t;
+    result.angle = a.angle + (b.angle - a.angle) * t;
+    return result;
+}
 
 // Modified vertices with texture coordinates
 GLfloat vertices[] = {
@@ -57,104 +95,40 @@ GLuint indices[] = {
 };
 
 // Updated vertex shader to handle textures
-const char* vertexShaderSource = R"(
-#version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aColor;
-layout (location = 2) in vec2 aTexCoord;
-
-out vec3 Color;
-out vec2 TexCoord;
-
-uniform mat4 transform;
-
-void main() {
-    gl_Position = transform * vec4(aPos, 1.0);
-    Color = aColor;
-    TexCoord = aTexCoord;
-})";
-
-// Updated fragment shader to handle multiple textures
-const char* fragmentShaderSource = R"(
-#version 330 core
-in vec3 Color;
-in vec2 TexCoord;
-
-out vec4 FragColor;
-
-uniform sampler2D texture1;
-uniform sampler2D texture2;
-uniform sampler2D texture3;
-uniform float mixRatio1;
-uniform float mixRatio2;
-uniform float mixRatio3;
-uniform bool useMultiTexture;
-uniform bool useTexture;
-
-void main() {
-    if(useTexture) {
-        if(useMultiTexture) {
-            // Combinacin de mltiples texturas
-            vec4 tex1 = texture(texture1, TexCoord) * mixRatio1;
-            vec4 tex2 = texture(texture2, TexCoord) * mixRatio2;
-            vec4 tex3 = texture(texture3, TexCoord) * mixRatio3;
-            
-            // Normalizacin de los ratios para asegurar que la suma es 1.0
-            float totalRatio = mixRatio1 + mixRatio2 + mixRatio3;
-            if (totalRatio > 0.0) {
-                tex1 *= (mixRatio1 / totalRatio);
-                tex2 *= (mixRatio2 / totalRatio);
-                tex3 *= (mixRatio3 / totalRatio);
-            }
-            
-            FragColor = tex1 + tex2 + tex3;
-        } else {
-            // Uso de una sola textura
-            FragColor = texture(texture1, TexCoord);
-        }
-    } else {
-        // Sin textura, solo color
-        FragColor = vec4(Color, 1.0);
-    }
-})";
-
-// Function to load a texture from file
-unsigned int loadTexture(const char* path) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true); // Flip textures on load
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-
-    if (data) {
-        GLenum format;
-        if (nrChannels == 1)
-            format = GL_RED;
-        else if (nrChannels == 3)
-            format = GL_RGB;
-        else if (nrChannels == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // Set texture parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else {
-        std::cout << "Failed to load texture at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+const char* const objectVertexShaderPath = "shaders/object.vert";
 
-    return textureID;
-}
+// Fragment shader por objeto, compilado en variantes segn los #define de fragmentDefines():
+//   TEXTURED      usa texture1
+//   MULTITEXTURE  mezcla LAYER_COUNT texturas (1..3) con mixRatios
+//   TEXTURE_ARRAY las texturas son capas de un sampler2DArray elegidas con material.xyz
+//   ATLAS         las texturas son rectngulos de las pginas de un TextureAtlas
+// Sin defines solo usa el color de los vrtices.
+const char* const objectFragmentShaderPath = "shaders/object.frag";
+
+// Instanced vertex shader: model matrix and material come from the instance buffer
+const char* const instancedVertexShaderPath = "shaders/instanced.vert";
+
+// Instanced fragment shader: same blending as the object fragment shader, but the
+// textures are picked per instance from all the bound units, from the layers
+// of a sampler2DArray when compiled with TEXTURE_ARRAY, or from the atlas
+// rectangles when compiled with ATLAS
+const char* const instancedFragmentShaderPath = "shaders/instanced.frag";
+
+// Vertex shader del modo indirecto: matriz y material de cada draw salen de storage
+// buffers indexados con gl_DrawID; el fragment shader es el instanciado
+const char* const indirectVertexShaderPath = "shaders/indirect.vert";
+
+// Culling en GPU del modo indirecto: compute shader que escribe los comandos y el que
+// reduce la pirmide de profundidad para el test de oclusin
+const char* const cullComputeShaderPath = "shaders/cull.comp";
+const char* const depthPyramidComputeShaderPath = "shaders/depthpyramid.comp";
+
+// Tringulo de pantalla completa y mezcla de capas para cocinar la multitextura (BlendCache)
+const char* const bakeVertexShaderPath = "shaders/bake.vert";
+const char* const bakeFragmentShaderPath = "shaders/bake.frag";
+
+// Pesos del splat map del suelo; si no existe se generan con ruido
+const char* const splatMapPath = "textures/splat.png";
 
 // Estructura para manejar la configuracin de multitextura
 struct MultiTextureConfig {
@@ -167,7 +141,450 @@ struct MultiTextureConfig {
     float mixRatio3;
 };
 
-int main() {
+// Estado de cada objeto de la escena (cubos y tubos comparten la geometra del cubo)
+struct SceneObject {
+    glm::vec3 position;
+    glm::vec3 scale;
+    int texture;
+    bool useTexture;
+    MultiTextureConfig multiTex;
+    SplatConfig splat = {};
+    int material = -1;  // ndice en la MaterialTable
+};
+
+// Datos por instancia que se suben al instance buffer (locations 3..8).
+// El layout coincide con el bloque std140 ObjectData del modo por objeto.
+struct InstanceData {
+    glm::mat4 model;
+    GLint material[4];     // texIndex1, texIndex2, texIndex3, flags
+    glm::vec4 mixRatios;
+};
+
+// Material de un draw del modo indirecto: InstanceData sin la matriz (std430 DrawMaterials)
+struct DrawMaterial {
+    GLint material[4];
+    glm::vec4 mixRatios;
+};
+
+// Datos de cmara del bloque std140 FrameData
+struct FrameData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+};
+
+// Binding points de los uniform blocks
+const GLuint FRAME_DATA_BINDING = 0;
+const GLuint OBJECT_DATA_BINDING = 1;
+const GLuint ATLAS_DATA_BINDING = 2;
+
+// Unidad del array de mezclas cocinadas; las 0..7 son las de los materiales
+const GLuint BAKED_TEXTURE_UNIT = 8;
+// Capas (el texture array) y mapa de pesos de los materiales con splat map
+const GLuint SPLAT_LAYERS_TEXTURE_UNIT = 9;
+const GLuint SPLAT_WEIGHTS_TEXTURE_UNIT = 10;
+
+// Binding points de los shader storage blocks de la MaterialTable
+const GLuint MATERIAL_RANGES_BINDING = 0;
+const GLuint MATERIAL_LAYERS_BINDING = 1;
+// Y los del modo indirecto
+const GLuint DRAW_RECORDS_BINDING = 2;
+const GLuint DRAW_TRANSFORMS_BINDING = 3;
+const GLuint DRAW_MATERIALS_BINDING = 4;
+// Comandos y registros que escribe el culling en GPU (5 y 6)
+const GLuint CULLED_OUTPUT_BINDING = 5;
+// Atributo con el ndice del draw cuando no hay gl_DrawIDARB
+const GLuint DRAW_ID_ATTRIBUTE_LOCATION = 9;
+
+// Bits de la clave de variante del fragment shader por objeto; bits 2-3 = LAYER_COUNT
+enum FragmentFeatures {
+    FRAGMENT_TEXTURED = 1,
+    FRAGMENT_MULTITEXTURE = 2,
+    FRAGMENT_TEXTURE_ARRAY = 16,
+    FRAGMENT_ATLAS = 32,
+    FRAGMENT_BAKED = 64,
+    FRAGMENT_MATERIAL_TABLE = 128,
+    FRAGMENT_SPLAT = 256
+};
+
+// De dnde salen las texturas de los materiales
+enum MaterialSource {
+    MATERIALS_TEXTURES,  // una textura por material, enlazadas en unidades distintas
+    MATERIALS_ARRAY,     // capas de un GL_TEXTURE_2D_ARRAY
+    MATERIALS_ATLAS      // rectngulos de las pginas de un TextureAtlas
+};
+
+const char* const materialSourceNames[] = { "Separate Textures", "Texture Array", "Atlas" };
+
+// Bits de la variante del fragment shader que corresponden a cada origen
+unsigned materialFeatures(int source) {
+    if (source == MATERIALS_ARRAY)
+        return FRAGMENT_TEXTURE_ARRAY;
+    if (source == MATERIALS_ATLAS)
+        return FRAGMENT_ATLAS;
+    return 0;
+}
+
+enum InstanceFlags {
+    INSTANCE_USE_TEXTURE = 1,
+    INSTANCE_USE_MULTITEXTURE = 2,
+    INSTANCE_BAKED = 4,  // material.x es la capa de la mezcla en el BlendCache
+    INSTANCE_SPLAT = 8   // material.xyz y mixRatios.w son las capas del splat map, mixRatios.x la repeticin
+};
+
+// Matriz de modelo de un objeto: escala, traslacin y la rotacin comn de la escena
+glm::mat4 objectModel(const SceneObject& object, float angle) {
+    glm::mat4 model = scale(object.scale);
+    model = glm::translate(model, object.position);
+    return glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) * model;
+}
+
+// Copia posicin y escala de los objetos al sistema de transformaciones
+void syncTransforms(const std::vector<SceneObject>& objects, TransformSystem& transforms) {
+    transforms.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        transforms.set(i, objects[i].position, objects[i].scale);
+    }
+}
+
+// Esfera envolvente en mundo de cada objeto: el cubo unidad escalado cabe en una esfera de
+// radio 0.5 * |escala| centrada en la traslacin de su matriz de modelo
+void updateBounds(const std::vector<SceneObject>& objects, const TransformSystem& transforms, BoundingSpheres& bounds) {
+    bounds.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        bounds.set(i, transforms.translation(i), 0.5f * glm::length(objects[i].scale));
+    }
+}
+
+// Tamao en pantalla (pxeles de lado) de cada textura: el mayor entre los objetos
+// visibles que la usan. pixelsPerUnit es la altura del framebuffer entre tan(fov / 2).
+void requestTextureResolution(const std::vector<SceneObject>& objects, const std::vector<uint32_t>& visible,
+    const BoundingSpheres& bounds, const glm::mat4& view, float pixelsPerUnit,
+    const std::vector<TextureHandle>& textures, const TextureManager& manager, std::vector<float>& screenSize,
+    TextureStreamer& streamer) {
+    screenSize.assign(textures.size(), 0.0f);
+    for (uint32_t i : visible) {
+        const SceneObject& object = objects[i];
+        if (!object.useTexture)
+            continue;
+        glm::vec4 viewPosition = view * glm::vec4(bounds.x()[i], bounds.y()[i], bounds.z()[i], 1.0f);
+        float distance = std::max(-viewPosition.z, 0.1f);
+        float size = bounds.radius()[i] * pixelsPerUnit / distance;
+        if (object.multiTex.useMultiTexture) {
+            screenSize[object.multiTex.texIndex1] = std::max(screenSize[object.multiTex.texIndex1], size);
+            screenSize[object.multiTex.texIndex2] = std::max(screenSize[object.multiTex.texIndex2], size);
+            screenSize[object.multiTex.texIndex3] = std::max(screenSize[object.multiTex.texIndex3], size);
+        }
+        else {
+            screenSize[object.texture] = std::max(screenSize[object.texture], size);
+        }
+    }
+    for (size_t t = 0; t < textures.size(); t++) {
+        if (screenSize[t] > 0.0f)
+            streamer.request(manager.texture(textures[t]), screenSize[t]);
+    }
+}
+
+// Modos de filtrado de las texturas de material; cada uno es un sampler de la cach
+const char* const textureFilteringNames[] = { "Nearest", "Bilinear", "Trilinear", "Anisotropic 16x" };
+
+SamplerState samplerForFiltering(int mode) {
+    SamplerState state;
+    if (mode == 0) {
+        state.minFilter = GL_NEAREST_MIPMAP_NEAREST;
+        state.magFilter = GL_NEAREST;
+    }
+    else if (mode == 1) {
+        state.minFilter = GL_LINEAR_MIPMAP_NEAREST;
+    }
+    else if (mode == 3) {
+        state.maxAnisotropy = std::min(16.0f, maxSupportedAnisotropy());
+    }
+    return state;
+}
+
+// Tiempo medio por frame de las matrices de modelo: cadena de glm::mat4 por objeto frente
+// al sistema SoA en un hilo y repartido en el pool
+struct TransformBenchmark {
+    double glmMilliseconds = 0.0;
+    double soaMilliseconds = 0.0;
+    double soaThreadedMilliseconds = 0.0;
+    size_t objectCount = 0;
+};
+
+TransformBenchmark benchmarkTransforms(const std::vector<SceneObject>& objects, TransformSystem& transforms, float angle) {
+    const int iterations = 20;
+    typedef std::chrono::high_resolution_clock Clock;
+    TransformBenchmark result;
+    result.objectCount = objects.size();
+
+    std::vector<glm::mat4> models(objects.size());
+    Clock::time_point start = Clock::now();
+    for (int k = 0; k < iterations; k++) {
+        for (size_t i = 0; i < objects.size(); i++) {
+            models[i] = objectModel(objects[i], angle + k * 0.01f);
+        }
+    }
+    Clock::time_point glmEnd = Clock::now();
+    for (int k = 0; k < iterations; k++) {
+        transforms.update(angle + k * 0.01f);
+    }
+    Clock::time_point soaEnd = Clock::now();
+    for (int k = 0; k < iterations; k++) {
+        transforms.update(angle + k * 0.01f, &ThreadPool::shared());
+    }
+    Clock::time_point threadedEnd = Clock::now();
+
+    result.glmMilliseconds = std::chrono::duration<double, std::milli>(glmEnd - start).count() / iterations;
+    result.soaMilliseconds = std::chrono::duration<double, std::milli>(soaEnd - glmEnd).count() / iterations;
+    result.soaThreadedMilliseconds = std::chrono::duration<double, std::milli>(threadedEnd - soaEnd).count() / iterations;
+
+    // Comprobar que ambos caminos dan la misma matriz (con el ltimo ngulo usado)
+    float maxError = 0.0f;
+    for (size_t i = 0; i < objects.size(); i++) {
+        glm::mat4 expected = models[i];
+        glm::mat4 actual = transforms.model(i);
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                maxError = std::max(maxError, std::fabs(expected[c][r] - actual[c][r]));
+    }
+
+    std::cout << "Transform benchmark (" << result.objectCount << " objects): glm " << result.glmMilliseconds
+        << " ms, SoA " << result.soaMilliseconds << " ms, SoA + " << ThreadPool::shared().size() << " workers "
+        << result.soaThreadedMilliseconds << " ms, max error " << maxError << std::endl;
+    return result;
+}
+
+// Rellena el bloque de instancia con la matriz y el material de un objeto. Con bakedLayer
+// la multitextura sale de esa capa del BlendCache en vez de mezclarse en el shader.
+InstanceData makeInstance(const SceneObject& object, const glm::mat4& model, int bakedLayer = -1, bool splat = false) {
+    InstanceData instance;
+    instance.model = model;
+
+    if (splat) {
+        instance.material[0] = object.splat.layers[0];
+        instance.material[1] = object.splat.layers[1];
+        instance.material[2] = object.splat.layers[2];
+        instance.material[3] = INSTANCE_USE_TEXTURE | INSTANCE_SPLAT;
+        instance.mixRatios = glm::vec4(object.splat.tiling, 0.0f, 0.0f, (float)object.splat.layers[3]);
+        return instance;
+    }
+
+    int flags = object.useTexture ? INSTANCE_USE_TEXTURE : 0;
+    if (object.useTexture && object.multiTex.useMultiTexture) {
+        flags |= INSTANCE_USE_MULTITEXTURE;
+        instance.material[0] = object.multiTex.texIndex1;
+        instance.material[1] = object.multiTex.texIndex2;
+        instance.material[2] = object.multiTex.texIndex3;
+        if (bakedLayer >= 0) {
+            flags |= INSTANCE_BAKED;
+            instance.material[0] = bakedLayer;
+        }
+    }
+    else {
+        instance.material[0] = object.texture;
+        instance.material[1] = object.texture;
+        instance.material[2] = object.texture;
+    }
+    instance.material[3] = flags;
+    instance.mixRatios = glm::vec4(object.multiTex.mixRatio1, object.multiTex.mixRatio2, object.multiTex.mixRatio3, 0.0f);
+    return instance;
+}
+
+// Capa del BlendCache con la mezcla de un objeto multitextura; -1 si no tiene mezcla o no
+// cabe en la cach. Los ndices de textura son las capas del texture array.
+int bakedBlendLayer(const SceneObject& object, BlendCache& cache) {
+    if (!object.useTexture || !object.multiTex.useMultiTexture)
+        return -1;
+    const int layers[3] = { object.multiTex.texIndex1, object.multiTex.texIndex2, object.multiTex.texIndex3 };
+    const float ratios[3] = { object.multiTex.mixRatio1, object.multiTex.mixRatio2, object.multiTex.mixRatio3 };
+    return cache.get(makeBlendKey(layers, ratios));
+}
+
+// Variante del fragment shader que necesita un objeto
+unsigned fragmentPermutation(const SceneObject& object) {
+    if (!object.useTexture)
+        return 0;
+    if (!object.multiTex.useMultiTexture)
+        return FRAGMENT_TEXTURED;
+
+    // Las capas finales con ratio 0 no aportan nada a la mezcla
+    unsigned layers = 3;
+    if (object.multiTex.mixRatio3 == 0.0f) {
+        layers = object.multiTex.mixRatio2 == 0.0f ? 1 : 2;
+    }
+    return FRAGMENT_TEXTURED | FRAGMENT_MULTITEXTURE | (layers << 2);
+}
+
+std::string fragmentDefines(unsigned key) {
+    std::string defines;
+    if (key & FRAGMENT_TEXTURED)
+        defines += "#define TEXTURED\n";
+    if (key & FRAGMENT_MULTITEXTURE)
+        defines += "#define MULTITEXTURE\n#define LAYER_COUNT " + std::to_string((key >> 2) & 3) + "\n";
+    if (key & FRAGMENT_TEXTURE_ARRAY)
+        defines += "#define TEXTURE_ARRAY\n";
+    if (key & FRAGMENT_ATLAS)
+        defines += "#define ATLAS\n#define ATLAS_MAX_ENTRIES " + std::to_string(TextureAtlas::MaxEntries) + "\n";
+    if (key & FRAGMENT_BAKED)
+        defines += "#define BAKED\n";
+    if (key & FRAGMENT_MATERIAL_TABLE)
+        defines += "#define MATERIAL_TABLE\n";
+    if (key & FRAGMENT_SPLAT)
+        defines += "#define SPLAT\n";
+    return defines;
+}
+
+// Compara una ruta del FileWatcher con una de las constantes de shaders
+bool samePath(const std::string& a, const char* b) {
+    return std::filesystem::path(a).lexically_normal() == std::filesystem::path(b).lexically_normal();
+}
+
+// Vuelve a leer los shaders de un conjunto de variantes y recompila solo las ya usadas;
+// si el cdigo nuevo no compila se sigue dibujando con el anterior
+bool reloadShaderPrograms(ProgramPermutations& programs, const char* vertexPath, const char* fragmentPath) {
+    std::string vertex = loadShaderSource(vertexPath);
+    std::string fragment = loadShaderSource(fragmentPath);
+    if (vertex.empty() || fragment.empty())
+        return false;
+    if (!programs.reload(vertex, fragment))
+        return false;
+    std::cout << "Reloaded " << vertexPath << " + " << fragmentPath << " (" << programs.size() << " permutations)" << std::endl;
+    return true;
+}
+
+// Deja el material de un objeto de la escena en la MaterialTable igual que su textura o
+// su multitextura, con los pesos que usan los shaders (ratio * ratio / suma de ratios)
+void syncObjectMaterial(SceneObject& object, MaterialTable& table) {
+    MaterialLayer layers[3];
+    int count = 0;
+    if (object.multiTex.useMultiTexture) {
+        const int textures[3] = { object.multiTex.texIndex1, object.multiTex.texIndex2, object.multiTex.texIndex3 };
+        const float ratios[3] = { object.multiTex.mixRatio1, object.multiTex.mixRatio2, object.multiTex.mixRatio3 };
+        BlendKey blend = makeBlendKey(textures, ratios);
+        for (int i = 0; i < 3; i++) {
+            if (blend.weights[i] > 0.0f) {
+                layers[count].texture = blend.layers[i];
+                layers[count].weight = blend.weights[i];
+                count++;
+            }
+        }
+    }
+    else {
+        layers[0].texture = object.texture;
+        count = 1;
+    }
+
+    if (object.material < 0)
+        object.material = table.add(layers, count);
+    else
+        table.set(object.material, layers, count);
+}
+
+// Materiales de 1 a 4 capas con pesos pseudoaleatorios para los cubos extra: con la
+// tabla de materiales cada cubo tiene su propia mezcla
+void addStressMaterials(std::vector<SceneObject>& objects, size_t baseCount, MaterialTable& table, size_t baseMaterials) {
+    table.resize(baseMaterials);
+    for (size_t i = baseCount; i < objects.size(); i++) {
+        uint32_t hash = (uint32_t)i * 2654435761u;
+        int count = 1 + (int)((hash >> 28) % 4);
+        MaterialLayer layers[4];
+        float total = 0.0f;
+        for (int l = 0; l < count; l++) {
+            hash = hash * 1664525u + 1013904223u;
+            layers[l].texture = (int)((hash >> 16) % 5);
+            layers[l].weight = 0.25f + (hash >> 24) / 255.0f;
+            total += layers[l].weight;
+        }
+        for (int l = 0; l < count; l++)
+            layers[l].weight /= total;
+        objects[i].material = table.add(layers, count);
+    }
+}
+
+// Uniform blocks, samplers y storage blocks de los programas que usan instanced.frag
+void setupInstancedProgram(Program& program) {
+    program.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    program.bindUniformBlock("AtlasData", ATLAS_DATA_BINDING);
+    program.use();
+    GLint textureUnits[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    program.set(program.uniform<int>("textures"), textureUnits, 8);
+    program.set(program.uniform<int>("materials"), 0);
+    program.set(program.uniform<int>("atlas"), 0);
+    program.set(program.uniform<int>("bakedMaterials"), BAKED_TEXTURE_UNIT);
+    program.set(program.uniform<int>("splatLayers"), SPLAT_LAYERS_TEXTURE_UNIT);
+    program.set(program.uniform<int>("splatWeights"), SPLAT_WEIGHTS_TEXTURE_UNIT);
+    program.bindStorageBlock("MaterialRanges", MATERIAL_RANGES_BINDING);
+    program.bindStorageBlock("MaterialLayers", MATERIAL_LAYERS_BINDING);
+    program.bindStorageBlock("DrawRecords", DRAW_RECORDS_BINDING);
+    program.bindStorageBlock("DrawTransforms", DRAW_TRANSFORMS_BINDING);
+    program.bindStorageBlock("DrawMaterials", DRAW_MATERIALS_BINDING);
+}
+
+// Cubos extra en una rejilla para medir el rendimiento con muchos objetos
+void addStressObjects(std::vector<SceneObject>& objects, size_t baseCount, int count) {
+    objects.resize(baseCount);
+    int side = 1;
+    while (side * side * side < count) side++;
+
+    const float spacing = 1.5f;
+    float offset = (side - 1) * spacing * 0.5f;
+    for (int i = 0; i < count; i++) {
+        int x = i % side;
+        int y = (i / side) % side;
+        int z = i / (side * side);
+
+        SceneObject object;
+        object.position = glm::vec3(x * spacing - offset, y * spacing - offset - 8.0f, z * spacing - offset);
+        object.scale = glm::vec3(0.5f, 0.5f, 0.5f);
+        object.texture = i % 5;
+        object.useTexture = true;
+        object.multiTex = { false, i % 5, (i + 1) % 5, (i + 2) % 5, 1.0f, 0.0f, 0.0f };
+        objects.push_back(object);
+    }
+}
+
+// Atributos de vrtice del cubo (posicin, color, coordenadas de textura)
+void setupCubeAttributes() {
+    // Position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    // Color attribute
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    // Texture coord attribute
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+}
+
+// Atributos por instancia (divisor 1) ledos del instance buffer actualmente enlazado,
+// empezando en baseOffset (la regin del ring buffer de este frame)
+void setupInstanceAttributes(GLintptr baseOffset) {
+    for (int column = 0; column < 4; column++) {
+        GLuint location = 3 + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(baseOffset + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glVertexAttribIPointer(7, 4, GL_INT, sizeof(InstanceData), (void*)(baseOffset + offsetof(InstanceData, material)));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+
+    glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(baseOffset + offsetof(InstanceData, mixRatios)));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+}
+
+int main(int argc, char** argv) {
+    // "--convert-textures [--compress]" convierte textures/ a contenedores .mtex y sale
+    if (argc > 1 && std::string(argv[1]) == "--convert-textures") {
+        bool compress = argc > 2 && std::string(argv[2]) == "--compress";
+        int converted = convertTextureFolder("textures", compress);
+        std::cout << converted << " textures converted" << std::endl;
+        return converted > 0 ? 0 : 1;
+    }
+
     if (!glfwInit()) return -1;
 
     GLFWwindow* window = glfwCreateWindow(1400, 1200, "Main Screen", NULL, NULL);
@@ -183,11 +600,12 @@ int main() {
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
-    static double limitFPS = 1.0 / 60.0;
 
-    double lastTime = glfwGetTime(), timer = lastTime;
-    double deltaTime = 0, nowTime = 0;
-    int frames = 0, updates = 0;
+    // Simulacin a 60 Hz fijos; el lmite de FPS es opcional
+    FrameScheduler scheduler(60.0);
+    bool limitFPS = true;
+    int fpsLimit = 60;
+    scheduler.setFrameLimit(fpsLimit);
 
     // Setup Dear ImGui style
     ImGui::StyleColorsDark();
@@ -198,6 +616,9 @@ int main() {
 
     glEnable(GL_DEPTH_TEST);  // Activar Z-Buffer
 
+    // Los programas ya compilados en ejecuciones anteriores se cargan como binario
+    enableProgramBinaryCache("shader_cache");
+
     // Crear VAO, VBO y EBO
     GLuint VAO, VBO, EBO;
     glGenVertexArrays(1, &VAO);
@@ -210,63 +631,172 @@ int main() {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // Texture coord attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    setupCubeAttributes();
 
-    // Crear y compilar los shaders
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    // Check for shader compile errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+    // Ring buffers de streaming: uniform blocks por frame/objeto y datos de instancia
+    RingBuffer uniformRing;
+    uniformRing.create(GL_UNIFORM_BUFFER, 64 * 1024);
+    RingBuffer instanceRing;
+    instanceRing.create(GL_ARRAY_BUFFER, 64 * 1024);
 
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+    GLint uniformAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    // Cada objeto ocupa un bloque ObjectData alineado al offset mnimo de glBindBufferRange
+    size_t objectStride = alignUp(sizeof(InstanceData), uniformAlignment);
+    size_t frameStride = alignUp(sizeof(FrameData), uniformAlignment);
 
-    // Check for shader compile errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+    // VAO para el modo instanciado: misma geometra del cubo ms el instance buffer
+    GLuint instancedVAO;
+    glGenVertexArrays(1, &instancedVAO);
 
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    glBindVertexArray(instancedVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    setupCubeAttributes();
+    glBindBuffer(GL_ARRAY_BUFFER, instanceRing.id());
+    setupInstanceAttributes(0);
+    glBindVertexArray(0);
+
+    // Crear y compilar los shaders. Las variantes por objeto se compilan al pedirlas
+    // y dejan fijos sus uniform blocks y unidades de textura.
+    // Los shaders se leen de shaders/ para poder editarlos sin reiniciar
+    ProgramPermutations objectPrograms;
+    objectPrograms.setSources(loadShaderSource(objectVertexShaderPath).c_str(),
+        loadShaderSource(objectFragmentShaderPath).c_str(), fragmentDefines, [](Program& program) {
+        program.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+        program.bindUniformBlock("ObjectData", OBJECT_DATA_BINDING);
+        program.bindUniformBlock("AtlasData", ATLAS_DATA_BINDING);
+        program.use();
+        program.set(program.uniform<int>("texture1"), 0);
+        program.set(program.uniform<int>("texture2"), 1);
+        program.set(program.uniform<int>("texture3"), 2);
+        program.set(program.uniform<int>("materials"), 0);
+        program.set(program.uniform<int>("atlas"), 0);
+        program.set(program.uniform<int>("bakedMaterials"), BAKED_TEXTURE_UNIT);
+        program.set(program.uniform<int>("splatLayers"), SPLAT_LAYERS_TEXTURE_UNIT);
+        program.set(program.uniform<int>("splatWeights"), SPLAT_WEIGHTS_TEXTURE_UNIT);
+    });
+    // Compilar de antemano las variantes de la escena inicial
+    objectPrograms.get(0);
+    objectPrograms.get(FRAGMENT_TEXTURED);
+    objectPrograms.get(FRAGMENT_TEXTURED | FRAGMENT_MULTITEXTURE | (1 << 2));
+
+    // Programa instanciado: unidades de textura sueltas o, con FRAGMENT_TEXTURE_ARRAY o
+    // FRAGMENT_ATLAS, un sampler2DArray
+    ProgramPermutations instancedPrograms;
+    instancedPrograms.setSources(loadShaderSource(instancedVertexShaderPath).c_str(),
+        loadShaderSource(instancedFragmentShaderPath).c_str(), fragmentDefines, setupInstancedProgram);
+    instancedPrograms.get(0);
+    instancedPrograms.get(FRAGMENT_TEXTURE_ARRAY);
+
+    // Modo indirecto (GL 4.3): toda la lista de draws con un glMultiDrawElementsIndirect.
+    // Cada draw puede ser una malla distinta de los buffers compartidos; en esta escena
+    // los tubos son cubos escalados, as que todos usan el rango del cubo.
+    const bool indirectDrawSupported = IndirectDrawList::supported();
+    const bool drawParametersSupported = IndirectDrawList::drawParametersSupported();
+    bool useIndirectDraw = false;
+    const MeshRange cubeMesh = { 36, 0, 0 };
+    IndirectDrawList indirectDraws;
+    ProgramPermutations indirectPrograms;
+    RingBuffer storageRing;
+    GLint storageAlignment = 256;
+    GLuint indirectVAO = 0;
+    if (indirectDrawSupported) {
+        indirectPrograms.setSources(loadShaderSource(indirectVertexShaderPath).c_str(),
+            loadShaderSource(instancedFragmentShaderPath).c_str(), [drawParametersSupported](unsigned key) {
+            return fragmentDefines(key) + (drawParametersSupported ? "" : "#define DRAW_ID_ATTRIBUTE\n");
+        }, setupInstancedProgram);
+        // Matrices y materiales de los draws, escritos cada frame
+        storageRing.create(GL_SHADER_STORAGE_BUFFER, 64 * 1024);
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+
+        glGenVertexArrays(1, &indirectVAO);
+        glBindVertexArray(indirectVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        setupCubeAttributes();
+        if (!drawParametersSupported)
+            indirectDraws.setupDrawIdAttribute(DRAW_ID_ATTRIBUTE_LOCATION);
+        glBindVertexArray(0);
+    }
 
-    // Check for linking errors
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    // Culling en GPU: con el modo indirecto, la CPU solo escribe matrices y materiales de
+    // todos los objetos y un compute shader decide qu se dibuja
+    const bool gpuCullingSupported = indirectDrawSupported && GpuCuller::supported();
+    bool useGpuCulling = false;
+    bool useOcclusionCulling = false;
+    GpuCuller gpuCuller(DRAW_TRANSFORMS_BINDING, CULLED_OUTPUT_BINDING);
+    if (gpuCullingSupported) {
+        gpuCuller.setPrograms(loadShaderSource(cullComputeShaderPath).c_str(),
+            loadShaderSource(depthPyramidComputeShaderPath).c_str());
     }
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    const ProgramCacheStats& programCache = programBinaryCacheStats();
+    std::cout << "Program cache: " << programCache.hits << " hits, " << programCache.misses << " compiled, "
+        << programCache.rejected << " rejected, " << programCache.millisecondsSaved << " ms saved" << std::endl;
 
     // Load textures
-    std::vector<unsigned int> textures;
-    textures.push_back(loadTexture("textures/wood.jpg"));     // Texture 0
-    textures.push_back(loadTexture("textures/metal.jpg"));    // Texture 1
-    textures.push_back(loadTexture("textures/concrete.jpg")); // Texture 2
-    textures.push_back(loadTexture("textures/grass.jpeg"));   // Texture 3
-    textures.push_back(loadTexture("textures/stone.jpeg"));    // Texture 4
+    // Los JPEG se decodifican con IDCT/color SIMD repartidos en el pool (stbi para el resto)
+    const char* imageDecoderNames[] = { "stb_image", "SIMD + threads" };
+    int imageDecoderMode = (int)imageDecoder();
+    // Se decodifican en los workers; hasta que se suben en el loop se ven en gris
+    AsyncTextureLoader textureLoader(ThreadPool::shared());
+    // Cadenas de mips en BC1/BC3, comprimidas una vez y guardadas por hash del fichero
+    textureLoader.enableCompression("texture_cache");
+    // Las texturas sueltas se sirven por niveles: primero los mips pequeos y luego los
+    // que pida el tamao en pantalla de los objetos, dentro del presupuesto de VRAM
+    int textureBudgetMB = 64;
+    TextureStreamer textureStreamer(ThreadPool::shared(), (size_t)textureBudgetMB << 20, "texture_cache", true);
+    std::vector<float> textureScreenSize;
+    // Ninguna textura guarda filtro ni wrap: todas usan el sampler del modo elegido
+    SamplerCache samplers;
+    int textureFiltering = 2;
+    GLuint boundSampler = 0;
+    // Una textura por fichero (o por contenido) aunque varios materiales la pidan; se
+    // borra al soltar su ltima referencia
+    TextureManager textureManager(
+        [&textureStreamer](const std::string& path) { return textureStreamer.add(path); },
+        [&textureStreamer](GLuint texture) {
+            textureStreamer.remove(texture);
+            glDeleteTextures(1, &texture);
+        });
+    // Los objetos guardan el ndice del material; cada material, el handle de su textura
+    const std::vector<std::string> materialPaths = { "textures/wood.jpg", "textures/metal.jpg", "textures/concrete.jpg",
+        "textures/grass.jpeg", "textures/stone.jpeg" };
+    std::vector<TextureHandle> textures;
+    for (const std::string& path : materialPaths)
+        textures.push_back(textureManager.acquire(path));
+
+    // Las mismas texturas como capas de un GL_TEXTURE_2D_ARRAY (capa = ndice de textura)
+    int materialLayerWidth = 0, materialLayerHeight = 0;
+    GLuint materialArray = textureLoader.loadArray(materialPaths, 2048, materialLayerWidth, materialLayerHeight);
+    // Y como entradas de un atlas (entrada = ndice de textura), reducidas a 512 texels;
+    // se construye la primera vez que se elige en la UI
+    TextureAtlas materialAtlas(2048, 8);
+    // Mezclas de multitextura cocinadas a partir de las capas del texture array: solo se
+    // rehacen al cambiar las texturas o los ratios de un objeto, o al subirse una capa
+    // Cada capa ocupa lo que una del array con sus mips (~5 MB a 1024x1024): como mucho 16
+    BlendCache blendCache(16);
+    blendCache.setProgram(loadShaderSource(bakeVertexShaderPath).c_str(), loadShaderSource(bakeFragmentShaderPath).c_str());
+    blendCache.setSource(materialArray, materialLayerWidth, materialLayerHeight);
+    bool bakeMultiTexture = true;
+    int bakedTextureUploads = -1;
+    std::vector<int> bakedLayers;
+
+    // Materiales por texel: capas del mismo texture array pesadas con un mapa RGBA
+    SplatMap splatMap;
+    if (!splatMap.load(splatMapPath))
+        splatMap.generate(512, 1);
+    bool useSplatMaps = true;
+    int splatSeed = 1;
+
+    // Recarga en caliente: los ficheros cambiados se vuelven a decodificar (o compilar)
+    // sin tocar el resto
+    FileWatcher assetWatcher;
+    assetWatcher.watch("textures");
+    assetWatcher.watch("shaders");
+    int textureReloads = 0;
+    int shaderReloads = 0;
 
     glm::vec3 posiciones[12] = {
         // Posiciones de los cubos
@@ -313,118 +843,466 @@ int main() {
     multiTexConfigs[1].useMultiTexture = true;
     multiTexConfigs[2].useMultiTexture = true;
 
+    // Escala de cada objeto: los cubos sin escalar y los tubos estirados en un eje
+    glm::vec3 escalas[12] = {
+        glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(1.0f),
+        glm::vec3(0.1f, 2.0f, 0.1f), glm::vec3(0.1f, 2.0f, 0.1f), glm::vec3(0.1f, 2.0f, 0.1f), glm::vec3(0.1f, 2.0f, 0.1f),
+        glm::vec3(4.0f, 0.1f, 0.1f),
+        glm::vec3(0.1f, 0.1f, 4.0f),
+        glm::vec3(0.1f, 4.0f, 0.1f)
+    };
+
+    std::vector<SceneObject> objects;
+    for (int i = 0; i < 12; i++) {
+        objects.push_back({ posiciones[i], escalas[i], cubeTextures[i], useTextures[i], multiTexConfigs[i] });
+    }
+
+    // Suelo: una sola losa con hierba, piedra, hormign y madera mezcladas por texel con
+    // el splat map, en lugar de muchos objetos con ratios distintos
+    SceneObject ground = { glm::vec3(0.0f, -3.5f, 0.0f), glm::vec3(48.0f, 0.2f, 48.0f), 3, true, multiTexConfigs[3] };
+    ground.splat.useSplat = true;
+    ground.splat.tiling = 12.0f;
+    objects.push_back(ground);
+    const size_t baseObjectCount = objects.size();
+
+    // Un material por objeto en shader storage buffers; cada instancia lleva solo su
+    // ndice (solo en el modo instanciado y con GL 4.3)
+    MaterialTable materialTable;
+    const bool materialTableSupported = MaterialTable::supported();
+    bool useMaterialTable = false;
+    for (SceneObject& object : objects)
+        syncObjectMaterial(object, materialTable);
+    const size_t baseMaterialCount = materialTable.size();
+
+    TransformSystem transforms;
+    syncTransforms(objects, transforms);
+    TransformBenchmark transformBenchmark;
+    std::vector<MipBenchmarkResult> mipBenchmark;
+    std::vector<JpegBenchmarkResult> jpegBenchmark;
+
+    // Modo de dibujado: instanciado (una sola llamada) o un glDrawElements por objeto
+    bool useInstancing = true;
+    // Materiales como capas del texture array o del atlas: ningn glBindTexture por objeto
+    int materialSource = MATERIALS_ARRAY;
+    int stressObjectCount = 0;
+    // Ordenar los draws por clave antes de enviarlos
+    bool sortDraws = true;
+    RenderQueue renderQueue;
+    RenderStats renderStats;
+    // Descarta los objetos fuera del frustum antes de escribir sus datos
+    bool useFrustumCulling = true;
+    BoundingSpheres objectBounds;
+    std::vector<uint32_t> visibleObjects;
+
     glClearColor(0.6f, 0.8f, 1.0f, 1.0f);
 
+    float sceneAngle = 0.0f;
+    SimulationState previousState = { wasd_Movement, Yaw, Pitch, sceneAngle };
+
     // Loop principal
     while (!glfwWindowShouldClose(window)) {
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame; // Calcular el tiempo transcurrido entre frames
-        lastFrame = currentFrame;
+        int updateSteps = scheduler.beginFrame();
+        float fixedDelta = (float)scheduler.fixedDelta();
+
+        for (const std::string& path : assetWatcher.poll()) {
+            if (samePath(path, objectVertexShaderPath) || samePath(path, objectFragmentShaderPath)) {
+                if (reloadShaderPrograms(objectPrograms, objectVertexShaderPath, objectFragmentShaderPath))
+                    shaderReloads++;
+            }
+            else if (samePath(path, instancedVertexShaderPath) || samePath(path, instancedFragmentShaderPath) ||
+                samePath(path, indirectVertexShaderPath)) {
+                // El modo indirecto comparte el fragment shader instanciado
+                if (!samePath(path, indirectVertexShaderPath) &&
+                    reloadShaderPrograms(instancedPrograms, instancedVertexShaderPath, instancedFragmentShaderPath))
+                    shaderReloads++;
+                if (indirectDrawSupported && !samePath(path, instancedVertexShaderPath) &&
+                    reloadShaderPrograms(indirectPrograms, indirectVertexShaderPath, instancedFragmentShaderPath))
+                    shaderReloads++;
+            }
+            else if (samePath(path, cullComputeShaderPath) || samePath(path, depthPyramidComputeShaderPath)) {
+                std::string cull = loadShaderSource(cullComputeShaderPath);
+                std::string pyramid = loadShaderSource(depthPyramidComputeShaderPath);
+                if (gpuCullingSupported && !cull.empty() && !pyramid.empty() &&
+                    gpuCuller.setPrograms(cull.c_str(), pyramid.c_str()))
+                    shaderReloads++;
+            }
+            else if (samePath(path, bakeVertexShaderPath) || samePath(path, bakeFragmentShaderPath)) {
+                std::string vertex = loadShaderSource(bakeVertexShaderPath);
+                std::string fragment = loadShaderSource(bakeFragmentShaderPath);
+                if (!vertex.empty() && !fragment.empty() && blendCache.setProgram(vertex.c_str(), fragment.c_str()))
+                    shaderReloads++;
+            }
+            else if (samePath(path, splatMapPath)) {
+                if (splatMap.load(splatMapPath))
+                    textureReloads++;
+            }
+            else {
+                // La misma imagen puede ser una textura suelta y capas del array
+                TextureHandle changed = textureManager.fileChanged(path);
+                if (changed.valid()) {
+                    textureStreamer.reload(textureManager.texture(changed));
+                    textureReloads++;
+                }
+                // Si comparta textura por contenido con otras rutas, unas u otras han
+                // pasado a una textura nueva, ya cargada de su fichero
+                for (TextureHandle& handle : textures)
+                    handle = textureManager.current(handle);
+                textureReloads += textureLoader.reload(path);
+            }
+        }
+
+        // Subir las texturas que ya estn decodificadas, como mucho ~2 ms por frame
+        textureLoader.update(2.0);
+        textureStreamer.update(1.0);
+
+        // Cada capa subida (o recargada) del texture array cambia lo que hay que mezclar
+        if (textureLoader.completed() != bakedTextureUploads) {
+            bakedTextureUploads = textureLoader.completed();
+            blendCache.invalidate();
+        }
+        blendCache.beginFrame();
+
+        // Las unidades de textura conservan el sampler; solo se reenlaza al cambiar de modo
+        GLuint materialSampler = samplers.get(samplerForFiltering(textureFiltering));
+        if (materialSampler != boundSampler) {
+            for (GLuint unit = 0; unit <= SPLAT_WEIGHTS_TEXTURE_UNIT; unit++)
+                glBindSampler(unit, materialSampler);
+            boundSampler = materialSampler;
+        }
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        glUseProgram(shaderProgram);
-
-        // Controles de movimiento
-        if (ImGui::IsKeyDown(ImGuiKey_W)) wasd_Movement.y -= movementSpeed * deltaTime;
-        else if (ImGui::IsKeyDown(ImGuiKey_S))
-            wasd_Movement.y += movementSpeed * deltaTime;
-        else if (ImGui::IsKeyDown(ImGuiKey_A))
-            wasd_Movement.x += movementSpeed * deltaTime;
-        else if (ImGui::IsKeyDown(ImGuiKey_D))
-            wasd_Movement.x -= movementSpeed * deltaTime;
-        else if (io.MouseWheel > 0)
-            wasd_Movement.z += 200.0f * deltaTime;
+        // Rueda y ratn son eventos del frame: se aplican una vez y tambin al estado
+        // anterior, para que la interpolacin no los retrase
+        float wheelStep = 0.0f;
+        if (io.MouseWheel > 0)
+            wheelStep = 200.0f * fixedDelta;
         else if (io.MouseWheel < 0)
-            wasd_Movement.z -= 200.0f * deltaTime;
+            wheelStep = -200.0f * fixedDelta;
+        wasd_Movement.z += wheelStep;
+        previousState.movement.z += wheelStep;
+
         // Capturar movimiento del mouse
         if (io.MouseDown[1]) // Botn derecho presionado
         {
             float deltaX = io.MouseDelta.y; // Movimiento en X
             float deltaY = io.MouseDelta.x; // Movimiento en Y
 
-            Yaw += deltaX * deltaTime * mouseSensitivity;   // Rotacin en Y (izquierda-derecha)
-            Pitch += deltaY * deltaTime * mouseSensitivity; // Rotacin en X (arriba-abajo)
+            Yaw += deltaX * fixedDelta * mouseSensitivity;   // Rotacin en Y (izquierda-derecha)
+            Pitch += deltaY * fixedDelta * mouseSensitivity; // Rotacin en X (arriba-abajo)
+            previousState.yaw += deltaX * fixedDelta * mouseSensitivity;
+            previousState.pitch += deltaY * fixedDelta * mouseSensitivity;
         }
 
+        // Pasos fijos: teclas de movimiento y rotacin de la escena
+        for (int step = 0; step < updateSteps; step++) {
+            previousState = { wasd_Movement, Yaw, Pitch, sceneAngle };
+
+            // Controles de movimiento
+            if (ImGui::IsKeyDown(ImGuiKey_W)) wasd_Movement.y -= movementSpeed * fixedDelta;
+            else if (ImGui::IsKeyDown(ImGuiKey_S))
+                wasd_Movement.y += movementSpeed * fixedDelta;
+            else if (ImGui::IsKeyDown(ImGuiKey_A))
+                wasd_Movement.x += movementSpeed * fixedDelta;
+            else if (ImGui::IsKeyDown(ImGuiKey_D))
+                wasd_Movement.x -= movementSpeed * fixedDelta;
+
+            sceneAngle += 0.4f * fixedDelta;
+        }
+
+        SimulationState currentState = { wasd_Movement, Yaw, Pitch, sceneAngle };
+        SimulationState renderState = interpolate(previousState, currentState, scheduler.alpha());
+
         glm::mat4 View = glm::mat4(1.0f);
 
         // First move back to create some distance for viewing
-        View = glm::translate(View, glm::vec3(wasd_Movement.x, wasd_Movement.y, -18.0f + wasd_Movement.z));
+        View = glm::translate(View, glm::vec3(renderState.movement.x, renderState.movement.y, -18.0f + renderState.movement.z));
 
         // Then apply the rotations around the scene center
-        View = glm::rotate(View, Pitch, glm::vec3(0.0f, 1.0f, 0.0f)); // rotate around y-axis
-        View = glm::rotate(View, Yaw, glm::vec3(1.0f, 0.0f, 0.0f));   // rotate around x-axis
+        View = glm::rotate(View, renderState.pitch, glm::vec3(0.0f, 1.0f, 0.0f)); // rotate around y-axis
+        View = glm::rotate(View, renderState.yaw, glm::vec3(1.0f, 0.0f, 0.0f));   // rotate around x-axis
 
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
 
-        float angle = (float)glfwGetTime() * 0.4f;
+        float angle = renderState.angle;
+
+        renderStats = RenderStats();
 
-        glBindVertexArray(VAO);
+        // Matrices de modelo de todos los objetos en SoA (en paralelo con muchos objetos)
+        transforms.update(angle, &ThreadPool::shared());
 
-        for (int i = 0; i < 12; i++) {
-            glm::mat4 model = glm::mat4(1.0f);
-            if (i >= 5 && i < 9)
-            {
-                model = scale(glm::vec3(0.1f, 2.0f, 0.1f));
+        // Solo los objetos visibles llegan a los buffers y a la cola
+        // Con el culling en GPU todos los objetos pasan y el compute shader hace el resto
+        bool drawIndirect = useIndirectDraw && indirectDrawSupported;
+        bool cullOnGpu = drawIndirect && useGpuCulling && gpuCullingSupported;
+        // En GPU las esferas salen de las matrices; en CPU solo las pide el streaming de texturas
+        if (!cullOnGpu || materialSource == MATERIALS_TEXTURES)
+            updateBounds(objects, transforms, objectBounds);
+        if (useFrustumCulling && !cullOnGpu) {
+            cullSpheres(extractFrustum(projection * View), objectBounds, visibleObjects);
+        }
+        else {
+            visibleObjects.resize(objects.size());
+            for (size_t i = 0; i < objects.size(); i++)
+                visibleObjects[i] = (uint32_t)i;
+        }
+        size_t visibleCount = visibleObjects.size();
+
+        // El texture array y el atlas no se streamean; las texturas sueltas piden su resolucin
+        if (materialSource == MATERIALS_TEXTURES) {
+            int framebufferWidth, framebufferHeight;
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            float pixelsPerUnit = framebufferHeight / std::tan(glm::radians(45.0f) * 0.5f);
+            requestTextureResolution(objects, visibleObjects, objectBounds, View, pixelsPerUnit, textures, textureManager,
+                textureScreenSize, textureStreamer);
+        }
+
+        // Datos de cmara del frame en el bloque FrameData; la primera reserva del frame
+        // siempre cabe y uniformAlignment cubre el relleno hasta el primer offset alineado
+        uniformRing.beginFrame(uniformAlignment + frameStride + (useInstancing || drawIndirect ? 0 : objectStride * visibleCount));
+        GLintptr frameOffset = 0;
+        FrameData* frameData = (FrameData*)uniformRing.allocate(sizeof(FrameData), uniformAlignment, frameOffset);
+        frameData->view = View;
+        frameData->projection = projection;
+        frameData->viewProjection = projection * View;
+
+        // Las capas del splat map salen siempre del texture array, sea cual sea el origen
+        // del resto de materiales
+        if (useSplatMaps) {
+            glActiveTexture(GL_TEXTURE0 + SPLAT_LAYERS_TEXTURE_UNIT);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, materialArray);
+            glActiveTexture(GL_TEXTURE0 + SPLAT_WEIGHTS_TEXTURE_UNIT);
+            glBindTexture(GL_TEXTURE_2D, splatMap.texture());
+            renderStats.textureBinds += 2;
+        }
+
+        if (useInstancing || drawIndirect) {
+            // Matriz y material de un objeto visible, iguales en los dos modos
+            auto instanceFor = [&](uint32_t i) {
+                bool splat = useSplatMaps && objects[i].splat.useSplat;
+                int bakedLayer = bakeMultiTexture && !useMaterialTable && !splat ? bakedBlendLayer(objects[i], blendCache) : -1;
+                InstanceData instance = makeInstance(objects[i], transforms.model(i), bakedLayer, splat);
+                if (useMaterialTable && !splat)
+                    instance.material[0] = objects[i].material;
+                return instance;
+            };
+
+            GLintptr instanceOffset = 0, transformsOffset = 0, materialsOffset = 0;
+            size_t drawCount = std::max<size_t>(visibleCount, 1);
+            if (drawIndirect) {
+                // Matrices y materiales en storage buffers y un comando por objeto; la
+                // lista de comandos solo se vuelve a subir si cambia qu objetos se ven
+                storageRing.beginFrame(drawCount * (sizeof(glm::mat4) + sizeof(DrawMaterial)) + 2 * storageAlignment);
+                glm::mat4* drawTransforms = (glm::mat4*)storageRing.allocate(drawCount * sizeof(glm::mat4), storageAlignment, transformsOffset);
+                DrawMaterial* drawMaterials = (DrawMaterial*)storageRing.allocate(drawCount * sizeof(DrawMaterial), storageAlignment, materialsOffset);
+                if (!drawMaterials)
+                    visibleCount = 0;
+                indirectDraws.clear();
+                for (size_t v = 0; v < visibleCount; v++) {
+                    InstanceData instance = instanceFor(visibleObjects[v]);
+                    drawTransforms[v] = instance.model;
+                    for (int k = 0; k < 4; k++)
+                        drawMaterials[v].material[k] = instance.material[k];
+                    drawMaterials[v].mixRatios = instance.mixRatios;
+                    if (!cullOnGpu)
+                        indirectDraws.add(cubeMesh, (uint32_t)v, (uint32_t)v);
+                }
+                storageRing.flush();
+
+                // Los comandos los escribe el compute shader a partir de las matrices;
+                // la esfera de cada cubo sale de su semieje 0.5 escalado, como en updateBounds()
+                if (cullOnGpu) {
+                    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_TRANSFORMS_BINDING, storageRing.id(), transformsOffset,
+                        drawCount * sizeof(glm::mat4));
+                    gpuCuller.cull((GLuint)visibleCount, cubeMesh, glm::vec3(0.5f), projection * View, useFrustumCulling,
+                        useOcclusionCulling);
+                    if (!drawParametersSupported)
+                        indirectDraws.reserveDrawIds(visibleCount);
+                }
             }
-            else if (i == 9)
-            {
-                model = scale(glm::vec3(4.0f, 0.1f, 0.1f));
+            else {
+                // Empaquetar matrices y materiales de todos los objetos en el instance buffer
+                instanceRing.beginFrame(sizeof(InstanceData) + visibleCount * sizeof(InstanceData));
+                InstanceData* instances = (InstanceData*)instanceRing.allocate(visibleCount * sizeof(InstanceData), sizeof(InstanceData), instanceOffset);
+                for (size_t v = 0; v < visibleCount; v++)
+                    instances[v] = instanceFor(visibleObjects[v]);
+                instanceRing.flush();
             }
-            else if (i == 10)
-            {
-                model = scale(glm::vec3(0.1f, 0.1f, 4.0f));
+            uniformRing.flush();
+            // Las mezclas nuevas se cocinan antes de enlazar el estado del dibujado
+            blendCache.flush();
+
+            if (drawIndirect) {
+                glBindVertexArray(indirectVAO);
             }
-            else if (i == 11)
-            {
-                model = scale(glm::vec3(0.1f, 4.0f, 0.1f));
+            else {
+                // Los atributos apuntan a la regin del ring buffer de este frame
+                glBindVertexArray(instancedVAO);
+                glBindBuffer(GL_ARRAY_BUFFER, instanceRing.id());
+                setupInstanceAttributes(instanceOffset);
             }
 
-            // Trasladar el cubo al origen
-            model = glm::translate(model, posiciones[i]);
-
-            model = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) * model;
-
-            glm::mat4 transform = projection * View * model;
+            unsigned instancedFeatures = materialFeatures(materialSource);
+            if (useMaterialTable)
+                instancedFeatures |= FRAGMENT_MATERIAL_TABLE;
+            else if (bakeMultiTexture)
+                instancedFeatures |= FRAGMENT_BAKED;
+            if (useSplatMaps)
+                instancedFeatures |= FRAGMENT_SPLAT;
+            (drawIndirect ? indirectPrograms : instancedPrograms).get(instancedFeatures).use();
+            glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, uniformRing.id(), frameOffset, sizeof(FrameData));
+
+            if (materialSource == MATERIALS_ARRAY) {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, materialArray);
+            }
+            else if (materialSource == MATERIALS_ATLAS) {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, materialAtlas.texture());
+                glBindBufferBase(GL_UNIFORM_BUFFER, ATLAS_DATA_BINDING, materialAtlas.uniformBuffer());
+            }
+            else {
+                // Todas las texturas quedan enlazadas a la vez; cada instancia elige las suyas
+                for (size_t t = 0; t < textures.size() && t < 8; t++) {
+                    glActiveTexture(GL_TEXTURE0 + (GLenum)t);
+                    glBindTexture(GL_TEXTURE_2D, textureManager.texture(textures[t]));
+                }
+            }
 
-            GLuint transformLoc = glGetUniformLocation(shaderProgram, "transform");
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transform));
+            if (useMaterialTable) {
+                materialTable.bind(MATERIAL_RANGES_BINDING, MATERIAL_LAYERS_BINDING);
+            }
+            else if (bakeMultiTexture) {
+                glActiveTexture(GL_TEXTURE0 + BAKED_TEXTURE_UNIT);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, blendCache.texture());
+                renderStats.textureBinds++;
+            }
 
-            // Configurar texturas y uniforms para el shader
-            glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-            glUniform1i(glGetUniformLocation(shaderProgram, "texture2"), 1);
-            glUniform1i(glGetUniformLocation(shaderProgram, "texture3"), 2);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), useTextures[i]);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useMultiTexture"), multiTexConfigs[i].useMultiTexture);
+            if (drawIndirect) {
+                glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_TRANSFORMS_BINDING, storageRing.id(), transformsOffset,
+                    drawCount * sizeof(glm::mat4));
+                glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_MATERIALS_BINDING, storageRing.id(), materialsOffset,
+                    drawCount * sizeof(DrawMaterial));
+                if (cullOnGpu)
+                    gpuCuller.draw(GL_TRIANGLES, DRAW_RECORDS_BINDING);
+                else
+                    indirectDraws.draw(GL_TRIANGLES, DRAW_RECORDS_BINDING);
+                storageRing.endFrame();
+            }
+            else {
+                glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0, (GLsizei)visibleCount);
+                instanceRing.endFrame();
+            }
+            renderStats.draws++;
+            renderStats.programSwitches++;
+            renderStats.vertexArrayBinds++;
+            renderStats.textureBinds += materialSource != MATERIALS_TEXTURES ? 1 : (int)std::min<size_t>(textures.size(), 8);
+        }
+        else {
+            // Escribir el bloque ObjectData de cada objeto en el ring buffer
+            GLintptr objectsOffset = 0;
+            unsigned char* objectData = (unsigned char*)uniformRing.allocate(objectStride * visibleCount, uniformAlignment, objectsOffset);
+            if (!objectData)
+                visibleCount = 0;
+            bakedLayers.resize(visibleCount);
+            for (size_t v = 0; v < visibleCount; v++) {
+                uint32_t i = visibleObjects[v];
+                bool splat = useSplatMaps && objects[i].splat.useSplat;
+                bakedLayers[v] = bakeMultiTexture && !splat ? bakedBlendLayer(objects[i], blendCache) : -1;
+                *(InstanceData*)(objectData + v * objectStride) = makeInstance(objects[i], transforms.model(i), bakedLayers[v], splat);
+            }
+            uniformRing.flush();
+            blendCache.flush();
 
-            if (multiTexConfigs[i].useMultiTexture && useTextures[i]) {
-                // Configurar ratios de mezcla para multitextura
-                glUniform1f(glGetUniformLocation(shaderProgram, "mixRatio1"), multiTexConfigs[i].mixRatio1);
-                glUniform1f(glGetUniformLocation(shaderProgram, "mixRatio2"), multiTexConfigs[i].mixRatio2);
-                glUniform1f(glGetUniformLocation(shaderProgram, "mixRatio3"), multiTexConfigs[i].mixRatio3);
+            glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, uniformRing.id(), frameOffset, sizeof(FrameData));
 
-                // Activar y vincular las texturas a usar
+            if (materialSource != MATERIALS_TEXTURES) {
                 glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, textures[multiTexConfigs[i].texIndex1]);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, materialSource == MATERIALS_ATLAS ? materialAtlas.texture() : materialArray);
+                if (materialSource == MATERIALS_ATLAS)
+                    glBindBufferBase(GL_UNIFORM_BUFFER, ATLAS_DATA_BINDING, materialAtlas.uniformBuffer());
+                renderStats.textureBinds++;
+            }
+            if (bakeMultiTexture) {
+                glActiveTexture(GL_TEXTURE0 + BAKED_TEXTURE_UNIT);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, blendCache.texture());
+                renderStats.textureBinds++;
+            }
 
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, textures[multiTexConfigs[i].texIndex2]);
+            // Un paquete por objeto; la cola los ordena por estado y profundidad
+            renderQueue.clear();
+            renderQueue.reserve(visibleCount);
+            for (size_t v = 0; v < visibleCount; v++) {
+                uint32_t i = visibleObjects[v];
+                const SceneObject& object = objects[i];
+
+                // Elegir la variante del shader que corresponde a este objeto; una mezcla
+                // cocinada es una sola textura, venga de donde venga el material
+                unsigned permutation = fragmentPermutation(object);
+                if (useSplatMaps && object.splat.useSplat)
+                    permutation = FRAGMENT_SPLAT;
+                else if (bakedLayers[v] >= 0)
+                    permutation = FRAGMENT_TEXTURED | FRAGMENT_BAKED;
+                else if (permutation != 0)
+                    permutation |= materialFeatures(materialSource);
+
+                DrawPacket packet;
+                packet.program = &objectPrograms.get(permutation);
+                packet.vertexArray = VAO;
+                packet.uniformBuffer = uniformRing.id();
+                packet.uniformOffset = objectsOffset + (GLintptr)(v * objectStride);
+                packet.uniformSize = sizeof(InstanceData);
+                packet.indexCount = 36;
+
+                // Con el texture array o el atlas las capas salen de material.xyz del bloque ObjectData
+                unsigned material = 0;
+                if (permutation & FRAGMENT_BAKED) {
+                    material = bakedLayers[v] + 1;
+                }
+                else if (materialSource == MATERIALS_TEXTURES && (permutation & FRAGMENT_TEXTURED)) {
+                    if (permutation & FRAGMENT_MULTITEXTURE) {
+                        packet.textures[0] = textureManager.texture(textures[object.multiTex.texIndex1]);
+                        packet.textures[1] = textureManager.texture(textures[object.multiTex.texIndex2]);
+                        packet.textures[2] = textureManager.texture(textures[object.multiTex.texIndex3]);
+                        material = (object.multiTex.texIndex1 + 1) |
+                            ((object.multiTex.texIndex2 + 1) << 8) |
+                            ((object.multiTex.texIndex3 + 1) << 16);
+                    }
+                    else {
+                        packet.textures[0] = textureManager.texture(textures[object.texture]);
+                        material = object.texture + 1;
+                    }
+                }
 
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, textures[multiTexConfigs[i].texIndex3]);
-            }
-            else {
-                // Uso de una sola textura (como estaba antes)
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, textures[cubeTextures[i]]);
+                // Profundidad en espacio de vista del centro del objeto, normalizada entre near y far
+                glm::vec3 center(objectBounds.x()[i], objectBounds.y()[i], objectBounds.z()[i]);
+                glm::vec4 viewPosition = View * glm::vec4(center, 1.0f);
+                float depth = (-viewPosition.z - 0.1f) / (100.0f - 0.1f);
+                packet.key = makeSortKey(0, permutation, material, depth);
+                renderQueue.push(packet);
             }
 
-            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+            if (sortDraws)
+                renderQueue.sort();
+            renderQueue.submit(OBJECT_DATA_BINDING, renderStats);
+        }
+        uniformRing.endFrame();
+
+        // La profundidad de este frame ocluye en el siguiente
+        if (cullOnGpu && useOcclusionCulling) {
+            int framebufferWidth, framebufferHeight;
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            gpuCuller.updateDepthPyramid(framebufferWidth, framebufferHeight, projection * View);
+        }
+        else {
+            gpuCuller.invalidateDepthPyramid();
         }
+        // Al volver a activarlo no debe verse el contador de la vez anterior
+        if (!cullOnGpu)
+            gpuCuller.resetReadback();
 
         ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
 
@@ -434,9 +1312,129 @@ int main() {
                 Yaw = 0.0f;
                 Pitch = 0.0f;
                 wasd_Movement = { 0.f, 0.f, 0.0f };
+                previousState = { wasd_Movement, Yaw, Pitch, sceneAngle };
             }
             ImGui::SliderFloat("Mouse Sensitivity", &mouseSensitivity, 0.1f, 2.0f);
 
+            // Rendering settings UI
+            ImGui::Separator();
+            ImGui::Text("Rendering:");
+            ImGui::Checkbox("Instanced Rendering", &useInstancing);
+            if (indirectDrawSupported) {
+                ImGui::Checkbox("Multi-Draw Indirect", &useIndirectDraw);
+                // Con el culling en GPU la lista de la CPU queda vaca: los draws los cuenta el contador
+                if (useIndirectDraw && useGpuCulling && gpuCullingSupported)
+                    ImGui::Text("%d draws in one call (%s), commands written on the GPU", gpuCuller.visibleCount(),
+                        drawParametersSupported ? "gl_DrawID" : "draw id attribute");
+                else if (useIndirectDraw)
+                    ImGui::Text("%d draws in one call (%s), %.1f KB of commands uploaded", (int)indirectDraws.size(),
+                        drawParametersSupported ? "gl_DrawID" : "draw id attribute", indirectDraws.uploadedBytes() / 1024.0);
+                if (gpuCullingSupported && useIndirectDraw) {
+                    ImGui::Checkbox("GPU Culling (compute)", &useGpuCulling);
+                    if (useGpuCulling) {
+                        ImGui::Checkbox("Occlusion (depth pyramid)", &useOcclusionCulling);
+                        ImGui::Text("GPU visible: %d / %d (%s)", gpuCuller.visibleCount(), (int)objects.size(),
+                            GpuCuller::drawCountSupported() ? "draw count from GPU" : "empty commands");
+                    }
+                }
+            }
+            else {
+                ImGui::Text("Multi-Draw Indirect: needs GL 4.3");
+            }
+            if (ImGui::Combo("Materials", &materialSource, materialSourceNames, IM_ARRAYSIZE(materialSourceNames)) &&
+                materialSource == MATERIALS_ATLAS && materialAtlas.texture() == 0) {
+                if (materialAtlas.size() == 0) {
+                    for (const std::string& path : materialPaths)
+                        materialAtlas.add(path, 512);
+                }
+                if (!materialAtlas.build(&ThreadPool::shared()))
+                    materialSource = MATERIALS_ARRAY;
+            }
+            if (materialSource == MATERIALS_ARRAY) {
+                ImGui::Text("Texture array: %dx%d layers", materialLayerWidth, materialLayerHeight);
+            }
+            else if (materialSource == MATERIALS_ATLAS) {
+                const AtlasStats& atlasStats = materialAtlas.stats();
+                ImGui::Text("Atlas: %d entries in %d pages, %.0f%% used, %d mips, built in %.1f ms", atlasStats.entries,
+                    atlasStats.pages, atlasStats.usage * 100.0f, materialAtlas.levels(), atlasStats.buildMilliseconds);
+            }
+            if (ImGui::SliderInt("Extra Cubes", &stressObjectCount, 0, 100000)) {
+                addStressObjects(objects, baseObjectCount, stressObjectCount);
+                addStressMaterials(objects, baseObjectCount, materialTable, baseMaterialCount);
+                syncTransforms(objects, transforms);
+            }
+            ImGui::Checkbox("Bake Multitexture", &bakeMultiTexture);
+            if (materialTableSupported) {
+                ImGui::Checkbox("Material Table (instanced)", &useMaterialTable);
+                ImGui::Text("Materials: %d  SSBO uploads: %.1f KB", (int)materialTable.size(), materialTable.uploadedBytes() / 1024.0);
+            }
+            else {
+                ImGui::Text("Material Table: needs GL 4.3 shader storage buffers");
+            }
+            BlendCacheStats blendStats = blendCache.stats();
+            ImGui::Text("Baked blends: %d / %d layers  Bakes: %d (last %.2f ms)", blendStats.entries, blendStats.capacity,
+                blendStats.bakes, blendStats.lastBakeMilliseconds);
+            ImGui::Checkbox("Sort Draws", &sortDraws);
+            ImGui::Checkbox("Frustum Culling", &useFrustumCulling);
+            // Con el culling en GPU la lista de la CPU tiene todos los objetos
+            int visibleShown = cullOnGpu ? gpuCuller.visibleCount() : (int)visibleObjects.size();
+            ImGui::Text("Visible: %d  Culled: %d", visibleShown, visibleShown < 0 ? 0 : (int)objects.size() - visibleShown);
+            ImGui::Text("Objects: %d  Draw calls: %d", (int)objects.size(), renderStats.draws);
+            ImGui::Text("Texture binds: %d  VAO binds: %d", renderStats.textureBinds, renderStats.vertexArrayBinds);
+            ImGui::Text("Shader permutations: %d  Program switches: %d", (int)objectPrograms.size(), renderStats.programSwitches);
+            ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+            if (ImGui::Checkbox("Limit FPS", &limitFPS) | ImGui::SliderInt("FPS Limit", &fpsLimit, 15, 240)) {
+                scheduler.setFrameLimit(limitFPS ? fpsLimit : 0);
+            }
+            ImGui::Text("Updates/s: %d  Frames/s: %d", scheduler.updatesPerSecond(), scheduler.framesPerSecond());
+            if (textureLoader.pending() > 0) {
+                ImGui::Text("Loading textures: %d pending, %d done", (int)textureLoader.pending(), textureLoader.completed());
+            }
+            if (textureLoader.compressionEnabled()) {
+                const TextureCacheStats& textureCache = textureLoader.cacheStats();
+                ImGui::Text("Texture cache: %d hits, %d compressed, %.1f MB BCn", textureCache.hits, textureCache.misses,
+                    textureCache.compressedBytes / (1024.0 * 1024.0));
+            }
+            if (ImGui::Combo("Image Decoder", &imageDecoderMode, imageDecoderNames, IM_ARRAYSIZE(imageDecoderNames))) {
+                setImageDecoder((ImageDecoder)imageDecoderMode);
+            }
+            ImGui::Combo("Texture Filtering", &textureFiltering, textureFilteringNames, IM_ARRAYSIZE(textureFilteringNames));
+            if (ImGui::SliderInt("Texture Budget (MB)", &textureBudgetMB, 1, 512)) {
+                textureStreamer.setBudget((size_t)textureBudgetMB << 20);
+            }
+            TextureStreamingStats streaming = textureStreamer.stats();
+            ImGui::Text("Resident: %.1f / %.1f MB  Requests: %d  Converting: %d", streaming.residentBytes / (1024.0 * 1024.0),
+                streaming.budgetBytes / (1024.0 * 1024.0), streaming.pendingRequests, streaming.pendingConversions);
+            ImGui::Text("Mip levels streamed: %d  evicted: %d", streaming.uploadedLevels, streaming.evictedLevels);
+            TextureManagerStats managed = textureManager.stats();
+            ImGui::Text("Managed textures: %d (%d refs)  Shared by path: %d  by content: %d", managed.textures,
+                managed.references, managed.pathHits, managed.contentHits);
+            ImGui::Text("Hot reload: %d textures, %d shader sets", textureReloads, shaderReloads);
+            if (ImGui::Button("Benchmark Transforms")) {
+                transformBenchmark = benchmarkTransforms(objects, transforms, angle);
+            }
+            if (transformBenchmark.objectCount > 0) {
+                ImGui::Text("%d objects: glm %.3f ms  SoA %.3f ms  threaded %.3f ms", (int)transformBenchmark.objectCount,
+                    transformBenchmark.glmMilliseconds, transformBenchmark.soaMilliseconds, transformBenchmark.soaThreadedMilliseconds);
+            }
+            if (ImGui::Button("Benchmark Mipmaps")) {
+                mipBenchmark = benchmarkMipGeneration({ "textures/wood.jpg", "textures/metal.jpg", "textures/concrete.jpg",
+                    "textures/grass.jpeg", "textures/stone.jpeg" }, &ThreadPool::shared());
+            }
+            for (const MipBenchmarkResult& result : mipBenchmark) {
+                ImGui::Text("%s (%dx%d): box %.1f ms  Kaiser %.1f ms  GL %.1f ms", result.path.c_str(), result.width,
+                    result.height, result.boxMilliseconds, result.kaiserMilliseconds, result.glMilliseconds);
+            }
+            if (ImGui::Button("Benchmark JPEG")) {
+                jpegBenchmark = benchmarkJpegDecode({ "textures/wood.jpg", "textures/metal.jpg", "textures/concrete.jpg",
+                    "textures/grass.jpeg", "textures/stone.jpeg" }, &ThreadPool::shared());
+            }
+            for (const JpegBenchmarkResult& result : jpegBenchmark) {
+                ImGui::Text("%s (%dx%d%s): stbi %.0f MB/s  SIMD %.0f MB/s  threaded %.0f MB/s  diff %.2f", result.path.c_str(),
+                    result.width, result.height, result.progressive ? ", progressive" : "", result.stbiMegabytesPerSecond,
+                    result.singleMegabytesPerSecond, result.threadedMegabytesPerSecond, result.meanDifference);
+            }
+
             // Texture selection UI
             ImGui::Separator();
             ImGui::Text("Texture Settings:");
@@ -450,12 +1448,12 @@ int main() {
                 ImGui::PushID(i);
 
                 // Checkbox for enabling/disabling texture
-                ImGui::Checkbox("Use Texture", &useTextures[i]);
+                ImGui::Checkbox("Use Texture", &objects[i].useTexture);
 
-                if (useTextures[i]) {
+                if (objects[i].useTexture) {
                     // Combo box for texture selection
-                    if (ImGui::Combo("Texture", &cubeTextures[i], textureNames, IM_ARRAYSIZE(textureNames))) {
-                        // Handle texture change if needed
+                    if (ImGui::Combo("Texture", &objects[i].texture, textureNames, IM_ARRAYSIZE(textureNames))) {
+                        syncObjectMaterial(objects[i], materialTable);
                     }
                 }
 
@@ -463,6 +1461,31 @@ int main() {
                 ImGui::Separator();
             }
 
+            // Splat map UI: capas y repeticin de los objetos con splat map
+            ImGui::Separator();
+            ImGui::Text("Splat Map Settings:");
+            ImGui::Checkbox("Splat Maps", &useSplatMaps);
+            const float* coverage = splatMap.coverage();
+            ImGui::Text("Weights %dx%d, coverage R %.2f G %.2f B %.2f A %.2f", splatMap.width(), splatMap.height(),
+                coverage[0], coverage[1], coverage[2], coverage[3]);
+            ImGui::InputInt("Seed", &splatSeed);
+            ImGui::SameLine();
+            if (ImGui::Button("Regenerate"))
+                splatMap.generate(512, (uint32_t)splatSeed);
+
+            for (size_t i = 0; i < baseObjectCount; i++) {
+                if (!objects[i].splat.useSplat)
+                    continue;
+                ImGui::PushID((int)i + 200);
+                ImGui::Combo("Red Layer", &objects[i].splat.layers[0], textureNames, IM_ARRAYSIZE(textureNames));
+                ImGui::Combo("Green Layer", &objects[i].splat.layers[1], textureNames, IM_ARRAYSIZE(textureNames));
+                ImGui::Combo("Blue Layer", &objects[i].splat.layers[2], textureNames, IM_ARRAYSIZE(textureNames));
+                ImGui::Combo("Alpha Layer", &objects[i].splat.layers[3], textureNames, IM_ARRAYSIZE(textureNames));
+                ImGui::SliderFloat("Tiling", &objects[i].splat.tiling, 1.0f, 64.0f);
+                ImGui::PopID();
+                ImGui::Separator();
+            }
+
             // Multitexture Settings UI
             ImGui::Separator();
             ImGui::Text("Multitexture Settings:");
@@ -471,35 +1494,41 @@ int main() {
                 ImGui::PushID(i + 100); // ID nico para evitar conflictos
 
                 const char* cube_name = "cube_x";
-                ImGui::Checkbox(cube_name, &multiTexConfigs[i].useMultiTexture);
+                bool materialChanged = ImGui::Checkbox(cube_name, &objects[i].multiTex.useMultiTexture);
 
-                if (multiTexConfigs[i].useMultiTexture) {
+                if (objects[i].multiTex.useMultiTexture) {
                     // Selector de texturas
                     const char* textureNames[] = { "Wood", "Metal", "Concrete", "Grass", "Stone" };
 
-                    ImGui::Combo("Primary Texture", &multiTexConfigs[i].texIndex1, textureNames, IM_ARRAYSIZE(textureNames));
-                    ImGui::Combo("Secondary Texture", &multiTexConfigs[i].texIndex2, textureNames, IM_ARRAYSIZE(textureNames));
-                    ImGui::Combo("Tertiary Texture", &multiTexConfigs[i].texIndex3, textureNames, IM_ARRAYSIZE(textureNames));
+                    materialChanged |= ImGui::Combo("Primary Texture", &objects[i].multiTex.texIndex1, textureNames, IM_ARRAYSIZE(textureNames));
+                    materialChanged |= ImGui::Combo("Secondary Texture", &objects[i].multiTex.texIndex2, textureNames, IM_ARRAYSIZE(textureNames));
+                    materialChanged |= ImGui::Combo("Tertiary Texture", &objects[i].multiTex.texIndex3, textureNames, IM_ARRAYSIZE(textureNames));
 
                     // Controles deslizantes para los ratios de mezcla
-                    ImGui::SliderFloat("Primary Mix", &multiTexConfigs[i].mixRatio1, 0.0f, 1.0f);
-                    ImGui::SliderFloat("Secondary Mix", &multiTexConfigs[i].mixRatio2, 0.0f, 1.0f);
-                    ImGui::SliderFloat("Tertiary Mix", &multiTexConfigs[i].mixRatio3, 0.0f, 1.0f);
+                    materialChanged |= ImGui::SliderFloat("Primary Mix", &objects[i].multiTex.mixRatio1, 0.0f, 1.0f);
+                    materialChanged |= ImGui::SliderFloat("Secondary Mix", &objects[i].multiTex.mixRatio2, 0.0f, 1.0f);
+                    materialChanged |= ImGui::SliderFloat("Tertiary Mix", &objects[i].multiTex.mixRatio3, 0.0f, 1.0f);
 
                     // Botones de presets para efectos especficos
                     if (ImGui::Button("Blend Equal")) {
-                        multiTexConfigs[i].mixRatio1 = 0.33f;
-                        multiTexConfigs[i].mixRatio2 = 0.33f;
-                        multiTexConfigs[i].mixRatio3 = 0.33f;
+                        objects[i].multiTex.mixRatio1 = 0.33f;
+                        objects[i].multiTex.mixRatio2 = 0.33f;
+                        objects[i].multiTex.mixRatio3 = 0.33f;
+                        materialChanged = true;
                     }
                     ImGui::SameLine();
                     if (ImGui::Button("Primary Dominant")) {
-                        multiTexConfigs[i].mixRatio1 = 0.7f;
-                        multiTexConfigs[i].mixRatio2 = 0.2f;
-                        multiTexConfigs[i].mixRatio3 = 0.1f;
+                        objects[i].multiTex.mixRatio1 = 0.7f;
+                        objects[i].multiTex.mixRatio2 = 0.2f;
+                        objects[i].multiTex.mixRatio3 = 0.1f;
+                        materialChanged = true;
                     }
                 }
 
+                // La tabla de materiales guarda la mezcla ya resuelta
+                if (materialChanged)
+                    syncObjectMaterial(objects[i], materialTable);
+
                 ImGui::PopID();
                 ImGui::Separator();
             }
@@ -517,6 +1546,10 @@ int main() {
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
         glfwSwapBuffers(window);
+
+        // Dormir lo que sobre del frame si hay lmite de FPS; los eventos se leen
+        // despus para que la entrada sea lo ms reciente posible
+        scheduler.endFrame();
         glfwPollEvents();
     }
 
@@ -524,12 +1557,28 @@ int main() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
+    glDeleteVertexArrays(1, &instancedVAO);
+    if (indirectVAO)
+        glDeleteVertexArrays(1, &indirectVAO);
+    indirectDraws.destroy();
+    gpuCuller.destroy();
+    storageRing.destroy();
+    uniformRing.destroy();
+    instanceRing.destroy();
+    objectPrograms.clear();
+    instancedPrograms.clear();
+    indirectPrograms.clear();
 
     // Delete textures
-    for (unsigned int texture : textures) {
-        glDeleteTextures(1, &texture);
-    }
+    textureLoader.destroy();
+    textureManager.clear();
+    textureStreamer.destroy();
+    samplers.clear();
+    glDeleteTextures(1, &materialArray);
+    materialAtlas.destroy();
+    blendCache.destroy();
+    splatMap.destroy();
+    materialTable.destroy();
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -0,0 +1,134 @@
+#include "materialtable.hpp"
+#include <algorithm>
+
+namespace myopengl {
+
+	bool MaterialTable::supported()
+	{
+		return GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_program_interface_query;
+	}
+
+	int MaterialTable::add(const MaterialLayer* layers, int count)
+	{
+		count = std::clamp(count, 0, MaxLayers);
+		Range range;
+		range.first = (int32_t)m_Layers.size();
+		range.count = count;
+		m_Layers.insert(m_Layers.end(), layers, layers + count);
+		m_Ranges.push_back(range);
+		m_Resized = true;
+		return (int)m_Ranges.size() - 1;
+	}
+
+	void MaterialTable::set(int material, const MaterialLayer* layers, int count)
+	{
+		count = std::clamp(count, 0, MaxLayers);
+		Range& range = m_Ranges[material];
+		if (count == range.count) {
+			std::copy(layers, layers + count, m_Layers.begin() + range.first);
+			if (m_DirtyBegin == m_DirtyEnd) {
+				m_DirtyBegin = material;
+				m_DirtyEnd = material + 1;
+			}
+			else {
+				m_DirtyBegin = std::min(m_DirtyBegin, material);
+				m_DirtyEnd = std::max(m_DirtyEnd, material + 1);
+			}
+			return;
+		}
+
+		// Otro número de capas: van al final y las viejas se recogen al subir
+		m_DeadLayers += range.count;
+		range.first = (int32_t)m_Layers.size();
+		range.count = count;
+		m_Layers.insert(m_Layers.end(), layers, layers + count);
+		m_Resized = true;
+	}
+
+	void MaterialTable::resize(size_t count)
+	{
+		if (count >= m_Ranges.size())
+			return;
+		for (size_t i = count; i < m_Ranges.size(); i++)
+			m_DeadLayers += m_Ranges[i].count;
+		m_Ranges.resize(count);
+		m_Resized = true;
+	}
+
+	void MaterialTable::repack()
+	{
+		std::vector<MaterialLayer> layers;
+		layers.reserve(m_Layers.size() - m_DeadLayers);
+		for (Range& range : m_Ranges) {
+			int32_t first = (int32_t)layers.size();
+			layers.insert(layers.end(), m_Layers.begin() + range.first, m_Layers.begin() + range.first + range.count);
+			range.first = first;
+		}
+		m_Layers.swap(layers);
+		m_DeadLayers = 0;
+	}
+
+	void MaterialTable::upload()
+	{
+		if (!m_RangeBuffer) {
+			glGenBuffers(1, &m_RangeBuffer);
+			glGenBuffers(1, &m_LayerBuffer);
+		}
+
+		if (m_Resized) {
+			if (m_DeadLayers > 0)
+				repack();
+			// Un buffer vacío no se puede enlazar: como mínimo un elemento
+			Range emptyRange;
+			MaterialLayer emptyLayer;
+			size_t rangeBytes = std::max<size_t>(m_Ranges.size(), 1) * sizeof(Range);
+			size_t layerBytes = std::max<size_t>(m_Layers.size(), 1) * sizeof(MaterialLayer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_RangeBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, rangeBytes, m_Ranges.empty() ? &emptyRange : (const void*)m_Ranges.data(), GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_LayerBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, layerBytes, m_Layers.empty() ? &emptyLayer : (const void*)m_Layers.data(), GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			m_UploadedBytes += rangeBytes + layerBytes;
+			m_Resized = false;
+			m_DirtyBegin = m_DirtyEnd = 0;
+			return;
+		}
+
+		if (m_DirtyBegin == m_DirtyEnd)
+			return;
+		// Los rangos no han cambiado: solo las capas de los materiales tocados
+		int32_t first = m_Ranges[m_DirtyBegin].first;
+		int32_t end = first;
+		for (int i = m_DirtyBegin; i < m_DirtyEnd; i++) {
+			first = std::min(first, m_Ranges[i].first);
+			end = std::max(end, m_Ranges[i].first + m_Ranges[i].count);
+		}
+		if (end > first) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_LayerBuffer);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)(first * sizeof(MaterialLayer)),
+				(GLsizeiptr)((end - first) * sizeof(MaterialLayer)), m_Layers.data() + first);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			m_UploadedBytes += (end - first) * sizeof(MaterialLayer);
+		}
+		m_DirtyBegin = m_DirtyEnd = 0;
+	}
+
+	void MaterialTable::bind(GLuint rangeBinding, GLuint layerBinding)
+	{
+		upload();
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, rangeBinding, m_RangeBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, layerBinding, m_LayerBuffer);
+	}
+
+	void MaterialTable::destroy()
+	{
+		if (m_RangeBuffer)
+			glDeleteBuffers(1, &m_RangeBuffer);
+		if (m_LayerBuffer)
+			glDeleteBuffers(1, &m_LayerBuffer);
+		m_RangeBuffer = 0;
+		m_LayerBuffer = 0;
+		m_Resized = true;
+	}
+
+}
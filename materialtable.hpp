@@ -0,0 +1,72 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace myopengl {
+
+	// Capa de un material: índice de textura (capa del array, entrada del atlas o unidad)
+	// y su peso en la mezcla. Layout std430 del buffer MaterialLayers.
+	struct MaterialLayer {
+		int32_t texture = 0;
+		float weight = 1.0f;
+	};
+
+	// Materiales de N capas en dos shader storage buffers: MaterialRanges (ivec2 por
+	// material: primera capa y número de capas) y MaterialLayers (las capas de todos los
+	// materiales seguidas). Cada instancia solo lleva el índice de su material, así que
+	// objetos con mezclas distintas se dibujan en una llamada sin tocar uniforms.
+	// Cambiar las capas de un material sin cambiar cuántas son sube solo ese rango;
+	// cambiar el número de capas o quitar materiales reempaqueta y sube todo.
+	class MaterialTable {
+	public:
+		static constexpr int MaxLayers = 8;
+
+		// Necesita ARB_shader_storage_buffer_object (GL 4.3) y ARB_program_interface_query
+		static bool supported();
+
+		MaterialTable() = default;
+		MaterialTable(const MaterialTable&) = delete;
+		MaterialTable& operator=(const MaterialTable&) = delete;
+
+		// Devuelve el índice del material; las capas que pasen de MaxLayers se ignoran
+		int add(const MaterialLayer* layers, int count);
+		void set(int material, const MaterialLayer* layers, int count);
+		// Quita los materiales a partir de count
+		void resize(size_t count);
+
+		size_t size() const { return m_Ranges.size(); }
+		int layerCount(int material) const { return m_Ranges[material].count; }
+		const MaterialLayer* layers(int material) const { return m_Layers.data() + m_Ranges[material].first; }
+
+		// Sube lo que haya cambiado y enlaza los dos buffers; necesita el contexto de GL
+		void bind(GLuint rangeBinding, GLuint layerBinding);
+		// Necesita el contexto de GL todavía vivo
+		void destroy();
+
+		size_t uploadedBytes() const { return m_UploadedBytes; }
+
+	private:
+		struct Range {
+			int32_t first = 0;
+			int32_t count = 0;
+		};
+
+		void repack();
+		void upload();
+
+		std::vector<Range> m_Ranges;
+		std::vector<MaterialLayer> m_Layers;
+		// Capas sueltas que quedan al cambiar el tamaño de un material; se recogen en repack()
+		size_t m_DeadLayers = 0;
+		bool m_Resized = true;
+		// Rango de materiales cambiados en su sitio desde la última subida
+		int m_DirtyBegin = 0;
+		int m_DirtyEnd = 0;
+		GLuint m_RangeBuffer = 0;
+		GLuint m_LayerBuffer = 0;
+		size_t m_UploadedBytes = 0;
+	};
+
+}
@@ -0,0 +1,345 @@
+#include "mipmaps.hpp"
+#include "jpegdecoder.hpp"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAPS_SSE
+#endif
+
+namespace myopengl {
+
+	namespace {
+
+		// Un píxel RGBA en float: un registro SSE
+#if defined(MIPMAPS_SSE)
+		typedef __m128 Pixel;
+		inline Pixel loadPixel(const float* p) { return _mm_loadu_ps(p); }
+		inline void storePixel(float* p, Pixel v) { _mm_storeu_ps(p, v); }
+		inline Pixel zeroPixel() { return _mm_setzero_ps(); }
+		inline Pixel addPixel(Pixel a, Pixel b) { return _mm_add_ps(a, b); }
+		inline Pixel scalePixel(Pixel a, float s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+		inline Pixel clampPixel(Pixel a) { return _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f)); }
+#else
+		struct Pixel { float v[4]; };
+		inline Pixel loadPixel(const float* p) { Pixel r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+		inline void storePixel(float* p, Pixel v) { std::memcpy(p, v.v, sizeof(v.v)); }
+		inline Pixel zeroPixel() { return Pixel{ { 0, 0, 0, 0 } }; }
+		inline Pixel addPixel(Pixel a, Pixel b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+		inline Pixel scalePixel(Pixel a, float s) { for (int i = 0; i < 4; i++) a.v[i] *= s; return a; }
+		inline Pixel clampPixel(Pixel a) { for (int i = 0; i < 4; i++) a.v[i] = std::min(std::max(a.v[i], 0.0f), 1.0f); return a; }
+#endif
+
+		// Tablas de conversión sRGB <-> lineal
+		struct ColorTables {
+			float toLinear[256];
+			unsigned char toSrgb[4096];
+
+			ColorTables()
+			{
+				for (int i = 0; i < 256; i++) {
+					float c = i / 255.0f;
+					toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+				for (int i = 0; i < 4096; i++) {
+					float l = i / 4095.0f;
+					float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+					toSrgb[i] = (unsigned char)std::clamp((int)(c * 255.0f + 0.5f), 0, 255);
+				}
+			}
+		};
+
+		const ColorTables& colorTables()
+		{
+			static const ColorTables tables;
+			return tables;
+		}
+
+		// Pesos de Kaiser para reducir a la mitad: el píxel de destino i cubre los de
+		// origen 2i y 2i+1; los taps van de 2i-3 a 2i+4
+		const int KaiserTaps = 8;
+		const int KaiserFirstTap = -3;
+
+		double besselI0(double x)
+		{
+			double sum = 1.0, term = 1.0;
+			for (int k = 1; k < 32; k++) {
+				term *= (x / (2.0 * k)) * (x / (2.0 * k));
+				sum += term;
+			}
+			return sum;
+		}
+
+		struct KaiserWeights {
+			float weights[KaiserTaps];
+
+			KaiserWeights()
+			{
+				const double alpha = 4.0, width = 2.0, pi = 3.14159265358979323846;
+				double total = 0.0;
+				double raw[KaiserTaps];
+				for (int k = 0; k < KaiserTaps; k++) {
+					// Distancia al centro del píxel de destino, en píxeles de destino
+					double x = ((KaiserFirstTap + k) + 0.5 - 1.0) / 2.0;
+					double sinc = std::fabs(x) < 1e-9 ? 1.0 : std::sin(pi * x) / (pi * x);
+					double t = x / width;
+					double window = std::fabs(t) >= 1.0 ? 0.0 : besselI0(alpha * std::sqrt(1.0 - t * t)) / besselI0(alpha);
+					raw[k] = sinc * window;
+					total += raw[k];
+				}
+				for (int k = 0; k < KaiserTaps; k++)
+					weights[k] = (float)(raw[k] / total);
+			}
+		};
+
+		const KaiserWeights& kaiserWeights()
+		{
+			static const KaiserWeights weights;
+			return weights;
+		}
+
+		int wrap(int i, int size)
+		{
+			i %= size;
+			return i < 0 ? i + size : i;
+		}
+
+		// Imagen RGBA float en espacio lineal (los niveles intermedios)
+		struct FloatImage {
+			int width = 0, height = 0;
+			std::vector<float> pixels;
+		};
+
+		// Fila y del nivel de origen en float RGBA: del nivel 0 en 8 bits se convierte
+		// a scratch; de un nivel intermedio se devuelve directamente
+		struct SourceLevel {
+			const unsigned char* bytes = nullptr;
+			const FloatImage* image = nullptr;
+			int width, height, channels;
+			bool srgb;
+
+			const float* row(int y, float* scratch) const
+			{
+				if (image)
+					return image->pixels.data() + (size_t)y * width * 4;
+
+				const ColorTables& tables = colorTables();
+				const unsigned char* src = bytes + (size_t)y * width * channels;
+				for (int x = 0; x < width; x++) {
+					for (int c = 0; c < 4; c++) {
+						float value;
+						if (c >= channels)
+							value = c == 3 ? 1.0f : 0.0f;
+						else if (srgb && c < 3 && channels >= 3)
+							value = tables.toLinear[src[x * channels + c]];
+						else
+							value = src[x * channels + c] / 255.0f;
+						scratch[x * 4 + c] = value;
+					}
+				}
+				return scratch;
+			}
+		};
+
+		// Filas del nivel 0 ya convertidas a float: las filas de destino consecutivas
+		// comparten 6 de sus 8 taps verticales, así que cada fila se convierte una vez
+		class RowCache {
+		public:
+			static const int Slots = KaiserTaps + 2;
+
+			explicit RowCache(const SourceLevel& source)
+				: m_Source(source), m_Rows((size_t)source.width * 4 * Slots), m_Tags(Slots, -1)
+			{
+			}
+
+			const float* row(int y)
+			{
+				if (m_Source.image)
+					return m_Source.row(y, nullptr);
+				int slot = y % Slots;
+				float* buffer = m_Rows.data() + (size_t)slot * m_Source.width * 4;
+				if (m_Tags[slot] != y) {
+					m_Source.row(y, buffer);
+					m_Tags[slot] = y;
+				}
+				return buffer;
+			}
+
+		private:
+			const SourceLevel& m_Source;
+			std::vector<float> m_Rows;
+			std::vector<int> m_Tags;
+		};
+
+		void writeRow(const float* linear, int width, int channels, bool srgb, unsigned char* dst)
+		{
+			const ColorTables& tables = colorTables();
+			for (int x = 0; x < width; x++) {
+				for (int c = 0; c < channels; c++) {
+					float value = std::min(std::max(linear[x * 4 + c], 0.0f), 1.0f);
+					if (srgb && c < 3 && channels >= 3)
+						dst[x * channels + c] = tables.toSrgb[(int)(value * 4095.0f + 0.5f)];
+					else
+						dst[x * channels + c] = (unsigned char)(value * 255.0f + 0.5f);
+				}
+			}
+		}
+
+		// Calcula las filas [begin, end) del nivel reducido
+		void downsampleRows(const SourceLevel& src, FloatImage& dst, MipFilter filter, int begin, int end)
+		{
+			RowCache rows(src);
+			std::vector<float> column((size_t)src.width * 4);
+			const size_t rowFloats = (size_t)src.width * 4;
+
+			for (int y = begin; y < end; y++) {
+				// Pasada vertical: una fila de ancho completo, 4 floats por registro
+				std::fill(column.begin(), column.end(), 0.0f);
+				if (filter == MipFilter::Box) {
+					const float* r0 = rows.row(std::min(2 * y, src.height - 1));
+					for (size_t i = 0; i < rowFloats; i += 4)
+						storePixel(&column[i], scalePixel(loadPixel(r0 + i), 0.5f));
+					const float* r1 = rows.row(std::min(2 * y + 1, src.height - 1));
+					for (size_t i = 0; i < rowFloats; i += 4)
+						storePixel(&column[i], addPixel(loadPixel(&column[i]), scalePixel(loadPixel(r1 + i), 0.5f)));
+				}
+				else {
+					const float* weights = kaiserWeights().weights;
+					for (int k = 0; k < KaiserTaps; k++) {
+						const float* r = rows.row(wrap(2 * y + KaiserFirstTap + k, src.height));
+						for (size_t i = 0; i < rowFloats; i += 4)
+							storePixel(&column[i], addPixel(loadPixel(&column[i]), scalePixel(loadPixel(r + i), weights[k])));
+					}
+				}
+
+				// Pasada horizontal: un píxel RGBA por registro
+				float* out = dst.pixels.data() + (size_t)y * dst.width * 4;
+				for (int x = 0; x < dst.width; x++) {
+					Pixel sum = zeroPixel();
+					if (filter == MipFilter::Box) {
+						sum = addPixel(loadPixel(&column[(size_t)std::min(2 * x, src.width - 1) * 4]),
+							loadPixel(&column[(size_t)std::min(2 * x + 1, src.width - 1) * 4]));
+						sum = scalePixel(sum, 0.5f);
+					}
+					else {
+						const float* weights = kaiserWeights().weights;
+						for (int k = 0; k < KaiserTaps; k++)
+							sum = addPixel(sum, scalePixel(loadPixel(&column[(size_t)wrap(2 * x + KaiserFirstTap + k, src.width) * 4]), weights[k]));
+						// Los lóbulos negativos del sinc pueden salirse de rango
+						sum = clampPixel(sum);
+					}
+					storePixel(out + (size_t)x * 4, sum);
+				}
+			}
+		}
+
+	}
+
+	std::vector<MipLevelLayout> mipChainLayout(int width, int height, int channels, size_t& totalSize)
+	{
+		std::vector<MipLevelLayout> levels;
+		totalSize = 0;
+		for (;;) {
+			MipLevelLayout level = { width, height, totalSize, (size_t)width * height * channels };
+			levels.push_back(level);
+			totalSize += level.size;
+			if (width == 1 && height == 1)
+				break;
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+		return levels;
+	}
+
+	void generateMipChain(const unsigned char* pixels, int width, int height, int channels, unsigned char* dst,
+		MipFilter filter, ThreadPool* pool, bool srgb)
+	{
+		size_t totalSize;
+		std::vector<MipLevelLayout> levels = mipChainLayout(width, height, channels, totalSize);
+		std::memcpy(dst + levels[0].offset, pixels, levels[0].size);
+
+		FloatImage previous, current;
+		SourceLevel source = { pixels, nullptr, width, height, channels, srgb };
+		for (size_t i = 1; i < levels.size(); i++) {
+			const MipLevelLayout& level = levels[i];
+			current.width = level.width;
+			current.height = level.height;
+			current.pixels.resize((size_t)level.width * level.height * 4);
+
+			auto body = [&](size_t begin, size_t end) {
+				downsampleRows(source, current, filter, (int)begin, (int)end);
+				for (size_t y = begin; y < end; y++) {
+					writeRow(current.pixels.data() + y * level.width * 4, level.width, channels, srgb,
+						dst + level.offset + y * level.width * channels);
+				}
+			};
+			if (pool)
+				pool->parallelFor(level.height, 16, body);
+			else
+				body(0, level.height);
+
+			// El siguiente nivel parte del float lineal, sin volver a cuantizar
+			previous.pixels.swap(current.pixels);
+			previous.width = current.width;
+			previous.height = current.height;
+			source = { nullptr, &previous, previous.width, previous.height, 4, false };
+		}
+	}
+
+	std::vector<MipBenchmarkResult> benchmarkMipGeneration(const std::vector<std::string>& paths, ThreadPool* pool)
+	{
+		typedef std::chrono::steady_clock Clock;
+		auto millisecondsSince = [](Clock::time_point start) {
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		};
+
+		std::vector<MipBenchmarkResult> results;
+		for (const std::string& path : paths) {
+			MipBenchmarkResult result;
+			result.path = path;
+			int channels;
+			unsigned char* data = loadImage(path.c_str(), &result.width, &result.height, &channels, 4);
+			if (!data) {
+				std::cout << "Failed to load texture at path: " << path << std::endl;
+				continue;
+			}
+
+			size_t totalSize;
+			mipChainLayout(result.width, result.height, 4, totalSize);
+			std::vector<unsigned char> chain(totalSize);
+
+			Clock::time_point start = Clock::now();
+			generateMipChain(data, result.width, result.height, 4, chain.data(), MipFilter::Box, pool);
+			result.boxMilliseconds = millisecondsSince(start);
+
+			start = Clock::now();
+			generateMipChain(data, result.width, result.height, 4, chain.data(), MipFilter::Kaiser, pool);
+			result.kaiserMilliseconds = millisecondsSince(start);
+
+			// glGenerateMipmap sobre el mismo nivel 0 ya subido; glFinish para medir el trabajo real
+			GLuint texture;
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, result.width, result.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+			glFinish();
+			start = Clock::now();
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glFinish();
+			result.glMilliseconds = millisecondsSince(start);
+			glDeleteTextures(1, &texture);
+			freeImage(data);
+
+			std::cout << "Mip benchmark " << path << " (" << result.width << "x" << result.height << "): box "
+				<< result.boxMilliseconds << " ms, Kaiser " << result.kaiserMilliseconds << " ms, glGenerateMipmap "
+				<< result.glMilliseconds << " ms" << std::endl;
+			results.push_back(result);
+		}
+		return results;
+	}
+
+}
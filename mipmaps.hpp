@@ -0,0 +1,40 @@
+#pragma once
+#include "threadpool.hpp"
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	enum class MipFilter {
+		Box,    // media 2x2
+		Kaiser  // sinc con ventana de Kaiser, 8 taps por eje
+	};
+
+	// Niveles hasta 1x1 guardados seguidos en un solo bloque, filas sin padding
+	struct MipLevelLayout {
+		int width, height;
+		size_t offset, size;
+	};
+
+	std::vector<MipLevelLayout> mipChainLayout(int width, int height, int channels, size_t& totalSize);
+
+	// Escribe en dst la cadena completa con la distribución de mipChainLayout(): el nivel 0
+	// es una copia y el resto se filtra en espacio lineal (los canales de color se tratan
+	// como sRGB salvo que srgb sea false; el alfa siempre es lineal). Cada nivel se reparte
+	// por filas en el pool si se pasa uno. dst solo se escribe, así que puede ser un PBO
+	// mapeado.
+	void generateMipChain(const unsigned char* pixels, int width, int height, int channels, unsigned char* dst,
+		MipFilter filter = MipFilter::Kaiser, ThreadPool* pool = nullptr, bool srgb = true);
+
+	// Tiempo de generar los mips de cada imagen en CPU (box y Kaiser) frente a glGenerateMipmap
+	struct MipBenchmarkResult {
+		std::string path;
+		int width = 0, height = 0;
+		double boxMilliseconds = 0.0;
+		double kaiserMilliseconds = 0.0;
+		double glMilliseconds = 0.0;
+	};
+
+	std::vector<MipBenchmarkResult> benchmarkMipGeneration(const std::vector<std::string>& paths, ThreadPool* pool);
+
+}
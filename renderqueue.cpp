@@ -0,0 +1,95 @@
+#include "renderqueue.hpp"
+#include <algorithm>
+
+namespace myopengl {
+
+	uint64_t makeSortKey(unsigned pass, unsigned program, unsigned material, float depth01)
+	{
+		float depth = std::clamp(depth01, 0.0f, 1.0f);
+		uint64_t depthBits = (uint64_t)(depth * (float)0xFFFFFF);
+		return ((uint64_t)(pass & 0xF) << 60) |
+			((uint64_t)(program & 0xFFF) << 48) |
+			((uint64_t)(material & 0xFFFFFF) << 24) |
+			(depthBits & 0xFFFFFF);
+	}
+
+	void RenderQueue::sort()
+	{
+		size_t count = m_Packets.size();
+		m_Entries.resize(count);
+		m_Scratch.resize(count);
+		for (size_t i = 0; i < count; i++)
+			m_Entries[i] = { m_Packets[i].key, (uint32_t)i };
+
+		// Histogramas de los 8 bytes en una sola pasada
+		size_t histograms[8][256] = {};
+		for (const SortEntry& entry : m_Entries)
+			for (int b = 0; b < 8; b++)
+				histograms[b][(entry.key >> (b * 8)) & 0xFF]++;
+
+		for (int b = 0; b < 8; b++) {
+			size_t* histogram = histograms[b];
+			// Si todas las claves comparten este byte la pasada no cambia nada
+			if (count == 0 || histogram[(m_Entries[0].key >> (b * 8)) & 0xFF] == count)
+				continue;
+
+			size_t offset = 0;
+			for (int i = 0; i < 256; i++) {
+				size_t n = histogram[i];
+				histogram[i] = offset;
+				offset += n;
+			}
+			for (const SortEntry& entry : m_Entries)
+				m_Scratch[histogram[(entry.key >> (b * 8)) & 0xFF]++] = entry;
+			m_Entries.swap(m_Scratch);
+		}
+	}
+
+	void RenderQueue::submit(GLuint objectBinding, RenderStats& stats)
+	{
+		Program* currentProgram = nullptr;
+		GLuint currentVertexArray = 0;
+		GLuint boundTextures[DrawPacket::MaxTextures] = {};
+		GLenum boundTargets[DrawPacket::MaxTextures] = {};
+
+		// Si no se llamó a sort() se envía en el orden de inserción
+		if (m_Entries.size() != m_Packets.size()) {
+			m_Entries.resize(m_Packets.size());
+			for (size_t i = 0; i < m_Packets.size(); i++)
+				m_Entries[i] = { m_Packets[i].key, (uint32_t)i };
+		}
+
+		for (const SortEntry& entry : m_Entries) {
+			const DrawPacket& packet = m_Packets[entry.index];
+
+			if (packet.program != currentProgram) {
+				packet.program->use();
+				currentProgram = packet.program;
+				stats.programSwitches++;
+			}
+			if (packet.vertexArray != currentVertexArray) {
+				glBindVertexArray(packet.vertexArray);
+				currentVertexArray = packet.vertexArray;
+				stats.vertexArrayBinds++;
+			}
+			for (int unit = 0; unit < DrawPacket::MaxTextures; unit++) {
+				GLuint texture = packet.textures[unit];
+				if (texture == 0 || (texture == boundTextures[unit] && packet.textureTarget == boundTargets[unit]))
+					continue;
+				glActiveTexture(GL_TEXTURE0 + unit);
+				glBindTexture(packet.textureTarget, texture);
+				boundTextures[unit] = texture;
+				boundTargets[unit] = packet.textureTarget;
+				stats.textureBinds++;
+			}
+
+			glBindBufferRange(GL_UNIFORM_BUFFER, objectBinding, packet.uniformBuffer,
+				packet.uniformOffset, packet.uniformSize);
+			glDrawElements(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, 0);
+			stats.draws++;
+		}
+
+		m_Entries.clear();
+	}
+
+}
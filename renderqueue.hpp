@@ -0,0 +1,62 @@
+#pragma once
+#include "shader.hpp"
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+
+namespace myopengl {
+
+	// Contadores de estado enviados a GL en un frame
+	struct RenderStats {
+		int draws = 0;
+		int textureBinds = 0;
+		int programSwitches = 0;
+		int vertexArrayBinds = 0;
+	};
+
+	// Todo lo que necesita un draw. Los campos de estado solo se aplican si cambian
+	// respecto al draw anterior de la cola ya ordenada.
+	struct DrawPacket {
+		static const int MaxTextures = 3;
+
+		uint64_t key = 0;
+		Program* program = nullptr;
+		GLuint vertexArray = 0;
+		GLenum textureTarget = GL_TEXTURE_2D;
+		GLuint textures[MaxTextures] = {};   // 0 = la unidad no se toca
+		GLuint uniformBuffer = 0;            // rango del bloque por objeto
+		GLintptr uniformOffset = 0;
+		GLsizeiptr uniformSize = 0;
+		GLsizei indexCount = 0;
+	};
+
+	// Clave de 64 bits: pass (4) | programa (12) | material (24) | profundidad (24).
+	// Ordenar por la clave agrupa los draws por estado y, dentro del mismo estado,
+	// de delante hacia atrás. depth01 se satura a [0, 1].
+	uint64_t makeSortKey(unsigned pass, unsigned program, unsigned material, float depth01);
+
+	class RenderQueue {
+	public:
+		void clear() { m_Packets.clear(); }
+		void reserve(size_t count) { m_Packets.reserve(count); }
+		void push(const DrawPacket& packet) { m_Packets.push_back(packet); }
+		size_t size() const { return m_Packets.size(); }
+
+		// Radix sort LSD de 8 bits sobre las claves (estable)
+		void sort();
+		// Envía los draws en orden saltándose los cambios de estado redundantes.
+		// objectBinding es el binding point del uniform block por objeto.
+		void submit(GLuint objectBinding, RenderStats& stats);
+
+	private:
+		struct SortEntry {
+			uint64_t key;
+			uint32_t index;
+		};
+
+		std::vector<DrawPacket> m_Packets;
+		std::vector<SortEntry> m_Entries;
+		std::vector<SortEntry> m_Scratch;
+	};
+
+}
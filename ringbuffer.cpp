@@ -0,0 +1,158 @@
+#include "ringbuffer.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace myopengl {
+
+	RingBuffer::~RingBuffer()
+	{
+		destroy();
+	}
+
+	bool RingBuffer::create(GLenum target, size_t bytesPerFrame)
+	{
+		destroy();
+		m_Target = target;
+		m_Persistent = GLEW_ARB_buffer_storage != 0;
+		allocateStorage(bytesPerFrame);
+		return m_Buffer != 0;
+	}
+
+	void RingBuffer::destroy()
+	{
+		for (int i = 0; i < FramesInFlight; i++) {
+			if (m_Fences[i])
+				glDeleteSync(m_Fences[i]);
+			m_Fences[i] = 0;
+		}
+
+		if (m_Buffer) {
+			if (m_Base || m_Mapped) {
+				glBindBuffer(m_Target, m_Buffer);
+				glUnmapBuffer(m_Target);
+			}
+			glDeleteBuffers(1, &m_Buffer);
+		}
+		m_Buffer = 0;
+		m_Base = nullptr;
+		m_Mapped = nullptr;
+		m_RegionSize = 0;
+		m_Head = 0;
+	}
+
+	void RingBuffer::allocateStorage(size_t bytesPerFrame)
+	{
+		GLenum target = m_Target;
+		bool persistent = m_Persistent;
+
+		// El buffer anterior puede seguir en uso por la GPU; GL retrasa su borrado
+		destroy();
+		m_Target = target;
+		m_Persistent = persistent;
+		m_RegionSize = bytesPerFrame;
+
+		glGenBuffers(1, &m_Buffer);
+		glBindBuffer(m_Target, m_Buffer);
+
+		GLsizeiptr totalSize = (GLsizeiptr)(m_RegionSize * FramesInFlight);
+		if (m_Persistent) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(m_Target, totalSize, NULL, flags);
+			m_Base = (unsigned char*)glMapBufferRange(m_Target, 0, totalSize, flags);
+			if (!m_Base) {
+				std::cout << "RingBuffer: persistent mapping failed, using per-frame mapping" << std::endl;
+				glDeleteBuffers(1, &m_Buffer);
+				m_Buffer = 0;
+				m_Persistent = false;
+				allocateStorage(bytesPerFrame);
+				return;
+			}
+		}
+		else {
+			glBufferData(m_Target, totalSize, NULL, GL_STREAM_DRAW);
+		}
+	}
+
+	void RingBuffer::waitRegion(int region)
+	{
+		GLsync fence = m_Fences[region];
+		if (!fence)
+			return;
+
+		// Normalmente el fence ya está señalizado: la región se usó hace FramesInFlight frames
+		for (;;) {
+			GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+				break;
+		}
+		glDeleteSync(fence);
+		m_Fences[region] = 0;
+	}
+
+	void RingBuffer::beginFrame(size_t bytesNeeded)
+	{
+		if (bytesNeeded > m_RegionSize) {
+			size_t grown = m_RegionSize * 2;
+			allocateStorage(bytesNeeded > grown ? bytesNeeded : grown);
+		}
+
+		m_Region = (m_Region + 1) % FramesInFlight;
+		waitRegion(m_Region);
+		m_Head = 0;
+		mapRegion();
+	}
+
+	void RingBuffer::mapRegion()
+	{
+		if (m_Persistent) {
+			m_Mapped = m_Base + m_Region * m_RegionSize;
+		}
+		else {
+			// El fence ya garantiza que la GPU terminó con esta región
+			glBindBuffer(m_Target, m_Buffer);
+			m_Mapped = (unsigned char*)glMapBufferRange(m_Target, (GLintptr)(m_Region * m_RegionSize), (GLsizeiptr)m_RegionSize,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		}
+	}
+
+	void* RingBuffer::allocate(size_t bytes, size_t alignment, GLintptr& offset)
+	{
+		// La alineación es la del offset en el buffer, no dentro de la región: el
+		// principio de la región solo está alineado si m_RegionSize lo está
+		size_t base = m_Region * m_RegionSize;
+		size_t start = alignUp(base + m_Head, alignment) - base;
+		if (m_Mapped && start + bytes > m_RegionSize && m_Head == 0) {
+			// Nada de este frame apunta aún a la región: se puede cambiar de buffer
+			allocateStorage(std::max(m_RegionSize * 2, bytes + alignment));
+			mapRegion();
+			base = m_Region * m_RegionSize;
+			start = alignUp(base, alignment) - base;
+		}
+		if (!m_Mapped || start + bytes > m_RegionSize) {
+			std::cout << "RingBuffer: out of space (" << start + bytes << " of " << m_RegionSize << " bytes)" << std::endl;
+			return nullptr;
+		}
+
+		m_Head = start + bytes;
+		offset = (GLintptr)(base + start);
+		return m_Mapped + start;
+	}
+
+	void RingBuffer::flush()
+	{
+		if (!m_Persistent && m_Mapped) {
+			glBindBuffer(m_Target, m_Buffer);
+			glUnmapBuffer(m_Target);
+			m_Mapped = nullptr;
+		}
+	}
+
+	void RingBuffer::endFrame()
+	{
+		flush();
+		if (m_Fences[m_Region])
+			glDeleteSync(m_Fences[m_Region]);
+		m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+
+namespace myopengl {
+
+	inline size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Buffer de streaming dividido en una región por frame en vuelo. Con
+	// GL_ARB_buffer_storage queda mapeado de forma persistente y coherente; si no,
+	// cada región se mapea sin sincronizar al empezar el frame y se desmapea en flush().
+	// Un fence por región evita escribir sobre datos que la GPU todavía está leyendo.
+	class RingBuffer {
+	public:
+		static const int FramesInFlight = 3;
+
+		RingBuffer() = default;
+		~RingBuffer();
+		RingBuffer(const RingBuffer&) = delete;
+		RingBuffer& operator=(const RingBuffer&) = delete;
+
+		bool create(GLenum target, size_t bytesPerFrame);
+		void destroy();
+
+		// Pasa a la siguiente región, esperando su fence. Crece si bytesNeeded no cabe;
+		// bytesNeeded debe incluir el relleno de alineación de cada allocate() del frame.
+		void beginFrame(size_t bytesNeeded = 0);
+		// Reserva bytes en la región actual con offset (relativo al buffer completo, como
+		// lo pide glBindBufferRange) múltiplo de alignment. La primera reserva del frame
+		// hace crecer el buffer si no cabe; las siguientes devuelven nullptr.
+		void* allocate(size_t bytes, size_t alignment, GLintptr& offset);
+		// Deja los datos visibles para la GPU (desmapea en el modo sin buffer_storage)
+		void flush();
+		// Coloca el fence de la región actual después de los draws que la usan
+		void endFrame();
+
+		GLuint id() const { return m_Buffer; }
+		GLenum target() const { return m_Target; }
+		bool persistent() const { return m_Persistent; }
+		size_t bytesPerFrame() const { return m_RegionSize; }
+		size_t bytesUsed() const { return m_Head; }
+
+	private:
+		void allocateStorage(size_t bytesPerFrame);
+		void waitRegion(int region);
+		void mapRegion();
+
+		GLuint m_Buffer = 0;
+		GLenum m_Target = GL_UNIFORM_BUFFER;
+		bool m_Persistent = false;
+		unsigned char* m_Base = nullptr;    // mapeo persistente de todo el buffer
+		unsigned char* m_Mapped = nullptr;  // puntero a la región actual
+		size_t m_RegionSize = 0;
+		size_t m_Head = 0;
+		int m_Region = 0;
+		GLsync m_Fences[FramesInFlight] = {};
+	};
+
+}
@@ -0,0 +1,575 @@
+#include "shader.hpp"
+#include <glm/gtc/type_ptr.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace myopengl {
+
+	GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource, bool retrievable)
+	{
+		GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShader, 1, &vertexSource, NULL);
+		glCompileShader(vertexShader);
+
+		// Check for shader compile errors
+		int success;
+		char infoLog[512];
+		glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+		}
+
+		GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+		glCompileShader(fragmentShader);
+
+		// Check for shader compile errors
+		glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+		}
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		if (retrievable)
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(program);
+
+		// Check for linking errors
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success) {
+			glGetProgramInfoLog(program, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		return program;
+	}
+
+	GLuint createComputeProgram(const char* computeSource)
+	{
+		GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(computeShader, 1, &computeSource, NULL);
+		glCompileShader(computeShader);
+
+		int success;
+		char infoLog[512];
+		glGetShaderiv(computeShader, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(computeShader, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+		}
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, computeShader);
+		glLinkProgram(program);
+
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success) {
+			glGetProgramInfoLog(program, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+
+		glDeleteShader(computeShader);
+		return program;
+	}
+
+	namespace {
+
+		// Cabecera de cada fichero de la caché de binarios
+		struct ProgramBinaryHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t sourceHash;
+			uint64_t driverHash;
+			uint32_t binaryFormat;
+			uint32_t binaryLength;
+			double compileMilliseconds;  // lo que costó compilar desde el fuente
+		};
+
+		const uint32_t ProgramBinaryMagic = 0x4e494250; // "PBIN"
+		const uint32_t ProgramBinaryVersion = 1;
+
+		std::string s_CacheDirectory;
+		uint64_t s_DriverHash = 0;
+		ProgramCacheStats s_CacheStats;
+
+		uint64_t fnv1a(const void* data, size_t length, uint64_t hash = 14695981039346656037ull)
+		{
+			const unsigned char* bytes = (const unsigned char*)data;
+			for (size_t i = 0; i < length; i++) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		uint64_t hashString(const char* text, uint64_t hash)
+		{
+			// El '\0' separa los strings para que "ab"+"c" y "a"+"bc" no coincidan
+			return fnv1a(text ? text : "", text ? std::strlen(text) + 1 : 1, hash);
+		}
+
+		double millisecondsSince(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		std::string cachePath(uint64_t sourceHash)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)(sourceHash ^ s_DriverHash));
+			return s_CacheDirectory + "/" + name;
+		}
+
+		// Devuelve un programa enlazado desde la caché, o 0 si no hay una entrada válida
+		GLuint loadProgramBinary(uint64_t sourceHash)
+		{
+			std::string path = cachePath(sourceHash);
+			std::ifstream file(path, std::ios::binary);
+			if (!file)
+				return 0;
+
+			auto start = std::chrono::steady_clock::now();
+			ProgramBinaryHeader header;
+			std::vector<char> binary;
+			bool valid = file.read((char*)&header, sizeof(header)) &&
+				header.magic == ProgramBinaryMagic && header.version == ProgramBinaryVersion &&
+				header.sourceHash == sourceHash && header.driverHash == s_DriverHash;
+			if (valid) {
+				binary.resize(header.binaryLength);
+				valid = (bool)file.read(binary.data(), binary.size());
+			}
+			file.close();
+
+			GLuint program = 0;
+			if (valid) {
+				program = glCreateProgram();
+				glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+				GLint success = 0;
+				glGetProgramiv(program, GL_LINK_STATUS, &success);
+				if (!success) {
+					glDeleteProgram(program);
+					program = 0;
+				}
+			}
+
+			if (!program) {
+				// Binario de otro driver, truncado o rechazado: se descarta y se recompila
+				std::cout << "Program cache: discarding stale entry " << path << std::endl;
+				std::error_code error;
+				std::filesystem::remove(path, error);
+				s_CacheStats.rejected++;
+				return 0;
+			}
+
+			double loadMilliseconds = millisecondsSince(start);
+			double saved = header.compileMilliseconds - loadMilliseconds;
+			s_CacheStats.hits++;
+			s_CacheStats.millisecondsSaved += saved;
+			std::cout << "Program cache: loaded " << path << " in " << loadMilliseconds << " ms (compile took "
+				<< header.compileMilliseconds << " ms, saved " << saved << " ms)" << std::endl;
+			return program;
+		}
+
+		void saveProgramBinary(GLuint program, uint64_t sourceHash, double compileMilliseconds)
+		{
+			GLint length = 0;
+			glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+			if (length <= 0)
+				return;
+
+			std::vector<char> binary(length);
+			ProgramBinaryHeader header = {};
+			header.magic = ProgramBinaryMagic;
+			header.version = ProgramBinaryVersion;
+			header.sourceHash = sourceHash;
+			header.driverHash = s_DriverHash;
+			header.compileMilliseconds = compileMilliseconds;
+			GLsizei written = 0;
+			glGetProgramBinary(program, length, &written, &header.binaryFormat, binary.data());
+			header.binaryLength = (uint32_t)written;
+
+			std::ofstream file(cachePath(sourceHash), std::ios::binary | std::ios::trunc);
+			file.write((const char*)&header, sizeof(header));
+			file.write(binary.data(), written);
+		}
+
+		GLuint buildProgram(const char* vertexSource, const char* fragmentSource)
+		{
+			if (s_CacheDirectory.empty())
+				return createShaderProgram(vertexSource, fragmentSource);
+
+			uint64_t sourceHash = hashString(fragmentSource, hashString(vertexSource, fnv1a("", 0)));
+			GLuint program = loadProgramBinary(sourceHash);
+			if (program)
+				return program;
+
+			s_CacheStats.misses++;
+			auto start = std::chrono::steady_clock::now();
+			program = createShaderProgram(vertexSource, fragmentSource, true);
+			double compileMilliseconds = millisecondsSince(start);
+
+			GLint success = 0;
+			glGetProgramiv(program, GL_LINK_STATUS, &success);
+			if (success)
+				saveProgramBinary(program, sourceHash, compileMilliseconds);
+			return program;
+		}
+
+	}
+
+	bool enableProgramBinaryCache(const std::string& directory)
+	{
+		GLint formats = 0;
+		if (GLEW_ARB_get_program_binary)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (formats <= 0) {
+			std::cout << "Program cache: driver exposes no program binary formats, cache disabled" << std::endl;
+			return false;
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		if (error) {
+			std::cout << "Program cache: cannot create " << directory << ": " << error.message() << std::endl;
+			return false;
+		}
+
+		s_CacheDirectory = directory;
+		s_DriverHash = hashString((const char*)glGetString(GL_VENDOR), fnv1a("", 0));
+		s_DriverHash = hashString((const char*)glGetString(GL_RENDERER), s_DriverHash);
+		s_DriverHash = hashString((const char*)glGetString(GL_VERSION), s_DriverHash);
+		return true;
+	}
+
+	const ProgramCacheStats& programBinaryCacheStats()
+	{
+		return s_CacheStats;
+	}
+
+	std::string loadShaderSource(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			std::cout << "Failed to load shader at path: " << path << std::endl;
+			return std::string();
+		}
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	std::string injectDefines(const char* source, const std::string& defines)
+	{
+		std::string result(source);
+		size_t version = result.find("#version");
+		size_t insertAt = 0;
+		if (version != std::string::npos) {
+			size_t lineEnd = result.find('\n', version);
+			insertAt = lineEnd == std::string::npos ? result.size() : lineEnd + 1;
+		}
+		result.insert(insertAt, defines);
+		return result;
+	}
+
+	// Bytes que ocupa un elemento de cada tipo de uniform en la caché de valores
+	static size_t uniformTypeBytes(GLenum type)
+	{
+		switch (type) {
+		case GL_FLOAT_VEC2: return 2 * sizeof(float);
+		case GL_FLOAT_VEC3: return 3 * sizeof(float);
+		case GL_FLOAT_VEC4: return 4 * sizeof(float);
+		case GL_FLOAT_MAT3: return 9 * sizeof(float);
+		case GL_FLOAT_MAT4: return 16 * sizeof(float);
+		default: return sizeof(int); // int, bool, float y samplers
+		}
+	}
+
+	Program::~Program()
+	{
+		destroy();
+	}
+
+	void Program::destroy()
+	{
+		if (m_Id)
+			glDeleteProgram(m_Id);
+		m_Id = 0;
+		m_Uniforms.clear();
+		m_Attributes.clear();
+		m_UniformBlocks.clear();
+		m_Cache.clear();
+	}
+
+	bool Program::build(const char* vertexSource, const char* fragmentSource)
+	{
+		destroy();
+		m_Id = buildProgram(vertexSource, fragmentSource);
+
+		int success;
+		glGetProgramiv(m_Id, GL_LINK_STATUS, &success);
+		reflect();
+		return success != 0;
+	}
+
+	bool Program::buildCompute(const char* computeSource)
+	{
+		destroy();
+		m_Id = createComputeProgram(computeSource);
+
+		int success;
+		glGetProgramiv(m_Id, GL_LINK_STATUS, &success);
+		reflect();
+		return success != 0;
+	}
+
+	void Program::reflect()
+	{
+		m_Uniforms.clear();
+		m_Attributes.clear();
+		m_UniformBlocks.clear();
+		m_Cache.clear();
+
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(m_Id, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(m_Id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<char> name(maxLength > 0 ? maxLength : 1);
+
+		for (GLint i = 0; i < count; i++) {
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(m_Id, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+
+			// Los miembros de uniform blocks no tienen location
+			GLint location = glGetUniformLocation(m_Id, name.data());
+			if (location < 0)
+				continue;
+
+			UniformInfo info;
+			info.name.assign(name.data(), length);
+			if (info.name.size() > 3 && info.name.compare(info.name.size() - 3, 3, "[0]") == 0)
+				info.name.resize(info.name.size() - 3);
+			info.location = location;
+			info.type = type;
+			info.size = size;
+			info.cacheOffset = m_Cache.size();
+			info.cacheBytes = uniformTypeBytes(type) * size;
+			info.uploaded = false;
+			m_Cache.resize(m_Cache.size() + info.cacheBytes);
+			m_Uniforms.push_back(info);
+		}
+
+		glGetProgramiv(m_Id, GL_ACTIVE_ATTRIBUTES, &count);
+		glGetProgramiv(m_Id, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+		name.resize(maxLength > 0 ? maxLength : 1);
+
+		for (GLint i = 0; i < count; i++) {
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveAttrib(m_Id, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+
+			AttributeInfo info;
+			info.name.assign(name.data(), length);
+			info.location = glGetAttribLocation(m_Id, name.data());
+			info.type = type;
+			info.size = size;
+			m_Attributes.push_back(info);
+		}
+
+		glGetProgramiv(m_Id, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+		glGetProgramiv(m_Id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+		name.resize(maxLength > 0 ? maxLength : 1);
+
+		for (GLint i = 0; i < count; i++) {
+			GLsizei length = 0;
+			glGetActiveUniformBlockName(m_Id, (GLuint)i, (GLsizei)name.size(), &length, name.data());
+
+			UniformBlockInfo info;
+			info.name.assign(name.data(), length);
+			info.index = (GLuint)i;
+			glGetActiveUniformBlockiv(m_Id, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &info.dataSize);
+			m_UniformBlocks.push_back(info);
+		}
+	}
+
+	int Program::findUniform(const char* name, const GLenum* types, int typeCount) const
+	{
+		for (size_t i = 0; i < m_Uniforms.size(); i++) {
+			if (m_Uniforms[i].name != name)
+				continue;
+
+			for (int t = 0; t < typeCount; t++) {
+				if (m_Uniforms[i].type == types[t])
+					return (int)i;
+			}
+			std::cout << "Uniform '" << name << "' has a different type than requested" << std::endl;
+			return -1;
+		}
+		return -1;
+	}
+
+	GLint Program::attribute(const char* name) const
+	{
+		for (const AttributeInfo& info : m_Attributes) {
+			if (info.name == name)
+				return info.location;
+		}
+		return -1;
+	}
+
+	bool Program::bindUniformBlock(const char* name, GLuint binding) const
+	{
+		for (const UniformBlockInfo& info : m_UniformBlocks) {
+			if (info.name == name) {
+				glUniformBlockBinding(m_Id, info.index, binding);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool Program::bindStorageBlock(const char* name, GLuint binding) const
+	{
+		if (!GLEW_ARB_shader_storage_buffer_object || !GLEW_ARB_program_interface_query)
+			return false;
+		GLuint index = glGetProgramResourceIndex(m_Id, GL_SHADER_STORAGE_BLOCK, name);
+		if (index == GL_INVALID_INDEX)
+			return false;
+		glShaderStorageBlockBinding(m_Id, index, binding);
+		return true;
+	}
+
+	bool Program::changed(int slot, const void* data, size_t bytes)
+	{
+		UniformInfo& info = m_Uniforms[slot];
+		if (bytes > info.cacheBytes)
+			bytes = info.cacheBytes;
+
+		unsigned char* cached = m_Cache.data() + info.cacheOffset;
+		if (info.uploaded && std::memcmp(cached, data, bytes) == 0) {
+			m_Skipped++;
+			return false;
+		}
+
+		std::memcpy(cached, data, bytes);
+		info.uploaded = true;
+		m_Uploads++;
+		return true;
+	}
+
+	void Program::set(Uniform<int> uniform, int value)
+	{
+		if (uniform.valid() && changed(uniform.slot, &value, sizeof(value)))
+			glUniform1i(m_Uniforms[uniform.slot].location, value);
+	}
+
+	void Program::set(Uniform<float> uniform, float value)
+	{
+		if (uniform.valid() && changed(uniform.slot, &value, sizeof(value)))
+			glUniform1f(m_Uniforms[uniform.slot].location, value);
+	}
+
+	void Program::set(Uniform<glm::vec4> uniform, const glm::vec4& value)
+	{
+		if (uniform.valid() && changed(uniform.slot, glm::value_ptr(value), sizeof(value)))
+			glUniform4fv(m_Uniforms[uniform.slot].location, 1, glm::value_ptr(value));
+	}
+
+	void Program::set(Uniform<glm::mat4> uniform, const glm::mat4& value)
+	{
+		if (uniform.valid() && changed(uniform.slot, glm::value_ptr(value), sizeof(value)))
+			glUniformMatrix4fv(m_Uniforms[uniform.slot].location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+
+	void Program::set(Uniform<int> uniform, const int* values, int count)
+	{
+		if (!uniform.valid())
+			return;
+
+		if (count > m_Uniforms[uniform.slot].size)
+			count = m_Uniforms[uniform.slot].size;
+		if (changed(uniform.slot, values, count * sizeof(int)))
+			glUniform1iv(m_Uniforms[uniform.slot].location, count, values);
+	}
+
+	void Program::set(Uniform<glm::vec4> uniform, const glm::vec4* values, int count)
+	{
+		if (!uniform.valid())
+			return;
+
+		if (count > m_Uniforms[uniform.slot].size)
+			count = m_Uniforms[uniform.slot].size;
+		if (changed(uniform.slot, values, count * sizeof(glm::vec4)))
+			glUniform4fv(m_Uniforms[uniform.slot].location, count, glm::value_ptr(values[0]));
+	}
+
+	void ProgramPermutations::setSources(const char* vertexSource, const char* fragmentSource,
+		DefinesFunction defines, SetupFunction setup)
+	{
+		m_VertexSource = vertexSource;
+		m_FragmentSource = fragmentSource;
+		m_Defines = defines;
+		m_Setup = setup;
+		m_Programs.clear();
+	}
+
+	Program& ProgramPermutations::get(unsigned key)
+	{
+		auto found = m_Programs.find(key);
+		if (found != m_Programs.end())
+			return *found->second;
+
+		std::string defines = m_Defines ? m_Defines(key) : std::string();
+		std::string vertex = injectDefines(m_VertexSource.c_str(), defines);
+		std::string fragment = injectDefines(m_FragmentSource.c_str(), defines);
+
+		std::unique_ptr<Program> program(new Program());
+		if (!program->build(vertex.c_str(), fragment.c_str()))
+			std::cout << "Shader permutation " << key << " failed to build" << std::endl;
+		if (m_Setup)
+			m_Setup(*program);
+
+		Program& result = *program;
+		m_Programs[key] = std::move(program);
+		return result;
+	}
+
+	bool ProgramPermutations::reload(const std::string& vertexSource, const std::string& fragmentSource)
+	{
+		std::unordered_map<unsigned, std::unique_ptr<Program>> programs;
+		for (const auto& entry : m_Programs) {
+			std::string defines = m_Defines ? m_Defines(entry.first) : std::string();
+			std::string vertex = injectDefines(vertexSource.c_str(), defines);
+			std::string fragment = injectDefines(fragmentSource.c_str(), defines);
+
+			std::unique_ptr<Program> program(new Program());
+			if (!program->build(vertex.c_str(), fragment.c_str())) {
+				std::cout << "Shader permutation " << entry.first << " failed to rebuild, keeping the previous program" << std::endl;
+				return false;
+			}
+			programs[entry.first] = std::move(program);
+		}
+
+		m_VertexSource = vertexSource;
+		m_FragmentSource = fragmentSource;
+		m_Programs.swap(programs);
+		if (m_Setup) {
+			for (const auto& entry : m_Programs)
+				m_Setup(*entry.second);
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace myopengl {
+
+	// Compila y enlaza un programa a partir del código fuente de los shaders.
+	// retrievable pide al driver que conserve el binario para glGetProgramBinary.
+	GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource, bool retrievable = false);
+	// Lo mismo con un compute shader (ARB_compute_shader); no pasa por la caché de binarios
+	GLuint createComputeProgram(const char* computeSource);
+
+	// Caché en disco de binarios de programa (GL_ARB_get_program_binary). Cada entrada
+	// se indexa por el hash del código fuente y de GL_VENDOR/GL_RENDERER/GL_VERSION;
+	// si el binario no coincide o el driver lo rechaza se recompila desde el fuente.
+	struct ProgramCacheStats {
+		int hits = 0;
+		int misses = 0;
+		int rejected = 0;
+		double millisecondsSaved = 0.0;
+	};
+
+	bool enableProgramBinaryCache(const std::string& directory);
+	const ProgramCacheStats& programBinaryCacheStats();
+
+	// Lee un shader de disco; cadena vacía (y mensaje) si no se puede abrir
+	std::string loadShaderSource(const std::string& path);
+
+	// Inserta líneas #define justo después de la directiva #version del shader
+	std::string injectDefines(const char* source, const std::string& defines);
+
+	// Handle tipado a un uniform reflejado; slot -1 si el programa no lo tiene activo
+	template <typename T>
+	struct Uniform {
+		int slot = -1;
+		bool valid() const { return slot >= 0; }
+	};
+
+	// Programa con reflexión de uniforms y atributos hecha una sola vez tras el link.
+	// Los set() guardan el último valor subido y omiten la llamada a GL si no cambió.
+	class Program {
+	public:
+		struct UniformInfo {
+			std::string name;   // sin el sufijo "[0]" de los arrays
+			GLint location;
+			GLenum type;
+			GLint size;         // número de elementos del array
+			size_t cacheOffset; // posición del último valor en m_Cache
+			size_t cacheBytes;
+			bool uploaded;
+		};
+
+		struct AttributeInfo {
+			std::string name;
+			GLint location;
+			GLenum type;
+			GLint size;
+		};
+
+		struct UniformBlockInfo {
+			std::string name;
+			GLuint index;
+			GLint dataSize;     // tamaño std140 que espera el shader
+		};
+
+		Program() = default;
+		~Program();
+		Program(const Program&) = delete;
+		Program& operator=(const Program&) = delete;
+
+		bool build(const char* vertexSource, const char* fragmentSource);
+		bool buildCompute(const char* computeSource);
+		void destroy();
+		void use() const { glUseProgram(m_Id); }
+		GLuint id() const { return m_Id; }
+
+		template <typename T>
+		Uniform<T> uniform(const char* name) const;
+		GLint attribute(const char* name) const;
+		// Asigna el binding point de un uniform block; false si el programa no lo usa
+		bool bindUniformBlock(const char* name, GLuint binding) const;
+		// Lo mismo para un shader storage block (ARB_shader_storage_buffer_object)
+		bool bindStorageBlock(const char* name, GLuint binding) const;
+
+		const std::vector<UniformInfo>& uniforms() const { return m_Uniforms; }
+		const std::vector<AttributeInfo>& attributes() const { return m_Attributes; }
+		const std::vector<UniformBlockInfo>& uniformBlocks() const { return m_UniformBlocks; }
+
+		// El programa tiene que estar en uso (use()) antes de llamar a set()
+		void set(Uniform<int> uniform, int value);
+		void set(Uniform<float> uniform, float value);
+		void set(Uniform<glm::vec4> uniform, const glm::vec4& value);
+		void set(Uniform<glm::mat4> uniform, const glm::mat4& value);
+		void set(Uniform<int> uniform, const int* values, int count);
+		void set(Uniform<glm::vec4> uniform, const glm::vec4* values, int count);
+
+		// Estadísticas de subidas de uniforms desde el último resetStats()
+		int uploadCount() const { return m_Uploads; }
+		int skippedCount() const { return m_Skipped; }
+		void resetStats() { m_Uploads = 0; m_Skipped = 0; }
+
+	private:
+		void reflect();
+		int findUniform(const char* name, const GLenum* types, int typeCount) const;
+		bool changed(int slot, const void* data, size_t bytes);
+
+		GLuint m_Id = 0;
+		std::vector<UniformInfo> m_Uniforms;
+		std::vector<AttributeInfo> m_Attributes;
+		std::vector<UniformBlockInfo> m_UniformBlocks;
+		std::vector<unsigned char> m_Cache;
+		int m_Uploads = 0;
+		int m_Skipped = 0;
+	};
+
+	template <>
+	inline Uniform<int> Program::uniform<int>(const char* name) const {
+		// Los samplers y bools también se suben con glUniform1i
+		static const GLenum types[] = { GL_INT, GL_BOOL, GL_SAMPLER_2D, GL_SAMPLER_2D_ARRAY };
+		return { findUniform(name, types, 4) };
+	}
+
+	template <>
+	inline Uniform<float> Program::uniform<float>(const char* name) const {
+		static const GLenum types[] = { GL_FLOAT };
+		return { findUniform(name, types, 1) };
+	}
+
+	template <>
+	inline Uniform<glm::vec4> Program::uniform<glm::vec4>(const char* name) const {
+		static const GLenum types[] = { GL_FLOAT_VEC4 };
+		return { findUniform(name, types, 1) };
+	}
+
+	template <>
+	inline Uniform<glm::mat4> Program::uniform<glm::mat4>(const char* name) const {
+		static const GLenum types[] = { GL_FLOAT_MAT4 };
+		return { findUniform(name, types, 1) };
+	}
+
+	// Variantes de un programa especializadas en compilación con #define. Cada bit de
+	// la clave activa una feature; las variantes se compilan la primera vez que se piden.
+	class ProgramPermutations {
+	public:
+		typedef std::function<std::string(unsigned key)> DefinesFunction;
+		typedef std::function<void(Program& program)> SetupFunction;
+
+		void setSources(const char* vertexSource, const char* fragmentSource,
+			DefinesFunction defines, SetupFunction setup);
+		Program& get(unsigned key);
+		// Cambia el código fuente recompilando solo las variantes ya pedidas. Si alguna
+		// falla se conservan las fuentes y los programas anteriores y devuelve false.
+		// Los Program& de get() dejan de ser válidos si devuelve true.
+		bool reload(const std::string& vertexSource, const std::string& fragmentSource);
+		void clear() { m_Programs.clear(); }
+		size_t size() const { return m_Programs.size(); }
+
+	private:
+		std::string m_VertexSource;
+		std::string m_FragmentSource;
+		DefinesFunction m_Defines;
+		SetupFunction m_Setup;
+		std::unordered_map<unsigned, std::unique_ptr<Program>> m_Programs;
+	};
+
+}
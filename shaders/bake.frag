@@ -0,0 +1,16 @@
+#version 330 core
+// Cocina una mezcla de multitextura: cada texel del nivel level es la suma de los
+// texels del mismo nivel de tres capas con sus pesos ya normalizados (BlendCache)
+uniform sampler2DArray sources;
+uniform int layers[3];
+uniform vec4 weights;
+uniform int level;
+
+out vec4 FragColor;
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    FragColor = texelFetch(sources, ivec3(texel, layers[0]), level) * weights.x +
+        texelFetch(sources, ivec3(texel, layers[1]), level) * weights.y +
+        texelFetch(sources, ivec3(texel, layers[2]), level) * weights.z;
+}
@@ -0,0 +1,56 @@
+#version 330 core
+#extension GL_ARB_shader_storage_buffer_object : require
+#ifndef DRAW_ID_ATTRIBUTE
+#extension GL_ARB_shader_draw_parameters : require
+#endif
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+
+#ifdef DRAW_ID_ATTRIBUTE
+// Sin ARB_shader_draw_parameters el baseInstance de cada comando es el índice del draw
+layout (location = 9) in uint aDrawId;
+#define DRAW_ID int(aDrawId)
+#else
+#define DRAW_ID gl_DrawIDARB
+#endif
+
+out vec3 Color;
+out vec2 TexCoord;
+flat out ivec4 Material;
+flat out vec4 MixRatios;
+
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
+
+// Mismos campos que InstanceData sin la matriz
+struct DrawMaterial {
+    ivec4 material;   // texIndex1, texIndex2, texIndex3, flags
+    vec4 mixRatios;
+};
+
+// Por draw: índice de la matriz y del material
+layout (std430) readonly buffer DrawRecords {
+    uvec2 drawRecords[];
+};
+
+layout (std430) readonly buffer DrawTransforms {
+    mat4 drawTransforms[];
+};
+
+layout (std430) readonly buffer DrawMaterials {
+    DrawMaterial drawMaterials[];
+};
+
+void main() {
+    uvec2 record = drawRecords[DRAW_ID];
+    DrawMaterial material = drawMaterials[record.y];
+    gl_Position = viewProjection * drawTransforms[record.x] * vec4(aPos, 1.0);
+    Color = aColor;
+    TexCoord = aTexCoord;
+    Material = material.material;
+    MixRatios = material.mixRatios;
+}
@@ -0,0 +1,148 @@
+#version 330 core
+#ifdef MATERIAL_TABLE
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
+in vec3 Color;
+in vec2 TexCoord;
+flat in ivec4 Material;
+flat in vec4 MixRatios;
+
+out vec4 FragColor;
+
+#if defined(TEXTURE_ARRAY)
+uniform sampler2DArray materials;
+
+vec4 sampleTexture(int index, vec2 dx, vec2 dy) {
+    return textureGrad(materials, vec3(TexCoord, float(index)), dx, dy);
+}
+#elif defined(ATLAS)
+uniform sampler2DArray atlas;
+
+layout (std140) uniform AtlasData {
+    vec4 atlasRects[ATLAS_MAX_ENTRIES];        // xy escala, zw offset
+    ivec4 atlasPages[ATLAS_MAX_ENTRIES / 4];
+};
+
+vec4 sampleTexture(int index, vec2 dx, vec2 dy) {
+    vec4 rect = atlasRects[index];
+    vec2 uv = clamp(TexCoord, 0.0, 1.0) * rect.xy + rect.zw;
+    return textureGrad(atlas, vec3(uv, float(atlasPages[index >> 2][index & 3])), dx * rect.xy, dy * rect.xy);
+}
+#else
+uniform sampler2D textures[8];
+
+// Los samplers solo se pueden indexar con constantes en GLSL 3.30
+vec4 sampleTexture(int index, vec2 dx, vec2 dy) {
+    switch (index) {
+        case 0: return textureGrad(textures[0], TexCoord, dx, dy);
+        case 1: return textureGrad(textures[1], TexCoord, dx, dy);
+        case 2: return textureGrad(textures[2], TexCoord, dx, dy);
+        case 3: return textureGrad(textures[3], TexCoord, dx, dy);
+        case 4: return textureGrad(textures[4], TexCoord, dx, dy);
+        case 5: return textureGrad(textures[5], TexCoord, dx, dy);
+        case 6: return textureGrad(textures[6], TexCoord, dx, dy);
+        default: return textureGrad(textures[7], TexCoord, dx, dy);
+    }
+}
+#endif
+
+#ifdef MATERIAL_TABLE
+struct MaterialLayer {
+    int texture;
+    float weight;
+};
+
+// MaterialTable: primera capa y número de capas de cada material
+layout (std430) readonly buffer MaterialRanges {
+    ivec2 materialRanges[];
+};
+
+layout (std430) readonly buffer MaterialLayers {
+    MaterialLayer materialLayers[];
+};
+
+// Suma de las capas del material con sus pesos (ya normalizados en la tabla)
+vec4 sampleMaterial(int material, vec2 dx, vec2 dy) {
+    ivec2 range = materialRanges[material];
+    vec4 color = vec4(0.0);
+    for (int i = 0; i < range.y; i++) {
+        MaterialLayer layer = materialLayers[range.x + i];
+        color += sampleTexture(layer.texture, dx, dy) * layer.weight;
+    }
+    return color;
+}
+#endif
+
+#ifdef SPLAT
+// Splat map: los canales de splatWeights son los pesos por texel de las capas
+// material.xyz y mixRatios.w de splatLayers, que se repiten mixRatios.x veces en cada cara
+uniform sampler2DArray splatLayers;
+uniform sampler2D splatWeights;
+
+vec4 sampleSplat(ivec4 layers, float tiling, vec2 dx, vec2 dy) {
+    vec4 weights = textureGrad(splatWeights, TexCoord, dx, dy);
+    float total = dot(weights, vec4(1.0));
+    weights = total > 0.0 ? weights / total : vec4(1.0, 0.0, 0.0, 0.0);
+
+    // Las derivadas vienen de fuera: las capas sin peso en este texel no se muestrean
+    vec2 uv = TexCoord * tiling;
+    vec4 color = vec4(0.0);
+    for (int i = 0; i < 4; i++) {
+        if (weights[i] > 0.0)
+            color += textureGrad(splatLayers, vec3(uv, float(layers[i])), dx * tiling, dy * tiling) * weights[i];
+    }
+    return color;
+}
+#endif
+
+#ifdef BAKED
+// Mezclas de multitextura cocinadas por BlendCache, una por capa
+uniform sampler2DArray bakedMaterials;
+#endif
+
+void main() {
+    bool useTexture = (Material.w & 1) != 0;
+    bool useMultiTexture = (Material.w & 2) != 0;
+    bool baked = (Material.w & 4) != 0;
+    bool splat = (Material.w & 8) != 0;
+
+    // Derivadas fuera del switch para que el mipmapping sea correcto
+    vec2 dx = dFdx(TexCoord);
+    vec2 dy = dFdy(TexCoord);
+
+#ifdef SPLAT
+    if(splat) {
+        FragColor = sampleSplat(ivec4(Material.xyz, int(MixRatios.w)), MixRatios.x, dx, dy);
+    } else
+#endif
+    if(useTexture) {
+#if defined(MATERIAL_TABLE)
+        // Material.x es el índice del material en la tabla
+        FragColor = sampleMaterial(Material.x, dx, dy);
+#else
+#ifdef BAKED
+        if(baked) {
+            FragColor = textureGrad(bakedMaterials, vec3(TexCoord, float(Material.x)), dx, dy);
+        } else
+#endif
+        if(useMultiTexture) {
+            vec4 tex1 = sampleTexture(Material.x, dx, dy) * MixRatios.x;
+            vec4 tex2 = sampleTexture(Material.y, dx, dy) * MixRatios.y;
+            vec4 tex3 = sampleTexture(Material.z, dx, dy) * MixRatios.z;
+
+            float totalRatio = MixRatios.x + MixRatios.y + MixRatios.z;
+            if (totalRatio > 0.0) {
+                tex1 *= (MixRatios.x / totalRatio);
+                tex2 *= (MixRatios.y / totalRatio);
+                tex3 *= (MixRatios.z / totalRatio);
+            }
+
+            FragColor = tex1 + tex2 + tex3;
+        } else {
+            FragColor = sampleTexture(Material.x, dx, dy);
+        }
+#endif
+    } else {
+        FragColor = vec4(Color, 1.0);
+    }
+}
@@ -0,0 +1,26 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in mat4 aModel;      // locations 3..6
+layout (location = 7) in ivec4 aMaterial;  // texIndex1, texIndex2, texIndex3, flags
+layout (location = 8) in vec4 aMixRatios;
+
+out vec3 Color;
+out vec2 TexCoord;
+flat out ivec4 Material;
+flat out vec4 MixRatios;
+
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
+
+void main() {
+    gl_Position = viewProjection * aModel * vec4(aPos, 1.0);
+    Color = aColor;
+    TexCoord = aTexCoord;
+    Material = aMaterial;
+    MixRatios = aMixRatios;
+}
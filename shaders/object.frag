@@ -0,0 +1,103 @@
+#version 330 core
+in vec3 Color;
+in vec2 TexCoord;
+
+out vec4 FragColor;
+
+layout (std140) uniform ObjectData {
+    mat4 model;
+    ivec4 material;
+    vec4 mixRatios;
+};
+
+#if defined(BAKED)
+// Mezcla de multitextura ya cocinada por BlendCache: una sola capa (material.x)
+uniform sampler2DArray bakedMaterials;
+#define LAYER1 texture(bakedMaterials, vec3(TexCoord, float(material.x)))
+#elif defined(TEXTURE_ARRAY)
+uniform sampler2DArray materials;
+#define LAYER1 texture(materials, vec3(TexCoord, float(material.x)))
+#define LAYER2 texture(materials, vec3(TexCoord, float(material.y)))
+#define LAYER3 texture(materials, vec3(TexCoord, float(material.z)))
+#elif defined(ATLAS)
+uniform sampler2DArray atlas;
+
+layout (std140) uniform AtlasData {
+    vec4 atlasRects[ATLAS_MAX_ENTRIES];        // xy escala, zw offset
+    ivec4 atlasPages[ATLAS_MAX_ENTRIES / 4];
+};
+
+// Las entradas no repiten: la coordenada se satura a su rectángulo y las derivadas se
+// escalan con él para que el mip sea el de la entrada
+vec4 sampleAtlas(int index) {
+    vec4 rect = atlasRects[index];
+    vec2 uv = clamp(TexCoord, 0.0, 1.0) * rect.xy + rect.zw;
+    return textureGrad(atlas, vec3(uv, float(atlasPages[index >> 2][index & 3])),
+        dFdx(TexCoord) * rect.xy, dFdy(TexCoord) * rect.xy);
+}
+
+#define LAYER1 sampleAtlas(material.x)
+#define LAYER2 sampleAtlas(material.y)
+#define LAYER3 sampleAtlas(material.z)
+#else
+#ifdef TEXTURED
+uniform sampler2D texture1;
+#define LAYER1 texture(texture1, TexCoord)
+#endif
+#if defined(MULTITEXTURE) && LAYER_COUNT >= 2
+uniform sampler2D texture2;
+#define LAYER2 texture(texture2, TexCoord)
+#endif
+#if defined(MULTITEXTURE) && LAYER_COUNT >= 3
+uniform sampler2D texture3;
+#define LAYER3 texture(texture3, TexCoord)
+#endif
+#endif
+
+#ifdef SPLAT
+// Splat map: los canales de splatWeights son los pesos por texel de las capas
+// material.xyz y mixRatios.w de splatLayers, que se repiten mixRatios.x veces en cada cara
+uniform sampler2DArray splatLayers;
+uniform sampler2D splatWeights;
+
+vec4 sampleSplat(ivec4 layers, float tiling, vec2 dx, vec2 dy) {
+    vec4 weights = textureGrad(splatWeights, TexCoord, dx, dy);
+    float total = dot(weights, vec4(1.0));
+    weights = total > 0.0 ? weights / total : vec4(1.0, 0.0, 0.0, 0.0);
+
+    // Las derivadas vienen de fuera: las capas sin peso en este texel no se muestrean
+    vec2 uv = TexCoord * tiling;
+    vec4 color = vec4(0.0);
+    for (int i = 0; i < 4; i++) {
+        if (weights[i] > 0.0)
+            color += textureGrad(splatLayers, vec3(uv, float(layers[i])), dx * tiling, dy * tiling) * weights[i];
+    }
+    return color;
+}
+#endif
+
+void main() {
+#if defined(SPLAT)
+    FragColor = sampleSplat(ivec4(material.xyz, int(mixRatios.w)), mixRatios.x, dFdx(TexCoord), dFdy(TexCoord));
+#elif defined(MULTITEXTURE)
+    // Combinación de múltiples texturas: cada capa pesa ratio * (ratio / totalRatio)
+    vec4 blended = LAYER1 * (mixRatios.x * mixRatios.x);
+    float totalRatio = mixRatios.x;
+#if LAYER_COUNT >= 2
+    blended += LAYER2 * (mixRatios.y * mixRatios.y);
+    totalRatio += mixRatios.y;
+#endif
+#if LAYER_COUNT >= 3
+    blended += LAYER3 * (mixRatios.z * mixRatios.z);
+    totalRatio += mixRatios.z;
+#endif
+    // Normalización de los ratios para asegurar que la suma es 1.0
+    FragColor = totalRatio > 0.0 ? blended / totalRatio : vec4(0.0);
+#elif defined(TEXTURED)
+    // Uso de una sola textura
+    FragColor = LAYER1;
+#else
+    // Sin textura, solo color
+    FragColor = vec4(Color, 1.0);
+#endif
+}
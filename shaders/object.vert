@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec3 Color;
+out vec2 TexCoord;
+
+// Datos de cámara, una vez por frame (binding FRAME_DATA_BINDING)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
+
+// Datos del objeto, un rango del ring buffer por draw (binding OBJECT_DATA_BINDING)
+layout (std140) uniform ObjectData {
+    mat4 model;
+    ivec4 material;   // texIndex1, texIndex2, texIndex3, flags
+    vec4 mixRatios;
+};
+
+void main() {
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
+    Color = aColor;
+    TexCoord = aTexCoord;
+}
@@ -0,0 +1,143 @@
+#include "splatmap.hpp"
+#include "jpegdecoder.hpp"
+#include "mipmaps.hpp"
+#include "texturestorage.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace myopengl {
+
+	namespace {
+
+		uint32_t hashLattice(int x, int y, uint32_t seed)
+		{
+			uint32_t h = seed ^ ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u);
+			h ^= h >> 16;
+			h *= 0x7feb352du;
+			h ^= h >> 15;
+			h *= 0x846ca68bu;
+			h ^= h >> 16;
+			return h;
+		}
+
+		// Ruido de valor en [0, 1] con una rejilla de period x period celdas que se repite
+		float periodicNoise(float u, float v, int period, uint32_t seed)
+		{
+			float x = u * period, y = v * period;
+			int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+			float fx = x - x0, fy = y - y0;
+			fx = fx * fx * (3.0f - 2.0f * fx);
+			fy = fy * fy * (3.0f - 2.0f * fy);
+
+			auto corner = [&](int cx, int cy) {
+				cx = ((cx % period) + period) % period;
+				cy = ((cy % period) + period) % period;
+				return (hashLattice(cx, cy, seed) & 0xffff) / 65535.0f;
+			};
+			float top = corner(x0, y0) + (corner(x0 + 1, y0) - corner(x0, y0)) * fx;
+			float bottom = corner(x0, y0 + 1) + (corner(x0 + 1, y0 + 1) - corner(x0, y0 + 1)) * fx;
+			return top + (bottom - top) * fy;
+		}
+
+	}
+
+	void SplatMap::generate(int size, uint32_t seed)
+	{
+		size = std::max(size, 1);
+		std::vector<unsigned char> pixels((size_t)size * size * 4);
+		// La cuarta capa sale menos para que quede como detalle
+		const float channelScale[4] = { 1.0f, 1.0f, 1.0f, 0.6f };
+
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				float u = (x + 0.5f) / size, v = (y + 0.5f) / size;
+				float weights[4];
+				float total = 0.0f;
+				for (int c = 0; c < 4; c++) {
+					uint32_t channelSeed = seed * 4 + c;
+					float n = periodicNoise(u, v, 4, channelSeed) * 0.7f + periodicNoise(u, v, 16, channelSeed + 101) * 0.3f;
+					// Potencia alta: zonas con una capa dominante y transiciones cortas
+					float w = std::pow(n, 6.0f) * channelScale[c];
+					weights[c] = w;
+					total += w;
+				}
+				unsigned char* texel = pixels.data() + ((size_t)y * size + x) * 4;
+				for (int c = 0; c < 4; c++)
+					texel[c] = (unsigned char)std::lround(total > 0.0f ? weights[c] / total * 255.0f : (c == 0 ? 255.0f : 0.0f));
+			}
+		}
+		upload(pixels.data(), size, size);
+	}
+
+	bool SplatMap::load(const std::string& path)
+	{
+		int width, height, channels;
+		unsigned char* data = loadImage(path.c_str(), &width, &height, &channels, 4);
+		if (!data)
+			return false;
+		// Sin alfa stbi lo rellena a 255: eso sería la cuarta capa al completo
+		if (channels < 4) {
+			for (size_t i = 0; i < (size_t)width * height; i++)
+				data[i * 4 + 3] = 0;
+		}
+		upload(data, width, height);
+		freeImage(data);
+		return true;
+	}
+
+	void SplatMap::upload(const unsigned char* pixels, int width, int height)
+	{
+		double sums[4] = { 0.0, 0.0, 0.0, 0.0 };
+		for (size_t i = 0; i < (size_t)width * height; i++) {
+			const unsigned char* texel = pixels + i * 4;
+			int total = texel[0] + texel[1] + texel[2] + texel[3];
+			for (int c = 0; c < 4; c++)
+				sums[c] += total > 0 ? (double)texel[c] / total : (c == 0 ? 1.0 : 0.0);
+		}
+		for (int c = 0; c < 4; c++)
+			m_Coverage[c] = (float)(sums[c] / ((double)width * height));
+
+		// Los pesos no son color: mips en lineal
+		size_t chainSize;
+		std::vector<MipLevelLayout> levels = mipChainLayout(width, height, 4, chainSize);
+		std::vector<unsigned char> chain(chainSize);
+		generateMipChain(pixels, width, height, 4, chain.data(), MipFilter::Box, &ThreadPool::shared(), false);
+
+		// Storage inmutable: si cambia el tamaño se crea otra textura
+		if (m_Texture && (width != m_Width || height != m_Height)) {
+			glDeleteTextures(1, &m_Texture);
+			m_Texture = 0;
+		}
+		if (!m_Texture) {
+			glGenTextures(1, &m_Texture);
+			glBindTexture(GL_TEXTURE_2D, m_Texture);
+			allocateTextureStorage2D(GL_TEXTURE_2D, (int)levels.size(), GL_RGBA8, width, height);
+		}
+		else {
+			glBindTexture(GL_TEXTURE_2D, m_Texture);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (size_t level = 0; level < levels.size(); level++) {
+			glTexSubImage2D(GL_TEXTURE_2D, (GLint)level, 0, 0, levels[level].width, levels[level].height, GL_RGBA,
+				GL_UNSIGNED_BYTE, chain.data() + levels[level].offset);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		m_Width = width;
+		m_Height = height;
+		std::cout << "Splat map: " << width << "x" << height << ", coverage " << m_Coverage[0] << " / " << m_Coverage[1]
+			<< " / " << m_Coverage[2] << " / " << m_Coverage[3] << std::endl;
+	}
+
+	void SplatMap::destroy()
+	{
+		if (m_Texture)
+			glDeleteTextures(1, &m_Texture);
+		m_Texture = 0;
+		m_Width = 0;
+		m_Height = 0;
+	}
+
+}
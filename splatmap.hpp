@@ -0,0 +1,52 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	// Capas del texture array que pinta cada canal del mapa de pesos y cuántas veces se
+	// repiten sobre la superficie (el mapa de pesos se estira una vez sobre cada cara)
+	struct SplatConfig {
+		bool useSplat = false;
+		int layers[4] = { 3, 4, 2, 0 };  // R, G, B, A
+		float tiling = 8.0f;
+	};
+
+	// Mapa de pesos RGBA8 para mezclar hasta cuatro capas por texel: cada canal es el peso
+	// de una capa y el shader los normaliza, así que no hace falta que sumen 255. Los mips
+	// se filtran en espacio lineal para que las transiciones lejanas no se oscurezcan.
+	// Sirve para superficies grandes con varios materiales en una sola pasada, sin
+	// partirlas en objetos con ratios distintos.
+	class SplatMap {
+	public:
+		SplatMap() = default;
+		SplatMap(const SplatMap&) = delete;
+		SplatMap& operator=(const SplatMap&) = delete;
+
+		// Pesos procedurales (ruido de valor periódico, un campo por canal) de size x size.
+		// Se repite sin costuras, así que funciona con el wrap GL_REPEAT del sampler.
+		void generate(int size, uint32_t seed);
+		// Pesos de una imagen: R, G, B y A son las cuatro capas; una imagen sin alfa deja
+		// la cuarta capa a 0. Si no se puede leer conserva el mapa anterior y devuelve false.
+		bool load(const std::string& path);
+
+		GLuint texture() const { return m_Texture; }
+		int width() const { return m_Width; }
+		int height() const { return m_Height; }
+		// Fracción media de cada capa en el mapa (después de normalizar por texel)
+		const float* coverage() const { return m_Coverage; }
+
+		// Necesita el contexto de GL todavía vivo
+		void destroy();
+
+	private:
+		void upload(const unsigned char* pixels, int width, int height);
+
+		GLuint m_Texture = 0;
+		int m_Width = 0, m_Height = 0;
+		float m_Coverage[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	};
+
+}
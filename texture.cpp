@@ -0,0 +1,190 @@
+#include "texture.hpp"
+#include "texturecontainer.hpp"
+#include "mipmaps.hpp"
+#include "texturestorage.hpp"
+#include "jpegdecoder.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace myopengl {
+
+	unsigned int loadTexture(const char* path)
+	{
+		// Un contenedor .mtex ya convertido evita decodificar la imagen
+		GLuint container = loadTextureContainerFor(path);
+		if (container)
+			return container;
+
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+
+		int width, height, nrChannels;
+		unsigned char* data = loadImage(path, &width, &height, &nrChannels, 0);
+
+		if (data) {
+			GLenum format = pixelFormatForChannels(nrChannels);
+
+			// Mips filtrados en CPU en espacio lineal en lugar de glGenerateMipmap
+			size_t chainSize;
+			std::vector<MipLevelLayout> levels = mipChainLayout(width, height, nrChannels, chainSize);
+			std::vector<unsigned char> chain(chainSize);
+			generateMipChain(data, width, height, nrChannels, chain.data(), MipFilter::Kaiser, &ThreadPool::shared());
+
+			// Storage inmutable; filtro y wrap los pone el sampler compartido
+			glBindTexture(GL_TEXTURE_2D, textureID);
+			allocateTextureStorage2D(GL_TEXTURE_2D, (int)levels.size(), internalFormatForChannels(nrChannels), width, height);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (size_t level = 0; level < levels.size(); level++) {
+				glTexSubImage2D(GL_TEXTURE_2D, (GLint)level, 0, 0, levels[level].width, levels[level].height, format,
+					GL_UNSIGNED_BYTE, chain.data() + levels[level].offset);
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+			freeImage(data);
+		}
+		else {
+			std::cout << "Failed to load texture at path: " << path << std::endl;
+			freeImage(data);
+		}
+
+		return textureID;
+	}
+
+	namespace {
+
+		// Píxeles de origen y pesos que contribuyen a un píxel de destino en un eje
+		struct Contribution {
+			int first;
+			std::vector<float> weights;
+		};
+
+		std::vector<Contribution> axisContributions(int srcSize, int dstSize)
+		{
+			std::vector<Contribution> result(dstSize);
+			float scale = (float)srcSize / (float)dstSize;
+
+			for (int i = 0; i < dstSize; i++) {
+				Contribution& c = result[i];
+				if (scale > 1.0f) {
+					// Reducción: media de los píxeles cubiertos por [start, end)
+					float start = i * scale;
+					float end = start + scale;
+					c.first = (int)start;
+					int last = std::min((int)std::ceil(end), srcSize);
+					for (int j = c.first; j < last; j++) {
+						float overlap = std::min(end, (float)(j + 1)) - std::max(start, (float)j);
+						c.weights.push_back(overlap / scale);
+					}
+				}
+				else {
+					// Ampliación: interpolación lineal entre los dos vecinos
+					float center = (i + 0.5f) * scale - 0.5f;
+					int j0 = (int)std::floor(center);
+					float t = center - j0;
+					int a = std::clamp(j0, 0, srcSize - 1);
+					int b = std::clamp(j0 + 1, 0, srcSize - 1);
+					c.first = a;
+					c.weights.assign(b - a + 1, 0.0f);
+					c.weights[0] += 1.0f - t;
+					c.weights[b - a] += t;
+				}
+			}
+			return result;
+		}
+
+	}
+
+	void resampleImage(const unsigned char* src, int srcWidth, int srcHeight,
+		unsigned char* dst, int dstWidth, int dstHeight, int channels)
+	{
+		std::vector<Contribution> columns = axisContributions(srcWidth, dstWidth);
+		std::vector<Contribution> rows = axisContributions(srcHeight, dstHeight);
+
+		// Pasada horizontal a un buffer intermedio en float, luego la vertical
+		std::vector<float> temp((size_t)dstWidth * srcHeight * channels);
+		for (int y = 0; y < srcHeight; y++) {
+			const unsigned char* srcRow = src + (size_t)y * srcWidth * channels;
+			float* tempRow = temp.data() + (size_t)y * dstWidth * channels;
+			for (int x = 0; x < dstWidth; x++) {
+				const Contribution& c = columns[x];
+				for (int ch = 0; ch < channels; ch++) {
+					float sum = 0.0f;
+					for (size_t k = 0; k < c.weights.size(); k++)
+						sum += c.weights[k] * srcRow[(c.first + k) * channels + ch];
+					tempRow[x * channels + ch] = sum;
+				}
+			}
+		}
+
+		for (int y = 0; y < dstHeight; y++) {
+			const Contribution& c = rows[y];
+			unsigned char* dstRow = dst + (size_t)y * dstWidth * channels;
+			for (int x = 0; x < dstWidth * channels; x++) {
+				float sum = 0.0f;
+				for (size_t k = 0; k < c.weights.size(); k++)
+					sum += c.weights[k] * temp[(c.first + k) * (size_t)dstWidth * channels + x];
+				dstRow[x] = (unsigned char)std::clamp(sum + 0.5f, 0.0f, 255.0f);
+			}
+		}
+	}
+
+	int floorPowerOfTwo(int value)
+	{
+		int result = 1;
+		while (result * 2 <= value)
+			result *= 2;
+		return result;
+	}
+
+	GLuint loadTextureArray(const std::vector<std::string>& paths, int maxLayerSize, int& layerWidth, int& layerHeight)
+	{
+		// Primero solo las cabeceras, para elegir el tamaño de capa antes de decodificar
+		layerWidth = maxLayerSize;
+		layerHeight = maxLayerSize;
+		for (const std::string& path : paths) {
+			int width, height, channels;
+			if (stbi_info(path.c_str(), &width, &height, &channels)) {
+				layerWidth = std::min(layerWidth, floorPowerOfTwo(width));
+				layerHeight = std::min(layerHeight, floorPowerOfTwo(height));
+			}
+		}
+
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+		size_t chainSize;
+		std::vector<MipLevelLayout> levels = mipChainLayout(layerWidth, layerHeight, 4, chainSize);
+		allocateTextureStorage3D(GL_TEXTURE_2D_ARRAY, (int)levels.size(), GL_RGBA8, layerWidth, layerHeight, (int)paths.size());
+
+		std::vector<unsigned char> resampled((size_t)layerWidth * layerHeight * 4);
+		std::vector<unsigned char> chain(chainSize);
+		for (size_t layer = 0; layer < paths.size(); layer++) {
+			int width, height, channels;
+			unsigned char* data = loadImage(paths[layer].c_str(), &width, &height, &channels, 4);
+			if (!data) {
+				std::cout << "Failed to load texture at path: " << paths[layer] << std::endl;
+				continue;
+			}
+
+			const unsigned char* pixels = data;
+			if (width != layerWidth || height != layerHeight) {
+				resampleImage(data, width, height, resampled.data(), layerWidth, layerHeight, 4);
+				pixels = resampled.data();
+			}
+
+			generateMipChain(pixels, layerWidth, layerHeight, 4, chain.data(), MipFilter::Kaiser, &ThreadPool::shared());
+			for (size_t level = 0; level < levels.size(); level++) {
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, (GLint)layer, levels[level].width, levels[level].height, 1,
+					GL_RGBA, GL_UNSIGNED_BYTE, chain.data() + levels[level].offset);
+			}
+			freeImage(data);
+		}
+
+		return textureID;
+	}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	// Function to load a texture from file
+	unsigned int loadTexture(const char* path);
+
+	// Reescala una imagen de 8 bits por canal con un filtro de caja (área) al reducir y
+	// bilineal al ampliar
+	void resampleImage(const unsigned char* src, int srcWidth, int srcHeight,
+		unsigned char* dst, int dstWidth, int dstHeight, int channels);
+
+	// Mayor potencia de dos que no supera value
+	int floorPowerOfTwo(int value);
+
+	// Carga varias imágenes como capas de un GL_TEXTURE_2D_ARRAY RGBA8 con mipmaps. El
+	// tamaño de capa es la mayor potencia de dos que cabe en la imagen más pequeña
+	// (limitada a maxLayerSize); las que no coinciden se reescalan al cargar.
+	GLuint loadTextureArray(const std::vector<std::string>& paths, int maxLayerSize, int& layerWidth, int& layerHeight);
+
+}
@@ -0,0 +1,216 @@
+#include "textureatlas.hpp"
+#include "jpegdecoder.hpp"
+#include "mipmaps.hpp"
+#include "texture.hpp"
+#include "texturestorage.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// imgui_draw.cpp compila su propia copia estática
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace myopengl {
+
+	namespace {
+
+		// Bloque std140 AtlasData
+		struct AtlasData {
+			float rects[TextureAtlas::MaxEntries][4];
+			GLint pages[TextureAtlas::MaxEntries];
+		};
+
+	}
+
+	TextureAtlas::TextureAtlas(int pageSize, int padding)
+		: m_PageSize(pageSize), m_Padding(floorPowerOfTwo(std::max(padding, 1)))
+	{
+		m_Levels = 1;
+		while ((1 << (m_Levels - 1)) < m_Padding)
+			m_Levels++;
+		m_Levels = std::min(m_Levels, mipLevelCount(pageSize, pageSize));
+	}
+
+	int TextureAtlas::add(const std::string& path, int maxSize)
+	{
+		int width, height, channels;
+		unsigned char* data = loadImage(path.c_str(), &width, &height, &channels, 4);
+		if (!data) {
+			std::cout << "Failed to load texture at path: " << path << std::endl;
+			return -1;
+		}
+
+		int index;
+		if (width > maxSize || height > maxSize) {
+			// Se conserva la proporción
+			float factor = (float)maxSize / std::max(width, height);
+			int scaledWidth = std::max(1, (int)(width * factor + 0.5f));
+			int scaledHeight = std::max(1, (int)(height * factor + 0.5f));
+			std::vector<unsigned char> scaled((size_t)scaledWidth * scaledHeight * 4);
+			resampleImage(data, width, height, scaled.data(), scaledWidth, scaledHeight, 4);
+			index = add(scaled.data(), scaledWidth, scaledHeight);
+		}
+		else {
+			index = add(data, width, height);
+		}
+		freeImage(data);
+		if (index < 0)
+			std::cout << "Texture does not fit in the atlas: " << path << std::endl;
+		return index;
+	}
+
+	int TextureAtlas::add(const unsigned char* rgba, int width, int height)
+	{
+		if (m_Texture || (int)m_Entries.size() >= MaxEntries || width <= 0 || height <= 0)
+			return -1;
+		if (cellSize(width) * m_Padding > m_PageSize || cellSize(height) * m_Padding > m_PageSize)
+			return -1;
+
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.pixels.assign(rgba, rgba + (size_t)width * height * 4);
+		m_Images.push_back(std::move(image));
+
+		AtlasEntry entry;
+		entry.width = width;
+		entry.height = height;
+		m_Entries.push_back(entry);
+		return (int)m_Entries.size() - 1;
+	}
+
+	bool TextureAtlas::build(ThreadPool* pool)
+	{
+		if (m_Texture || m_Entries.empty())
+			return false;
+
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point start = Clock::now();
+
+		// Se empaqueta en una rejilla de celdas de padding x padding texels: así cada
+		// entrada queda alineada para los mips sin que rectpack lo sepa
+		int gridSize = m_PageSize / m_Padding;
+		std::vector<stbrp_rect> remaining(m_Entries.size());
+		for (size_t i = 0; i < m_Entries.size(); i++) {
+			remaining[i].id = (int)i;
+			remaining[i].w = cellSize(m_Entries[i].width);
+			remaining[i].h = cellSize(m_Entries[i].height);
+		}
+
+		std::vector<stbrp_node> nodes(gridSize);
+		std::vector<std::vector<int>> pages;
+		size_t usedCells = 0;
+		while (!remaining.empty()) {
+			stbrp_context context;
+			stbrp_init_target(&context, gridSize, gridSize, nodes.data(), (int)nodes.size());
+			stbrp_pack_rects(&context, remaining.data(), (int)remaining.size());
+
+			std::vector<int> page;
+			std::vector<stbrp_rect> next;
+			for (const stbrp_rect& rect : remaining) {
+				if (!rect.was_packed) {
+					next.push_back(rect);
+					continue;
+				}
+				AtlasEntry& entry = m_Entries[rect.id];
+				entry.page = (int)pages.size();
+				entry.x = rect.x * m_Padding + m_Padding;
+				entry.y = rect.y * m_Padding + m_Padding;
+				usedCells += (size_t)rect.w * rect.h;
+				page.push_back(rect.id);
+			}
+			// add() ya comprueba que cada entrada cabe sola en una página
+			if (page.empty())
+				return false;
+			pages.push_back(page);
+			remaining.swap(next);
+		}
+
+		glGenTextures(1, &m_Texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_Texture);
+		allocateTextureStorage3D(GL_TEXTURE_2D_ARRAY, m_Levels, GL_RGBA8, m_PageSize, m_PageSize, (int)pages.size());
+
+		size_t chainSize = 0;
+		std::vector<MipLevelLayout> layout = mipChainLayout(m_PageSize, m_PageSize, 4, chainSize);
+		std::vector<unsigned char> pixels((size_t)m_PageSize * m_PageSize * 4);
+		std::vector<unsigned char> chain(chainSize);
+		for (size_t p = 0; p < pages.size(); p++) {
+			std::fill(pixels.begin(), pixels.end(), (unsigned char)0);
+			const std::vector<int>& page = pages[p];
+
+			// Cada entrada llena su celda entera, el padding con el texel de borde más cercano
+			auto body = [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					const AtlasEntry& entry = m_Entries[page[i]];
+					const Image& image = m_Images[page[i]];
+					int cellX = entry.x - m_Padding, cellY = entry.y - m_Padding;
+					int cellWidth = cellSize(entry.width) * m_Padding, cellHeight = cellSize(entry.height) * m_Padding;
+					for (int y = 0; y < cellHeight; y++) {
+						int sourceY = std::clamp(y - m_Padding, 0, image.height - 1);
+						const unsigned char* source = image.pixels.data() + (size_t)sourceY * image.width * 4;
+						unsigned char* row = pixels.data() + ((size_t)(cellY + y) * m_PageSize + cellX) * 4;
+						for (int x = 0; x < m_Padding; x++)
+							std::memcpy(row + x * 4, source, 4);
+						std::memcpy(row + m_Padding * 4, source, (size_t)image.width * 4);
+						for (int x = m_Padding + image.width; x < cellWidth; x++)
+							std::memcpy(row + x * 4, source + (size_t)(image.width - 1) * 4, 4);
+					}
+				}
+			};
+			if (pool)
+				pool->parallelFor(page.size(), 1, body);
+			else
+				body(0, page.size());
+
+			// Box y no Kaiser: el filtro 2x2 nunca sale de un bloque alineado
+			generateMipChain(pixels.data(), m_PageSize, m_PageSize, 4, chain.data(), MipFilter::Box, pool);
+			for (int level = 0; level < m_Levels; level++) {
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)p, layout[level].width, layout[level].height, 1,
+					GL_RGBA, GL_UNSIGNED_BYTE, chain.data() + layout[level].offset);
+			}
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		AtlasData data = {};
+		for (size_t i = 0; i < m_Entries.size(); i++) {
+			AtlasEntry& entry = m_Entries[i];
+			entry.scale[0] = (float)entry.width / m_PageSize;
+			entry.scale[1] = (float)entry.height / m_PageSize;
+			entry.offset[0] = (float)entry.x / m_PageSize;
+			entry.offset[1] = (float)entry.y / m_PageSize;
+			data.rects[i][0] = entry.scale[0];
+			data.rects[i][1] = entry.scale[1];
+			data.rects[i][2] = entry.offset[0];
+			data.rects[i][3] = entry.offset[1];
+			data.pages[i] = entry.page;
+		}
+		glGenBuffers(1, &m_UniformBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_UniformBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(AtlasData), &data, GL_STATIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		std::vector<Image>().swap(m_Images);
+		m_Stats.entries = (int)m_Entries.size();
+		m_Stats.pages = (int)pages.size();
+		m_Stats.usage = (float)usedCells / ((float)gridSize * gridSize * pages.size());
+		m_Stats.buildMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		std::cout << "Texture atlas: " << m_Stats.entries << " entries in " << m_Stats.pages << " pages of "
+			<< m_PageSize << "x" << m_PageSize << ", " << (int)(m_Stats.usage * 100.0f) << "% used, "
+			<< m_Stats.buildMilliseconds << " ms" << std::endl;
+		return true;
+	}
+
+	void TextureAtlas::destroy()
+	{
+		if (m_Texture)
+			glDeleteTextures(1, &m_Texture);
+		if (m_UniformBuffer)
+			glDeleteBuffers(1, &m_UniformBuffer);
+		m_Texture = 0;
+		m_UniformBuffer = 0;
+	}
+
+}
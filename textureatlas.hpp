@@ -0,0 +1,81 @@
+#pragma once
+#include "threadpool.hpp"
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	// Rectángulo de una imagen dentro del atlas. Las coordenadas de textura del objeto
+	// (en [0, 1]) pasan a uv * scale + offset en la capa page.
+	struct AtlasEntry {
+		int page = 0;
+		int x = 0, y = 0, width = 0, height = 0;  // texels de la página, sin el padding
+		float scale[2] = { 1.0f, 1.0f };
+		float offset[2] = { 0.0f, 0.0f };
+	};
+
+	struct AtlasStats {
+		int entries = 0;
+		int pages = 0;
+		float usage = 0.0f;             // fracción de las páginas ocupada, padding incluido
+		double buildMilliseconds = 0.0;
+	};
+
+	// Atlas de materiales pequeños empaquetados con imstb_rectpack en páginas cuadradas,
+	// que son las capas de un GL_TEXTURE_2D_ARRAY: objetos con imágenes distintas se
+	// dibujan sin cambiar de textura. Cada entrada se rodea de padding repitiendo sus
+	// bordes y empieza en un múltiplo de padding; los mips de cada página (box, en
+	// espacio lineal) llegan hasta el nivel en el que el padding es de un texel, así que
+	// ningún nivel mezcla entradas vecinas. Las entradas no repiten (no hay wrap): las
+	// coordenadas se saturan a [0, 1].
+	class TextureAtlas {
+	public:
+		// Capacidad del bloque std140 AtlasData: vec4 rects[MaxEntries] (xy escala,
+		// zw offset) seguido de ivec4 pages[MaxEntries / 4]
+		static const int MaxEntries = 64;
+
+		// padding se redondea a potencia de dos; los niveles de mip son log2(padding) + 1
+		explicit TextureAtlas(int pageSize = 2048, int padding = 8);
+		TextureAtlas(const TextureAtlas&) = delete;
+		TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+		// Añade una imagen como RGBA, reducida si algún lado pasa de maxSize. Devuelve el
+		// índice de la entrada (el que reciben los shaders) o -1 si no se puede cargar o
+		// no cabe en una página. Solo antes de build().
+		int add(const std::string& path, int maxSize);
+		int add(const unsigned char* rgba, int width, int height);
+
+		// Empaqueta las entradas, compone las páginas con sus mips y las sube junto con el
+		// bloque AtlasData. Necesita el contexto de GL; libera las imágenes en CPU.
+		bool build(ThreadPool* pool);
+		// Necesita el contexto de GL todavía vivo
+		void destroy();
+
+		GLuint texture() const { return m_Texture; }
+		GLuint uniformBuffer() const { return m_UniformBuffer; }
+		size_t size() const { return m_Entries.size(); }
+		const AtlasEntry& entry(size_t index) const { return m_Entries[index]; }
+		int levels() const { return m_Levels; }
+		const AtlasStats& stats() const { return m_Stats; }
+
+	private:
+		struct Image {
+			std::vector<unsigned char> pixels;
+			int width = 0, height = 0;
+		};
+
+		// Lado de la celda de una imagen en la rejilla de empaquetado (unidades de padding)
+		int cellSize(int size) const { return (size + 2 * m_Padding + m_Padding - 1) / m_Padding; }
+
+		int m_PageSize;
+		int m_Padding;
+		int m_Levels;
+		std::vector<AtlasEntry> m_Entries;
+		std::vector<Image> m_Images;
+		GLuint m_Texture = 0;
+		GLuint m_UniformBuffer = 0;
+		AtlasStats m_Stats;
+	};
+
+}
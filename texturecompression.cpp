@@ -0,0 +1,371 @@
+#include "texturecompression.hpp"
+#include "mipmaps.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace myopengl {
+
+	namespace {
+
+		// Cabecera de cada fichero de la caché de texturas comprimidas
+		struct CompressedTextureHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t internalFormat;
+			uint32_t width;
+			uint32_t height;
+			uint32_t levels;
+			uint64_t payloadSize;
+		};
+
+		const uint32_t CompressedTextureMagic = 0x58544342; // "BCTX"
+		const uint32_t CompressedTextureVersion = 1;
+
+		struct Color {
+			float r, g, b;
+		};
+
+		uint16_t packColor565(const Color& c)
+		{
+			int r = std::clamp((int)std::lround(c.r * 31.0f / 255.0f), 0, 31);
+			int g = std::clamp((int)std::lround(c.g * 63.0f / 255.0f), 0, 63);
+			int b = std::clamp((int)std::lround(c.b * 31.0f / 255.0f), 0, 31);
+			return (uint16_t)((r << 11) | (g << 5) | b);
+		}
+
+		Color unpackColor565(uint16_t packed)
+		{
+			int r = (packed >> 11) & 31;
+			int g = (packed >> 5) & 63;
+			int b = packed & 31;
+			return { (float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)) };
+		}
+
+		float distanceSquared(const Color& a, const Color& b)
+		{
+			float dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+			return dr * dr + dg * dg + db * db;
+		}
+
+		// Elige el índice de paleta más cercano para cada píxel y devuelve el error total
+		float assignIndices(const Color* pixels, uint16_t c0, uint16_t c1, uint32_t& indices)
+		{
+			Color palette[4];
+			palette[0] = unpackColor565(c0);
+			palette[1] = unpackColor565(c1);
+			palette[2] = { (2 * palette[0].r + palette[1].r) / 3, (2 * palette[0].g + palette[1].g) / 3, (2 * palette[0].b + palette[1].b) / 3 };
+			palette[3] = { (palette[0].r + 2 * palette[1].r) / 3, (palette[0].g + 2 * palette[1].g) / 3, (palette[0].b + 2 * palette[1].b) / 3 };
+
+			float error = 0.0f;
+			indices = 0;
+			for (int i = 0; i < 16; i++) {
+				int best = 0;
+				float bestDistance = distanceSquared(pixels[i], palette[0]);
+				for (int p = 1; p < 4; p++) {
+					float d = distanceSquared(pixels[i], palette[p]);
+					if (d < bestDistance) {
+						bestDistance = d;
+						best = p;
+					}
+				}
+				indices |= (uint32_t)best << (2 * i);
+				error += bestDistance;
+			}
+			return error;
+		}
+
+		// Extremos por mínimos cuadrados para unos índices dados (pesos 1, 0, 2/3, 1/3)
+		bool refineEndpoints(const Color* pixels, uint32_t indices, Color& end0, Color& end1)
+		{
+			static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+			float aa = 0, bb = 0, ab = 0;
+			Color ax = { 0, 0, 0 }, bx = { 0, 0, 0 };
+			for (int i = 0; i < 16; i++) {
+				float a = weights[(indices >> (2 * i)) & 3];
+				float b = 1.0f - a;
+				aa += a * a;
+				bb += b * b;
+				ab += a * b;
+				ax = { ax.r + a * pixels[i].r, ax.g + a * pixels[i].g, ax.b + a * pixels[i].b };
+				bx = { bx.r + b * pixels[i].r, bx.g + b * pixels[i].g, bx.b + b * pixels[i].b };
+			}
+			float det = aa * bb - ab * ab;
+			if (std::fabs(det) < 1e-6f)
+				return false;
+			float inv = 1.0f / det;
+			end0 = { (ax.r * bb - bx.r * ab) * inv, (ax.g * bb - bx.g * ab) * inv, (ax.b * bb - bx.b * ab) * inv };
+			end1 = { (bx.r * aa - ax.r * ab) * inv, (bx.g * aa - ax.g * ab) * inv, (bx.b * aa - ax.b * ab) * inv };
+			return true;
+		}
+
+		// Bloque de color BC1 en modo de 4 colores (c0 > c1)
+		void compressColorBlock(const unsigned char* block, unsigned char* dst)
+		{
+			Color pixels[16];
+			Color mean = { 0, 0, 0 };
+			for (int i = 0; i < 16; i++) {
+				pixels[i] = { (float)block[i * 4], (float)block[i * 4 + 1], (float)block[i * 4 + 2] };
+				mean = { mean.r + pixels[i].r / 16, mean.g + pixels[i].g / 16, mean.b + pixels[i].b / 16 };
+			}
+
+			// Eje principal de la covarianza por iteración de potencias
+			float cov[6] = {};
+			for (int i = 0; i < 16; i++) {
+				float r = pixels[i].r - mean.r, g = pixels[i].g - mean.g, b = pixels[i].b - mean.b;
+				cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+				cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+			}
+			Color axis = { 0.9f, 1.0f, 0.7f };
+			for (int iteration = 0; iteration < 4; iteration++) {
+				Color next = {
+					cov[0] * axis.r + cov[1] * axis.g + cov[2] * axis.b,
+					cov[1] * axis.r + cov[3] * axis.g + cov[4] * axis.b,
+					cov[2] * axis.r + cov[4] * axis.g + cov[5] * axis.b };
+				float length = std::max(std::fabs(next.r), std::max(std::fabs(next.g), std::fabs(next.b)));
+				if (length < 1e-6f)
+					break;
+				axis = { next.r / length, next.g / length, next.b / length };
+			}
+
+			// Los píxeles más extremos a lo largo del eje son los extremos iniciales
+			int minIndex = 0, maxIndex = 0;
+			float minDot = 1e30f, maxDot = -1e30f;
+			for (int i = 0; i < 16; i++) {
+				float d = pixels[i].r * axis.r + pixels[i].g * axis.g + pixels[i].b * axis.b;
+				if (d < minDot) { minDot = d; minIndex = i; }
+				if (d > maxDot) { maxDot = d; maxIndex = i; }
+			}
+
+			uint16_t c0 = packColor565(pixels[maxIndex]);
+			uint16_t c1 = packColor565(pixels[minIndex]);
+			uint32_t indices;
+			float error = assignIndices(pixels, c0, c1, indices);
+
+			Color end0, end1;
+			if (refineEndpoints(pixels, indices, end0, end1)) {
+				uint16_t r0 = packColor565(end0);
+				uint16_t r1 = packColor565(end1);
+				uint32_t refinedIndices;
+				float refinedError = assignIndices(pixels, r0, r1, refinedIndices);
+				if (refinedError < error) {
+					c0 = r0;
+					c1 = r1;
+					indices = refinedIndices;
+				}
+			}
+
+			// c0 <= c1 activaría el modo de 3 colores: intercambiar y remapear 0<->1, 2<->3
+			if (c0 < c1) {
+				std::swap(c0, c1);
+				indices ^= 0x55555555;
+			}
+			else if (c0 == c1) {
+				indices = 0;
+			}
+
+			dst[0] = (unsigned char)(c0 & 0xFF);
+			dst[1] = (unsigned char)(c0 >> 8);
+			dst[2] = (unsigned char)(c1 & 0xFF);
+			dst[3] = (unsigned char)(c1 >> 8);
+			for (int i = 0; i < 4; i++)
+				dst[4 + i] = (unsigned char)(indices >> (8 * i));
+		}
+
+		// Bloque de alfa BC3 en modo de 8 valores (a0 > a1)
+		void compressAlphaBlock(const unsigned char* block, unsigned char* dst)
+		{
+			int a0 = 0, a1 = 255;
+			for (int i = 0; i < 16; i++) {
+				a0 = std::max(a0, (int)block[i * 4 + 3]);
+				a1 = std::min(a1, (int)block[i * 4 + 3]);
+			}
+
+			uint64_t indices = 0;
+			if (a0 > a1) {
+				int palette[8] = { a0, a1 };
+				for (int p = 1; p < 7; p++)
+					palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+				for (int i = 0; i < 16; i++) {
+					int alpha = block[i * 4 + 3];
+					int best = 0;
+					for (int p = 1; p < 8; p++)
+						if (std::abs(palette[p] - alpha) < std::abs(palette[best] - alpha))
+							best = p;
+					indices |= (uint64_t)best << (3 * i);
+				}
+			}
+
+			dst[0] = (unsigned char)a0;
+			dst[1] = (unsigned char)a1;
+			for (int i = 0; i < 6; i++)
+				dst[2 + i] = (unsigned char)(indices >> (8 * i));
+		}
+
+		size_t blockBytes(BlockFormat format)
+		{
+			return format == BlockFormat::BC1 ? 8 : 16;
+		}
+
+	}
+
+	GLenum blockInternalFormat(BlockFormat format)
+	{
+		return format == BlockFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+
+	BlockFormat blockFormatForChannels(int channels)
+	{
+		return channels == 2 || channels == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+	}
+
+	size_t compressedLevelSize(int width, int height, BlockFormat format)
+	{
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+	}
+
+	std::vector<CompressedLevel> compressedMipChain(int width, int height, BlockFormat format, size_t& totalSize)
+	{
+		std::vector<CompressedLevel> levels;
+		totalSize = 0;
+		for (;;) {
+			CompressedLevel level = { width, height, totalSize, compressedLevelSize(width, height, format) };
+			levels.push_back(level);
+			totalSize += level.size;
+			if (width == 1 && height == 1)
+				break;
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+		return levels;
+	}
+
+	void compressImage(const unsigned char* rgba, int width, int height, BlockFormat format, unsigned char* dst)
+	{
+		unsigned char block[64];
+		for (int by = 0; by < height; by += 4) {
+			for (int bx = 0; bx < width; bx += 4) {
+				// Los bloques del borde repiten la última fila/columna
+				for (int y = 0; y < 4; y++) {
+					int sy = std::min(by + y, height - 1);
+					for (int x = 0; x < 4; x++) {
+						int sx = std::min(bx + x, width - 1);
+						std::memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+					}
+				}
+
+				if (format == BlockFormat::BC3) {
+					compressAlphaBlock(block, dst);
+					dst += 8;
+				}
+				compressColorBlock(block, dst);
+				dst += 8;
+			}
+		}
+	}
+
+	void compressMipChain(const unsigned char* rgba, int width, int height, BlockFormat format, unsigned char* dst,
+		ThreadPool* pool)
+	{
+		size_t totalSize;
+		std::vector<CompressedLevel> levels = compressedMipChain(width, height, format, totalSize);
+
+		// Mips filtrados en espacio lineal; mipChainLayout() sigue los mismos tamaños que
+		// compressedMipChain(), así que los niveles se emparejan por índice
+		size_t pixelBytes;
+		std::vector<MipLevelLayout> mips = mipChainLayout(width, height, 4, pixelBytes);
+		std::vector<unsigned char> pixels(pixelBytes);
+		generateMipChain(rgba, width, height, 4, pixels.data(), MipFilter::Kaiser, pool);
+		for (size_t i = 0; i < levels.size(); i++) {
+			const CompressedLevel& level = levels[i];
+			compressImage(pixels.data() + mips[i].offset, level.width, level.height, format, dst + level.offset);
+		}
+	}
+
+	void fillSolidBlocks(unsigned char* dst, size_t size, BlockFormat format,
+		unsigned char r, unsigned char g, unsigned char b, unsigned char a)
+	{
+		unsigned char pixels[64];
+		for (int i = 0; i < 16; i++) {
+			pixels[i * 4] = r;
+			pixels[i * 4 + 1] = g;
+			pixels[i * 4 + 2] = b;
+			pixels[i * 4 + 3] = a;
+		}
+		unsigned char block[16];
+		compressImage(pixels, 4, 4, format, block);
+
+		size_t bytes = blockBytes(format);
+		for (size_t offset = 0; offset + bytes <= size; offset += bytes)
+			std::memcpy(dst + offset, block, bytes);
+	}
+
+	uint64_t hashFileContents(const std::string& path, bool& ok)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		std::ifstream file(path, std::ios::binary);
+		ok = (bool)file;
+		char buffer[64 * 1024];
+		while (file) {
+			file.read(buffer, sizeof(buffer));
+			std::streamsize count = file.gcount();
+			for (std::streamsize i = 0; i < count; i++) {
+				hash ^= (unsigned char)buffer[i];
+				hash *= 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	std::string compressedCachePath(const std::string& directory, uint64_t sourceHash,
+		int width, int height, BlockFormat format)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "%016llx_%dx%d_%s.bct", (unsigned long long)sourceHash, width, height,
+			format == BlockFormat::BC1 ? "bc1" : "bc3");
+		return directory + "/" + name;
+	}
+
+	bool readCompressedCache(const std::string& path, int width, int height, BlockFormat format,
+		unsigned char* dst, size_t totalSize)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		CompressedTextureHeader header;
+		bool valid = file.read((char*)&header, sizeof(header)) &&
+			header.magic == CompressedTextureMagic && header.version == CompressedTextureVersion &&
+			header.internalFormat == blockInternalFormat(format) &&
+			header.width == (uint32_t)width && header.height == (uint32_t)height &&
+			header.payloadSize == totalSize;
+		return valid && file.read((char*)dst, totalSize);
+	}
+
+	bool writeCompressedCache(const std::string& path, int width, int height, BlockFormat format,
+		const unsigned char* data, size_t totalSize)
+	{
+		size_t unused;
+		CompressedTextureHeader header = {};
+		header.magic = CompressedTextureMagic;
+		header.version = CompressedTextureVersion;
+		header.internalFormat = blockInternalFormat(format);
+		header.width = width;
+		header.height = height;
+		header.levels = (uint32_t)compressedMipChain(width, height, format, unused).size();
+		header.payloadSize = totalSize;
+
+		// Se escribe a un temporal y se renombra, para no dejar entradas a medias
+		std::string temporary = path + ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (!file.write((const char*)&header, sizeof(header)) || !file.write((const char*)data, totalSize))
+				return false;
+		}
+		std::remove(path.c_str());
+		return std::rename(temporary.c_str(), path.c_str()) == 0;
+	}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "threadpool.hpp"
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	// Formatos de bloque 4x4 de EXT_texture_compression_s3tc
+	enum class BlockFormat {
+		BC1, // RGB, 8 bytes por bloque
+		BC3  // RGBA, 16 bytes por bloque
+	};
+
+	GLenum blockInternalFormat(BlockFormat format);
+	// BC3 si la imagen fuente tiene alfa (gris+alfa o RGBA), BC1 si no
+	BlockFormat blockFormatForChannels(int channels);
+	// Bytes de un nivel de width x height
+	size_t compressedLevelSize(int width, int height, BlockFormat format);
+
+	struct CompressedLevel {
+		int width, height;
+		size_t offset, size;
+	};
+
+	// Niveles hasta 1x1 con sus offsets dentro de un único bloque de datos
+	std::vector<CompressedLevel> compressedMipChain(int width, int height, BlockFormat format, size_t& totalSize);
+
+	// Comprime una imagen RGBA8 (width x height) a bloques en dst
+	void compressImage(const unsigned char* rgba, int width, int height, BlockFormat format, unsigned char* dst);
+	// Genera los mips con generateMipChain() y comprime la cadena completa en dst,
+	// con la distribución de compressedMipChain()
+	void compressMipChain(const unsigned char* rgba, int width, int height, BlockFormat format, unsigned char* dst,
+		ThreadPool* pool = nullptr);
+	// Rellena size bytes con bloques de un color uniforme (para placeholders)
+	void fillSolidBlocks(unsigned char* dst, size_t size, BlockFormat format,
+		unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+
+	// Caché en disco de cadenas ya comprimidas. La clave es el hash del contenido del
+	// fichero fuente junto con el tamaño y formato de destino.
+	struct TextureCacheStats {
+		int hits = 0;
+		int misses = 0;
+		size_t compressedBytes = 0;
+	};
+
+	uint64_t hashFileContents(const std::string& path, bool& ok);
+	std::string compressedCachePath(const std::string& directory, uint64_t sourceHash,
+		int width, int height, BlockFormat format);
+	// Lee totalSize bytes de payload si la cabecera coincide con lo esperado
+	bool readCompressedCache(const std::string& path, int width, int height, BlockFormat format,
+		unsigned char* dst, size_t totalSize);
+	bool writeCompressedCache(const std::string& path, int width, int height, BlockFormat format,
+		const unsigned char* data, size_t totalSize);
+
+}
@@ -0,0 +1,324 @@
+#include "texturecontainer.hpp"
+#include "mipmaps.hpp"
+#include "texturestorage.hpp"
+#include "texturecompression.hpp"
+#include "jpegdecoder.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace myopengl {
+
+	namespace {
+
+		const uint32_t TextureContainerMagic = 0x5845544d; // "MTEX"
+		const uint32_t TextureContainerVersion = 1;
+
+		size_t alignUp16(size_t value)
+		{
+			return (value + 15) & ~(size_t)15;
+		}
+
+		// Mayor lado aceptado; con él el tamaño de un nivel no desborda en 64 bits
+		const uint32_t MaxContainerSize = 1 << 16;
+
+		// Bytes que debe ocupar un nivel según el formato de la cabecera; 0 si el par
+		// internalFormat/format no es uno de los que escribe convertToTextureContainer()
+		uint64_t expectedLevelSize(const TextureContainerHeader& header, uint32_t width, uint32_t height)
+		{
+			if (header.compressed) {
+				if (header.format != 0)
+					return 0;
+				if (header.internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+					return compressedLevelSize((int)width, (int)height, BlockFormat::BC1);
+				if (header.internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+					return compressedLevelSize((int)width, (int)height, BlockFormat::BC3);
+				return 0;
+			}
+			if (header.internalFormat == GL_RGB8 && header.format == GL_RGB)
+				return (uint64_t)width * height * 3;
+			if (header.internalFormat == GL_RGBA8 && header.format == GL_RGBA)
+				return (uint64_t)width * height * 4;
+			return 0;
+		}
+
+		// Cada nivel dentro del fichero, con la mitad de tamaño que el anterior y
+		// exactamente los bytes de su formato
+		bool validLevels(const TextureContainerHeader& header, const TextureContainerLevel* levels, size_t fileSize)
+		{
+			uint32_t width = header.width, height = header.height;
+			for (uint32_t i = 0; i < header.levels; i++) {
+				const TextureContainerLevel& level = levels[i];
+				if (level.width != width || level.height != height)
+					return false;
+				if (level.offset > fileSize || level.size > fileSize - level.offset)
+					return false;
+				if (level.size != expectedLevelSize(header, width, height))
+					return false;
+				width = std::max(1u, width / 2);
+				height = std::max(1u, height / 2);
+			}
+			return true;
+		}
+
+	}
+
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!mapping) {
+			CloseHandle(file);
+			return false;
+		}
+		m_Data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_Data) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		m_File = file;
+		m_Mapping = mapping;
+		m_Size = (size_t)size.QuadPart;
+#else
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size == 0) {
+			::close(file);
+			return false;
+		}
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED) {
+			::close(file);
+			return false;
+		}
+		m_File = file;
+		m_Data = (const unsigned char*)data;
+		m_Size = (size_t)info.st_size;
+#endif
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+#ifdef _WIN32
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_Mapping)
+			CloseHandle(m_Mapping);
+		if (m_File)
+			CloseHandle(m_File);
+		m_Mapping = nullptr;
+		m_File = nullptr;
+#else
+		if (m_Data)
+			munmap((void*)m_Data, m_Size);
+		if (m_File >= 0)
+			::close(m_File);
+		m_File = -1;
+#endif
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	std::string textureContainerPath(const std::string& imagePath)
+	{
+		return std::filesystem::path(imagePath).replace_extension(TextureContainerExtension).string();
+	}
+
+	GLuint loadTextureContainerFor(const std::string& imagePath)
+	{
+		std::string containerPath = textureContainerPath(imagePath);
+		std::error_code error;
+		if (!std::filesystem::exists(containerPath, error))
+			return 0;
+		// Si la imagen se editó después de convertirla, el contenedor ya no vale
+		if (std::filesystem::last_write_time(containerPath, error) < std::filesystem::last_write_time(imagePath, error))
+			return 0;
+		return loadTextureContainer(containerPath);
+	}
+
+	bool openTextureContainer(const std::string& path, MappedFile& file,
+		const TextureContainerHeader*& header, const TextureContainerLevel*& levels)
+	{
+		if (!file.open(path))
+			return false;
+
+		// Validar cabecera y tabla antes de tocar GL: un contenedor truncado o con niveles
+		// que no cuadran con su tamaño no debe hacer que glTexImage lea fuera de la proyección
+		header = (const TextureContainerHeader*)file.data();
+		if (file.size() < sizeof(TextureContainerHeader) || header->magic != TextureContainerMagic ||
+			header->version != TextureContainerVersion || header->width == 0 || header->height == 0 ||
+			header->width > MaxContainerSize || header->height > MaxContainerSize || header->levels == 0 ||
+			header->levels > (uint32_t)mipLevelCount((int)header->width, (int)header->height) ||
+			file.size() < sizeof(TextureContainerHeader) + header->levels * sizeof(TextureContainerLevel)) {
+			std::cout << "Texture container: invalid file " << path << std::endl;
+			file.close();
+			return false;
+		}
+		levels = (const TextureContainerLevel*)(header + 1);
+		if (!validLevels(*header, levels, file.size())) {
+			std::cout << "Texture container: invalid level table in " << path << std::endl;
+			file.close();
+			return false;
+		}
+		return true;
+	}
+
+	GLuint loadTextureContainer(const std::string& path)
+	{
+		MappedFile file;
+		const TextureContainerHeader* header;
+		const TextureContainerLevel* levels;
+		if (!openTextureContainer(path, file, header, levels))
+			return 0;
+		if (header->compressed && !GLEW_EXT_texture_compression_s3tc)
+			return 0;
+
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		allocateTextureStorage2D(GL_TEXTURE_2D, (int)header->levels, header->internalFormat, header->width, header->height);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (uint32_t i = 0; i < header->levels; i++) {
+			const unsigned char* pixels = file.data() + levels[i].offset;
+			if (header->compressed) {
+				glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, levels[i].width, levels[i].height,
+					header->internalFormat, (GLsizei)levels[i].size, pixels);
+			}
+			else {
+				glTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, levels[i].width, levels[i].height,
+					header->format, GL_UNSIGNED_BYTE, pixels);
+			}
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		return textureID;
+	}
+
+	bool convertToTextureContainer(const std::string& imagePath, const std::string& containerPath, bool compress)
+	{
+		int width, height, sourceChannels;
+		int channels = 3;
+		if (stbi_info(imagePath.c_str(), &width, &height, &sourceChannels) && (sourceChannels == 2 || sourceChannels == 4))
+			channels = 4;
+		// BCn siempre parte de RGBA
+		unsigned char* data = loadImage(imagePath.c_str(), &width, &height, &sourceChannels, compress ? 4 : channels);
+		if (!data) {
+			std::cout << "Failed to load texture at path: " << imagePath << std::endl;
+			return false;
+		}
+
+		TextureContainerHeader header = {};
+		header.magic = TextureContainerMagic;
+		header.version = TextureContainerVersion;
+		header.width = width;
+		header.height = height;
+
+		std::vector<TextureContainerLevel> levels;
+		std::vector<unsigned char> payload;
+		size_t tableSize = sizeof(TextureContainerHeader);
+
+		if (compress) {
+			BlockFormat format = blockFormatForChannels(channels);
+			size_t totalSize;
+			std::vector<CompressedLevel> chain = compressedMipChain(width, height, format, totalSize);
+			payload.resize(totalSize);
+			compressMipChain(data, width, height, format, payload.data(), &ThreadPool::shared());
+			for (const CompressedLevel& level : chain)
+				levels.push_back({ (uint32_t)level.width, (uint32_t)level.height, level.offset, level.size });
+			header.internalFormat = blockInternalFormat(format);
+			header.format = 0;
+			header.compressed = 1;
+		}
+		else {
+			// Mips en espacio lineal; cada nivel se copia a su offset alineado a 16
+			size_t chainSize;
+			std::vector<MipLevelLayout> chain = mipChainLayout(width, height, channels, chainSize);
+			std::vector<unsigned char> pixels(chainSize);
+			generateMipChain(data, width, height, channels, pixels.data(), MipFilter::Kaiser, &ThreadPool::shared());
+			for (const MipLevelLayout& level : chain) {
+				size_t offset = alignUp16(payload.size());
+				payload.resize(offset + level.size);
+				std::copy(pixels.begin() + level.offset, pixels.begin() + level.offset + level.size, payload.begin() + offset);
+				levels.push_back({ (uint32_t)level.width, (uint32_t)level.height, offset, level.size });
+			}
+			header.internalFormat = channels == 4 ? GL_RGBA8 : GL_RGB8;
+			header.format = channels == 4 ? GL_RGBA : GL_RGB;
+			header.compressed = 0;
+		}
+		freeImage(data);
+
+		// Los offsets de los niveles pasan a ser absolutos, detrás de la tabla
+		header.levels = (uint32_t)levels.size();
+		tableSize += levels.size() * sizeof(TextureContainerLevel);
+		uint64_t payloadStart = alignUp16(tableSize);
+		for (TextureContainerLevel& level : levels)
+			level.offset += payloadStart;
+
+		std::string temporary = containerPath + ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			const char padding[16] = {};
+			if (!file.write((const char*)&header, sizeof(header)) ||
+				!file.write((const char*)levels.data(), levels.size() * sizeof(TextureContainerLevel)) ||
+				!file.write(padding, payloadStart - tableSize) ||
+				!file.write((const char*)payload.data(), payload.size())) {
+				std::cout << "Texture container: cannot write " << containerPath << std::endl;
+				return false;
+			}
+		}
+		std::remove(containerPath.c_str());
+		return std::rename(temporary.c_str(), containerPath.c_str()) == 0;
+	}
+
+	int convertTextureFolder(const std::string& directory, bool compress)
+	{
+		int converted = 0;
+		std::error_code error;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error)) {
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			if (extension != ".jpg" && extension != ".jpeg" && extension != ".png")
+				continue;
+
+			std::string source = entry.path().string();
+			std::string target = textureContainerPath(source);
+			if (convertToTextureContainer(source, target, compress)) {
+				std::cout << "Converted " << source << " -> " << target << std::endl;
+				converted++;
+			}
+		}
+		if (error)
+			std::cout << "Texture container: cannot read " << directory << ": " << error.message() << std::endl;
+		return converted;
+	}
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+namespace myopengl {
+
+	// Fichero de solo lectura proyectado en memoria (mmap / MapViewOfFile)
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile() { close(); }
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& path);
+		void close();
+
+		const unsigned char* data() const { return m_Data; }
+		size_t size() const { return m_Size; }
+
+	private:
+		const unsigned char* m_Data = nullptr;
+		size_t m_Size = 0;
+#ifdef _WIN32
+		void* m_File = nullptr;
+		void* m_Mapping = nullptr;
+#else
+		int m_File = -1;
+#endif
+	};
+
+	// Contenedor .mtex: cabecera, tabla de niveles y los mips ya calculados, con el
+	// payload en el formato final de GL (RGB8/RGBA8 o bloques BC1/BC3). Las filas no
+	// tienen padding y la imagen ya está volteada como la deja stbi.
+	struct TextureContainerHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levels;
+		uint32_t internalFormat;  // GL_RGB8, GL_RGBA8 o un formato S3TC
+		uint32_t format;          // GL_RGB / GL_RGBA para los no comprimidos, 0 si comprimido
+		uint32_t compressed;
+	};
+
+	struct TextureContainerLevel {
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;          // desde el principio del fichero, alineado a 16
+		uint64_t size;
+	};
+
+	// Extensión de los contenedores; loadTexture() los busca junto a cada imagen
+	const char* const TextureContainerExtension = ".mtex";
+
+	// Ruta del contenedor que corresponde a una imagen ("a/b.jpg" -> "a/b.mtex")
+	std::string textureContainerPath(const std::string& imagePath);
+
+	// Carga el contenedor de una imagen si existe y no es más antiguo que ella; 0 si no
+	GLuint loadTextureContainerFor(const std::string& imagePath);
+
+	// Proyecta el fichero y valida la cabecera y la tabla de niveles, sin tocar GL.
+	// header y levels apuntan dentro de la proyección mientras file siga abierto.
+	bool openTextureContainer(const std::string& path, MappedFile& file,
+		const TextureContainerHeader*& header, const TextureContainerLevel*& levels);
+
+	// Proyecta el fichero y sube cada nivel directamente desde la proyección. Devuelve
+	// 0 si no existe o no es válido.
+	GLuint loadTextureContainer(const std::string& path);
+
+	// Decodifica una imagen con stbi, genera sus mips y la guarda como contenedor.
+	// Con compress usa BC1 (o BC3 si tiene alfa).
+	bool convertToTextureContainer(const std::string& imagePath, const std::string& containerPath, bool compress);
+
+	// Convierte todas las .jpg/.jpeg/.png de una carpeta; devuelve cuántas se escribieron
+	int convertTextureFolder(const std::string& directory, bool compress);
+
+}
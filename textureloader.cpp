@@ -0,0 +1,410 @@
+#include "textureloader.hpp"
+#include "texture.hpp"
+#include "texturecontainer.hpp"
+#include "texturestorage.hpp"
+#include "jpegdecoder.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace myopengl {
+
+	AsyncTextureLoader::AsyncTextureLoader(ThreadPool& pool, int maxInFlight)
+		: m_Pool(pool), m_MaxInFlight(maxInFlight)
+	{
+	}
+
+	AsyncTextureLoader::~AsyncTextureLoader()
+	{
+		// Los workers escriben en memoria de los jobs; nunca dejarlos colgando
+		waitForWorkers();
+	}
+
+	bool AsyncTextureLoader::enableCompression(const std::string& cacheDirectory)
+	{
+		if (!GLEW_EXT_texture_compression_s3tc) {
+			std::cout << "Texture cache: EXT_texture_compression_s3tc not supported, compression disabled" << std::endl;
+			return false;
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory, error);
+		if (error) {
+			std::cout << "Texture cache: cannot create " << cacheDirectory << ": " << error.message() << std::endl;
+			return false;
+		}
+		m_CacheDirectory = cacheDirectory;
+		return true;
+	}
+
+	void AsyncTextureLoader::prepareUncompressed(Job& job)
+	{
+		job.mips = mipChainLayout(job.width, job.height, job.channels, job.payloadSize);
+		job.pool = &m_Pool;
+	}
+
+	void AsyncTextureLoader::prepareCompressed(Job& job, BlockFormat format)
+	{
+		job.compressed = true;
+		job.format = format;
+		job.channels = 4;
+		job.levels = compressedMipChain(job.width, job.height, format, job.payloadSize);
+		job.cacheDirectory = m_CacheDirectory;
+		job.pool = &m_Pool;
+	}
+
+	GLuint AsyncTextureLoader::load(const std::string& path)
+	{
+		// Con un contenedor ya convertido no hay nada que decodificar: se sube al momento
+		GLuint container = loadTextureContainerFor(path);
+		if (container)
+			return container;
+
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		const unsigned char gray[4] = { 128, 128, 128, 255 };
+
+		// La cabecera basta para dimensionar el PBO y el storage antes de decodificar
+		int width, height, channels;
+		if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+			std::cout << "Failed to load texture at path: " << path << std::endl;
+			allocateTextureStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+			return textureID;
+		}
+
+		Source source;
+		source.path = path;
+		source.texture = textureID;
+		source.target = GL_TEXTURE_2D;
+		source.width = width;
+		source.height = height;
+		source.channels = channels == 2 ? 4 : channels;
+		source.compressed = compressionEnabled();
+		source.format = blockFormatForChannels(channels);
+
+		// El storage inmutable ya tiene el tamaño final. Hasta que llegue la imagen el
+		// nivel base es el último (1x1), en gris; la textura ya es completa con él.
+		int levels = mipLevelCount(width, height);
+		int last = levels - 1;
+		if (source.compressed) {
+			unsigned char block[16];
+			size_t blockSize = compressedLevelSize(1, 1, source.format);
+			fillSolidBlocks(block, blockSize, source.format, 128, 128, 128, 255);
+			allocateTextureStorage2D(GL_TEXTURE_2D, levels, blockInternalFormat(source.format), width, height);
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, last, 0, 0, 1, 1, blockInternalFormat(source.format), (GLsizei)blockSize, block);
+		}
+		else {
+			allocateTextureStorage2D(GL_TEXTURE_2D, levels, internalFormatForChannels(source.channels), width, height);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, last, 0, 0, 1, 1, pixelFormatForChannels(source.channels), GL_UNSIGNED_BYTE, gray);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last);
+
+		m_Sources.push_back(source);
+		queue(source);
+		return textureID;
+	}
+
+	GLuint AsyncTextureLoader::loadArray(const std::vector<std::string>& paths, int maxLayerSize, int& layerWidth, int& layerHeight)
+	{
+		layerWidth = maxLayerSize;
+		layerHeight = maxLayerSize;
+		bool hasAlpha = false;
+		for (const std::string& path : paths) {
+			int width, height, channels;
+			if (stbi_info(path.c_str(), &width, &height, &channels)) {
+				layerWidth = std::min(layerWidth, floorPowerOfTwo(width));
+				layerHeight = std::min(layerHeight, floorPowerOfTwo(height));
+				hasAlpha = hasAlpha || blockFormatForChannels(channels) == BlockFormat::BC3;
+			}
+		}
+		GLsizei layers = (GLsizei)paths.size();
+		BlockFormat format = hasAlpha ? BlockFormat::BC3 : BlockFormat::BC1;
+
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+
+		// Todos los niveles se reservan aquí, con las capas en gris hasta que cada job
+		// suba su cadena completa
+		if (compressionEnabled()) {
+			size_t totalSize;
+			std::vector<CompressedLevel> levels = compressedMipChain(layerWidth, layerHeight, format, totalSize);
+			allocateTextureStorage3D(GL_TEXTURE_2D_ARRAY, (int)levels.size(), blockInternalFormat(format), layerWidth, layerHeight, layers);
+			std::vector<unsigned char> gray(levels[0].size * layers);
+			fillSolidBlocks(gray.data(), gray.size(), format, 128, 128, 128, 255);
+			for (size_t level = 0; level < levels.size(); level++) {
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, 0, levels[level].width, levels[level].height, layers,
+					blockInternalFormat(format), (GLsizei)(levels[level].size * layers), gray.data());
+			}
+		}
+		else {
+			size_t totalSize;
+			std::vector<MipLevelLayout> levels = mipChainLayout(layerWidth, layerHeight, 4, totalSize);
+			allocateTextureStorage3D(GL_TEXTURE_2D_ARRAY, (int)levels.size(), GL_RGBA8, layerWidth, layerHeight, layers);
+			std::vector<unsigned char> gray(levels[0].size * layers, 128);
+			for (size_t level = 0; level < levels.size(); level++) {
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, 0, levels[level].width, levels[level].height, layers,
+					GL_RGBA, GL_UNSIGNED_BYTE, gray.data());
+			}
+		}
+
+		for (size_t layer = 0; layer < paths.size(); layer++) {
+			Source source;
+			source.path = paths[layer];
+			source.texture = textureID;
+			source.target = GL_TEXTURE_2D_ARRAY;
+			source.layer = (int)layer;
+			source.width = layerWidth;
+			source.height = layerHeight;
+			source.channels = 4;
+			source.compressed = compressionEnabled();
+			source.format = format;
+			m_Sources.push_back(source);
+			queue(source);
+		}
+		return textureID;
+	}
+
+	void AsyncTextureLoader::queue(const Source& source)
+	{
+		std::shared_ptr<Job> job = std::make_shared<Job>();
+		job->path = source.path;
+		job->texture = source.texture;
+		job->target = source.target;
+		job->layer = source.layer;
+		job->width = source.width;
+		job->height = source.height;
+		job->channels = source.channels;
+		if (source.compressed)
+			prepareCompressed(*job, source.format);
+		else
+			prepareUncompressed(*job);
+		m_Queued.push_back(job);
+	}
+
+	int AsyncTextureLoader::reload(const std::string& path)
+	{
+		std::filesystem::path changed = std::filesystem::path(path).lexically_normal();
+		int queued = 0;
+		for (const Source& source : m_Sources) {
+			if (std::filesystem::path(source.path).lexically_normal() != changed)
+				continue;
+			if (source.target == GL_TEXTURE_2D) {
+				int width, height, channels;
+				if (!stbi_info(path.c_str(), &width, &height, &channels))
+					continue;
+				if (width != source.width || height != source.height) {
+					std::cout << "Texture " << path << " changed size, restart to reload it" << std::endl;
+					continue;
+				}
+			}
+			// La clave de la caché comprimida es el hash del contenido: un fichero cambiado
+			// no la encuentra y se vuelve a comprimir
+			queue(source);
+			queued++;
+		}
+		return queued;
+	}
+
+	void AsyncTextureLoader::start(const std::shared_ptr<Job>& job)
+	{
+		GLsizeiptr size = (GLsizeiptr)job->payloadSize;
+		glGenBuffers(1, &job->pixelBuffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job->pixelBuffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		job->mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		if (!job->mapped) {
+			job->state = Failed;
+			return;
+		}
+
+		m_Pool.submit([job] {
+			decode(*job);
+		});
+	}
+
+	void AsyncTextureLoader::decode(Job& job)
+	{
+		// Caché de cadenas comprimidas: se lee directamente al PBO
+		std::string cachePath;
+		if (job.compressed) {
+			bool hashed;
+			uint64_t sourceHash = hashFileContents(job.path, hashed);
+			if (hashed) {
+				cachePath = compressedCachePath(job.cacheDirectory, sourceHash, job.width, job.height, job.format);
+				if (readCompressedCache(cachePath, job.width, job.height, job.format, job.mapped, job.payloadSize)) {
+					job.cacheHit = true;
+					job.state = Ready;
+					return;
+				}
+			}
+		}
+
+		int width, height, channels;
+		unsigned char* data = loadImage(job.path.c_str(), &width, &height, &channels, job.channels);
+		if (!data) {
+			job.state = Failed;
+			return;
+		}
+
+		std::vector<unsigned char> resampled;
+		const unsigned char* pixels = data;
+		if (width != job.width || height != job.height) {
+			resampled.resize((size_t)job.width * job.height * job.channels);
+			resampleImage(data, width, height, resampled.data(), job.width, job.height, job.channels);
+			pixels = resampled.data();
+		}
+
+		if (!job.compressed) {
+			// Los mips se escriben directamente en la memoria del PBO; generateMipChain()
+			// nunca lee de dst
+			generateMipChain(pixels, job.width, job.height, job.channels, job.mapped, MipFilter::Kaiser, job.pool);
+			freeImage(data);
+			job.state = Ready;
+			return;
+		}
+
+		// Se comprime en memoria normal: leer de vuelta del PBO mapeado es muy lento
+		std::vector<unsigned char> blocks(job.payloadSize);
+		compressMipChain(pixels, job.width, job.height, job.format, blocks.data(), job.pool);
+		freeImage(data);
+		if (!cachePath.empty())
+			writeCompressedCache(cachePath, job.width, job.height, job.format, blocks.data(), blocks.size());
+		std::memcpy(job.mapped, blocks.data(), blocks.size());
+		job.state = Ready;
+	}
+
+	void AsyncTextureLoader::upload(Job& job)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.pixelBuffer);
+		bool intact = job.mapped && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+		job.mapped = nullptr;
+
+		if (job.state == Failed || !intact) {
+			std::cout << "Failed to load texture at path: " << job.path << std::endl;
+		}
+		else if (job.compressed) {
+			if (job.cacheHit)
+				m_CacheStats.hits++;
+			else
+				m_CacheStats.misses++;
+			m_CacheStats.compressedBytes += job.payloadSize;
+
+			GLenum format = blockInternalFormat(job.format);
+			glBindTexture(job.target, job.texture);
+			for (size_t level = 0; level < job.levels.size(); level++) {
+				const CompressedLevel& l = job.levels[level];
+				if (job.target == GL_TEXTURE_2D) {
+					glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)level, 0, 0, l.width, l.height, format,
+						(GLsizei)l.size, (void*)l.offset);
+				}
+				else {
+					glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, job.layer, l.width, l.height, 1,
+						format, (GLsizei)l.size, (void*)l.offset);
+				}
+			}
+		}
+		else {
+			// Las filas de los niveles pequeños no están alineadas a 4
+			GLenum format = pixelFormatForChannels(job.channels);
+			glBindTexture(job.target, job.texture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (size_t level = 0; level < job.mips.size(); level++) {
+				const MipLevelLayout& l = job.mips[level];
+				if (job.target == GL_TEXTURE_2D) {
+					glTexSubImage2D(GL_TEXTURE_2D, (GLint)level, 0, 0, l.width, l.height, format, GL_UNSIGNED_BYTE,
+						(void*)l.offset);
+				}
+				else {
+					glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, job.layer, l.width, l.height, 1,
+						GL_RGBA, GL_UNSIGNED_BYTE, (void*)l.offset);
+				}
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		}
+		// La cadena real sustituye al placeholder de 1x1
+		if (job.state != Failed && intact && job.target == GL_TEXTURE_2D)
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+
+		// Sin desenlazar, cualquier glTexImage posterior leería de este buffer
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &job.pixelBuffer);
+		job.pixelBuffer = 0;
+	}
+
+	void AsyncTextureLoader::update(double budgetMilliseconds)
+	{
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point begin = Clock::now();
+
+		auto startQueued = [this] {
+			while (!m_Queued.empty() && (int)m_InFlight.size() < m_MaxInFlight) {
+				start(m_Queued.front());
+				m_InFlight.push_back(m_Queued.front());
+				m_Queued.erase(m_Queued.begin());
+			}
+		};
+		startQueued();
+
+		bool uploaded = false;
+		for (size_t i = 0; i < m_InFlight.size();) {
+			if (m_InFlight[i]->state == Decoding) {
+				i++;
+				continue;
+			}
+			if (uploaded && std::chrono::duration<double, std::milli>(Clock::now() - begin).count() >= budgetMilliseconds)
+				break;
+
+			upload(*m_InFlight[i]);
+			m_InFlight.erase(m_InFlight.begin() + i);
+			m_Completed++;
+			uploaded = true;
+		}
+
+		startQueued();
+	}
+
+	void AsyncTextureLoader::finish()
+	{
+		while (pending() > 0) {
+			update(1e9);
+			if (pending() > 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	void AsyncTextureLoader::waitForWorkers()
+	{
+		for (const std::shared_ptr<Job>& job : m_InFlight) {
+			while (job->mapped && job->state == Decoding)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	void AsyncTextureLoader::destroy()
+	{
+		waitForWorkers();
+		for (const std::shared_ptr<Job>& job : m_InFlight) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job->pixelBuffer);
+			if (job->mapped)
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glDeleteBuffers(1, &job->pixelBuffer);
+		}
+		m_InFlight.clear();
+		m_Queued.clear();
+		m_Sources.clear();
+	}
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "threadpool.hpp"
+#include "texturecompression.hpp"
+#include "mipmaps.hpp"
+#include <GL/glew.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	// Carga de texturas en segundo plano. load() devuelve enseguida una textura válida
+	// con un placeholder gris de 1x1; un worker decodifica el JPEG directamente en un
+	// pixel unpack buffer mapeado junto con su cadena de mips (generateMipChain, en
+	// espacio lineal) y update() termina la subida en el hilo de GL dentro de un
+	// presupuesto de tiempo por frame. El nombre de la textura no cambia al
+	// llegar la imagen real, así que quien la usa no tiene que enterarse.
+	// Con enableCompression() el worker entrega la cadena de mips ya en BC1/BC3,
+	// leída de la caché en disco o comprimida la primera vez.
+	class AsyncTextureLoader {
+	public:
+		// maxInFlight limita los PBO mapeados a la vez (cada uno ocupa la cadena completa)
+		explicit AsyncTextureLoader(ThreadPool& pool, int maxInFlight = 4);
+		~AsyncTextureLoader();
+		AsyncTextureLoader(const AsyncTextureLoader&) = delete;
+		AsyncTextureLoader& operator=(const AsyncTextureLoader&) = delete;
+
+		// Solo afecta a las texturas pedidas después. Falla si no hay EXT_texture_compression_s3tc.
+		bool enableCompression(const std::string& cacheDirectory);
+		bool compressionEnabled() const { return !m_CacheDirectory.empty(); }
+		const TextureCacheStats& cacheStats() const { return m_CacheStats; }
+
+		GLuint load(const std::string& path);
+		// Igual que loadTextureArray(): el tamaño de capa sale de las cabeceras, las capas
+		// empiezan en gris y cada imagen se reescala en el worker antes de subirla
+		GLuint loadArray(const std::vector<std::string>& paths, int maxLayerSize, int& layerWidth, int& layerHeight);
+
+		// Vuelve a decodificar en un worker las texturas y capas que salieron de path y las
+		// sube encima con glTexSubImage. Las capas de un array se reescalan siempre a su
+		// tamaño; una textura 2D cuyo fichero cambia de tamaño no cabe en su storage
+		// inmutable y se deja como está. Devuelve cuántas se han encolado.
+		int reload(const std::string& path);
+
+		// Lanza decodificaciones y sube las que estén listas hasta gastar budgetMilliseconds
+		// (al menos una por llamada, para avanzar siempre)
+		void update(double budgetMilliseconds);
+		// Bloquea hasta que todas las texturas pedidas estén subidas
+		void finish();
+		// Espera a los workers y libera los PBO; necesita el contexto de GL todavía vivo
+		void destroy();
+
+		size_t pending() const { return m_Queued.size() + m_InFlight.size(); }
+		int completed() const { return m_Completed; }
+
+	private:
+		enum JobState { Decoding, Ready, Failed };
+
+		struct Job {
+			std::string path;
+			GLuint texture = 0;
+			GLenum target = GL_TEXTURE_2D;
+			int layer = 0;
+			int width = 0, height = 0, channels = 0; // formato de destino en el PBO
+			// El PBO contiene todos los niveles seguidos, en bloques BCn o sin comprimir
+			bool compressed = false;
+			BlockFormat format = BlockFormat::BC1;
+			std::vector<CompressedLevel> levels;
+			std::vector<MipLevelLayout> mips;
+			size_t payloadSize = 0;
+			ThreadPool* pool = nullptr;
+			std::string cacheDirectory;
+			bool cacheHit = false;
+			GLuint pixelBuffer = 0;
+			unsigned char* mapped = nullptr;
+			std::atomic<int> state{ Decoding };
+		};
+
+		// Lo necesario para repetir una carga; el resto del Job se rehace al encolarlo
+		struct Source {
+			std::string path;
+			GLuint texture = 0;
+			GLenum target = GL_TEXTURE_2D;
+			int layer = 0;
+			int width = 0, height = 0, channels = 0;
+			bool compressed = false;
+			BlockFormat format = BlockFormat::BC1;
+		};
+
+		void queue(const Source& source);
+		void prepareUncompressed(Job& job);
+		void prepareCompressed(Job& job, BlockFormat format);
+		void start(const std::shared_ptr<Job>& job);
+		static void decode(Job& job);
+		void upload(Job& job);
+		void waitForWorkers();
+
+		ThreadPool& m_Pool;
+		int m_MaxInFlight;
+		std::vector<std::shared_ptr<Job>> m_Queued;
+		std::vector<std::shared_ptr<Job>> m_InFlight;
+		std::vector<Source> m_Sources;
+		int m_Completed = 0;
+		std::string m_CacheDirectory;
+		TextureCacheStats m_CacheStats;
+	};
+
+}
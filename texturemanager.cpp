@@ -0,0 +1,292 @@
+#include "texturemanager.hpp"
+#include "texturecompression.hpp"
+#include <algorithm>
+#include <filesystem>
+
+namespace myopengl {
+
+	namespace {
+
+		// Clave de una ruta: "textures/./wood.jpg" y "textures/wood.jpg" son la misma
+		std::string pathKey(const std::string& path)
+		{
+			std::error_code error;
+			std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+			return error ? std::filesystem::path(path).lexically_normal().generic_string() : canonical.generic_string();
+		}
+
+	}
+
+	TextureManager::TextureManager(CreateFunction create, DestroyFunction destroy)
+		: m_Create(create), m_Destroy(destroy)
+	{
+	}
+
+	TextureHandle TextureManager::acquire(const std::string& path)
+	{
+		std::string key = pathKey(path);
+		std::unordered_map<std::string, uint32_t>::const_iterator byPath = m_ByPath.find(key);
+		if (byPath != m_ByPath.end()) {
+			m_Stats.pathHits++;
+			Slot& slot = m_Slots[byPath->second];
+			slot.references++;
+			size_t p = std::find(slot.paths.begin(), slot.paths.end(), key) - slot.paths.begin();
+			slot.pathReferences[p]++;
+			return { byPath->second, slot.generation, pathId(key) };
+		}
+
+		// Ruta nueva: puede ser una copia de un fichero ya cargado
+		bool hashed = false;
+		uint64_t contentHash = hashFileContents(path, hashed);
+		std::error_code error;
+		uint64_t fileSize = hashed ? (uint64_t)std::filesystem::file_size(path, error) : 0;
+		if (hashed && !error) {
+			auto range = m_ByContent.equal_range(contentHash);
+			for (auto it = range.first; it != range.second; ++it) {
+				Slot& slot = m_Slots[it->second];
+				if (slot.fileSize != fileSize)
+					continue;
+				m_Stats.contentHits++;
+				slot.references++;
+				slot.paths.push_back(key);
+				slot.pathReferences.push_back(1);
+				m_ByPath[key] = it->second;
+				return { it->second, slot.generation, pathId(key) };
+			}
+		}
+
+		uint32_t index = allocateSlot();
+		Slot& slot = m_Slots[index];
+		slot.texture = m_Create(path);
+		slot.references = 1;
+		slot.hashed = hashed && !error;
+		slot.contentHash = contentHash;
+		slot.fileSize = fileSize;
+		slot.paths.assign(1, key);
+		slot.pathReferences.assign(1, 1);
+		m_ByPath[key] = index;
+		if (slot.hashed)
+			m_ByContent.emplace(contentHash, index);
+		return { index, slot.generation, pathId(key) };
+	}
+
+	uint32_t TextureManager::pathId(const std::string& key)
+	{
+		std::unordered_map<std::string, uint32_t>::const_iterator found = m_PathIds.find(key);
+		if (found != m_PathIds.end())
+			return found->second;
+		m_PathKeys.push_back(key);
+		uint32_t id = (uint32_t)m_PathKeys.size();
+		m_PathIds[key] = id;
+		return id;
+	}
+
+	size_t TextureManager::findPath(const Slot& slot, TextureHandle handle) const
+	{
+		if (handle.path == 0 || handle.path > m_PathKeys.size())
+			return slot.paths.size();
+		return std::find(slot.paths.begin(), slot.paths.end(), m_PathKeys[handle.path - 1]) - slot.paths.begin();
+	}
+
+	uint32_t TextureManager::allocateSlot()
+	{
+		if (!m_FreeSlots.empty()) {
+			uint32_t index = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+			return index;
+		}
+		m_Slots.push_back(Slot());
+		return (uint32_t)m_Slots.size() - 1;
+	}
+
+	TextureHandle TextureManager::retain(TextureHandle handle)
+	{
+		if (!resolve(handle))
+			return TextureHandle();
+		// Cada referencia cuenta en su ruta: fileChanged() mueve las de una ruta a otra textura
+		Slot& slot = m_Slots[handle.index];
+		size_t p = findPath(slot, handle);
+		if (p == slot.paths.size())
+			return TextureHandle();
+		slot.pathReferences[p]++;
+		slot.references++;
+		return handle;
+	}
+
+	void TextureManager::release(TextureHandle handle)
+	{
+		if (!resolve(handle))
+			return;
+		Slot& slot = m_Slots[handle.index];
+		size_t p = findPath(slot, handle);
+		if (p == slot.paths.size() || slot.pathReferences[p] == 0)
+			return;
+		slot.pathReferences[p]--;
+		if (--slot.references == 0)
+			destroySlot(handle.index);
+	}
+
+	TextureHandle TextureManager::fileChanged(const std::string& path)
+	{
+		std::string key = pathKey(path);
+		std::unordered_map<std::string, uint32_t>::const_iterator byPath = m_ByPath.find(key);
+		if (byPath == m_ByPath.end())
+			return TextureHandle();
+		uint32_t index = byPath->second;
+
+		// Solo esta ruta: se recarga en su sitio
+		if (m_Slots[index].paths.size() == 1) {
+			hashSlot(index, key);
+			return { index, m_Slots[index].generation, pathId(key) };
+		}
+
+		// Compartida por contenido: recargarla cambiaría también las rutas que no se han
+		// tocado. La textura se carga de la primera ruta (el streamer la lee de ahí), así
+		// que si cambió esa se queda con la textura y las demás pasan a una nueva; si cambió
+		// otra, es esa la que pasa a una nueva, creada ya desde el fichero cambiado.
+		bool changedSource = m_Slots[index].paths.front() == key;
+		std::vector<std::string> movedPaths;
+		std::vector<int> movedReferences;
+		Slot& shared = m_Slots[index];
+		for (size_t p = 0; p < shared.paths.size();) {
+			if ((shared.paths[p] == key) == changedSource) {
+				p++;
+				continue;
+			}
+			movedPaths.push_back(shared.paths[p]);
+			movedReferences.push_back(shared.pathReferences[p]);
+			m_ByPath.erase(shared.paths[p]);
+			shared.references -= shared.pathReferences[p];
+			shared.paths.erase(shared.paths.begin() + p);
+			shared.pathReferences.erase(shared.pathReferences.begin() + p);
+		}
+
+		TextureHandle reload;
+		if (shared.references == 0) {
+			destroySlot(index);
+		}
+		else if (changedSource) {
+			hashSlot(index, key);
+			reload = { index, m_Slots[index].generation, pathId(key) };
+		}
+
+		// Sin referencias en las rutas movidas no hace falta textura: el próximo acquire()
+		// las cargará de nuevo
+		int references = 0;
+		for (int count : movedReferences)
+			references += count;
+		if (references == 0)
+			return reload;
+
+		uint32_t detached = allocateSlot();
+		Slot& slot = m_Slots[detached];
+		slot.texture = m_Create(movedPaths.front());
+		slot.references = references;
+		slot.paths = movedPaths;
+		slot.pathReferences = movedReferences;
+		for (const std::string& moved : movedPaths)
+			m_ByPath[moved] = detached;
+		hashSlot(detached, movedPaths.front());
+		return reload;
+	}
+
+	TextureHandle TextureManager::current(TextureHandle handle) const
+	{
+		if (handle.path == 0 || handle.path > m_PathKeys.size())
+			return handle;
+		std::unordered_map<std::string, uint32_t>::const_iterator byPath = m_ByPath.find(m_PathKeys[handle.path - 1]);
+		if (byPath == m_ByPath.end())
+			return TextureHandle();
+		return { byPath->second, m_Slots[byPath->second].generation, handle.path };
+	}
+
+	void TextureManager::hashSlot(uint32_t index, const std::string& path)
+	{
+		// Con el hash antiguo, una copia del contenido anterior acabaría en esta textura
+		unindexContent(index);
+		Slot& slot = m_Slots[index];
+		bool hashed = false;
+		slot.contentHash = hashFileContents(path, hashed);
+		std::error_code error;
+		slot.fileSize = hashed ? (uint64_t)std::filesystem::file_size(path, error) : 0;
+		slot.hashed = hashed && !error;
+		if (slot.hashed)
+			m_ByContent.emplace(slot.contentHash, index);
+	}
+
+	GLuint TextureManager::texture(TextureHandle handle) const
+	{
+		const Slot* slot = resolve(handle);
+		return slot ? slot->texture : 0;
+	}
+
+	int TextureManager::references(TextureHandle handle) const
+	{
+		const Slot* slot = resolve(handle);
+		return slot ? slot->references : 0;
+	}
+
+	const TextureManager::Slot* TextureManager::resolve(TextureHandle handle) const
+	{
+		if (!handle.valid() || handle.index >= m_Slots.size())
+			return nullptr;
+		const Slot& slot = m_Slots[handle.index];
+		return slot.generation == handle.generation && slot.references > 0 ? &slot : nullptr;
+	}
+
+	void TextureManager::destroySlot(uint32_t index)
+	{
+		Slot& slot = m_Slots[index];
+		m_Destroy(slot.texture);
+		m_Stats.released++;
+
+		for (const std::string& path : slot.paths)
+			m_ByPath.erase(path);
+		unindexContent(index);
+
+		slot.texture = 0;
+		slot.references = 0;
+		slot.paths.clear();
+		slot.pathReferences.clear();
+		// La generación 0 es la del handle nulo
+		if (++slot.generation == 0)
+			slot.generation = 1;
+		m_FreeSlots.push_back(index);
+	}
+
+	void TextureManager::unindexContent(uint32_t index)
+	{
+		Slot& slot = m_Slots[index];
+		if (!slot.hashed)
+			return;
+		auto range = m_ByContent.equal_range(slot.contentHash);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second == index) {
+				m_ByContent.erase(it);
+				break;
+			}
+		}
+		slot.hashed = false;
+	}
+
+	void TextureManager::clear()
+	{
+		for (uint32_t index = 0; index < m_Slots.size(); index++) {
+			if (m_Slots[index].references > 0)
+				destroySlot(index);
+		}
+	}
+
+	TextureManagerStats TextureManager::stats() const
+	{
+		TextureManagerStats stats = m_Stats;
+		for (const Slot& slot : m_Slots) {
+			if (slot.references > 0) {
+				stats.textures++;
+				stats.references += slot.references;
+			}
+		}
+		return stats;
+	}
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace myopengl {
+
+	// Referencia a una textura del TextureManager: ranura y generación. Al liberar una
+	// ranura su generación avanza, así que un handle guardado de antes deja de resolver
+	// en vez de apuntar a la textura que la reutilice. También recuerda con qué ruta se
+	// adquirió, para llevar la cuenta de referencias de cada ruta; == compara solo la
+	// textura.
+	struct TextureHandle {
+		uint32_t index = 0;
+		uint32_t generation = 0;  // 0 = handle nulo
+		uint32_t path = 0;        // identificador de la ruta en el manager, 0 = ninguna
+
+		bool valid() const { return generation != 0; }
+		bool operator==(const TextureHandle& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const TextureHandle& other) const { return !(*this == other); }
+	};
+
+	struct TextureManagerStats {
+		int textures = 0;     // texturas de GL vivas
+		int references = 0;
+		int pathHits = 0;     // acquire() de una ruta ya cargada
+		int contentHits = 0;  // acquire() de otra ruta con el mismo contenido
+		int released = 0;     // texturas borradas al quedarse sin referencias
+	};
+
+	// Texturas compartidas con cuenta de referencias. Una ruta (normalizada) o un fichero
+	// con el mismo contenido (hash FNV-1a y tamaño) se cargan una sola vez; la textura se
+	// borra cuando se suelta la última referencia. Quién crea y borra las texturas de GL
+	// lo deciden las funciones del constructor (el streamer, el loader asíncrono...).
+	class TextureManager {
+	public:
+		typedef std::function<GLuint(const std::string& path)> CreateFunction;
+		typedef std::function<void(GLuint texture)> DestroyFunction;
+
+		TextureManager(CreateFunction create, DestroyFunction destroy);
+		TextureManager(const TextureManager&) = delete;
+		TextureManager& operator=(const TextureManager&) = delete;
+
+		// La textura de path con una referencia más
+		TextureHandle acquire(const std::string& path);
+		// Otra referencia a una textura ya adquirida, contada en la ruta del handle; devuelve
+		// el mismo handle (o uno nulo si había caducado)
+		TextureHandle retain(TextureHandle handle);
+		// Los handles nulos o caducados se ignoran
+		void release(TextureHandle handle);
+
+		// Para una ruta modificada en disco: recalcula el hash de contenido y devuelve la
+		// textura que hay que recargar desde ella (nulo si no está cargada o no hace falta).
+		// Una textura compartida por contenido con otras rutas no se recarga en su sitio:
+		// la ruta cambiada y las demás acaban en texturas distintas y los handles de las
+		// que se movieron se actualizan con current().
+		TextureHandle fileChanged(const std::string& path);
+		// El handle vigente de la ruta con la que se adquirió handle; cambia si
+		// fileChanged() la movió a otra textura (nulo si la ruta ya no está cargada)
+		TextureHandle current(TextureHandle handle) const;
+
+		// 0 si el handle es nulo o caducado
+		GLuint texture(TextureHandle handle) const;
+		bool alive(TextureHandle handle) const { return resolve(handle) != nullptr; }
+		int references(TextureHandle handle) const;
+
+		// Borra todas las texturas aunque tengan referencias; necesita el contexto de GL
+		void clear();
+
+		TextureManagerStats stats() const;
+
+	private:
+		struct Slot {
+			GLuint texture = 0;
+			uint32_t generation = 1;
+			int references = 0;
+			bool hashed = false;
+			uint64_t contentHash = 0;
+			uint64_t fileSize = 0;
+			std::vector<std::string> paths;  // todas las rutas que apuntan a esta textura; se carga de la primera
+			std::vector<int> pathReferences; // referencias tomadas con acquire() de cada ruta
+		};
+
+		const Slot* resolve(TextureHandle handle) const;
+		uint32_t pathId(const std::string& key);
+		// Posición de la ruta del handle en slot.paths; paths.size() si no está
+		size_t findPath(const Slot& slot, TextureHandle handle) const;
+		uint32_t allocateSlot();
+		void hashSlot(uint32_t index, const std::string& path);
+		void destroySlot(uint32_t index);
+		void unindexContent(uint32_t index);
+
+		CreateFunction m_Create;
+		DestroyFunction m_Destroy;
+		std::vector<Slot> m_Slots;
+		std::vector<uint32_t> m_FreeSlots;
+		std::unordered_map<std::string, uint32_t> m_ByPath;
+		std::unordered_map<std::string, uint32_t> m_PathIds;
+		std::vector<std::string> m_PathKeys;  // clave de la ruta con identificador i + 1
+		std::unordered_multimap<uint64_t, uint32_t> m_ByContent;
+		TextureManagerStats m_Stats;
+	};
+
+}
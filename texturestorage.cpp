@@ -0,0 +1,139 @@
+#include "texturestorage.hpp"
+#include <algorithm>
+
+namespace myopengl {
+
+	namespace {
+
+		bool isBlockFormat(GLenum internalFormat)
+		{
+			return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ||
+				internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		}
+
+		GLsizei blockLevelSize(GLenum internalFormat, int width, int height)
+		{
+			bool eightBytes = internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			return (GLsizei)(((width + 3) / 4) * ((height + 3) / 4) * (eightBytes ? 8 : 16));
+		}
+
+		GLenum pixelFormatForInternal(GLenum internalFormat)
+		{
+			switch (internalFormat) {
+			case GL_R8: return GL_RED;
+			case GL_RG8: return GL_RG;
+			case GL_RGB8: return GL_RGB;
+			default: return GL_RGBA;
+			}
+		}
+
+	}
+
+	GLenum internalFormatForChannels(int channels)
+	{
+		switch (channels) {
+		case 1: return GL_R8;
+		case 2: return GL_RG8;
+		case 3: return GL_RGB8;
+		default: return GL_RGBA8;
+		}
+	}
+
+	GLenum pixelFormatForChannels(int channels)
+	{
+		return pixelFormatForInternal(internalFormatForChannels(channels));
+	}
+
+	int mipLevelCount(int width, int height)
+	{
+		int levels = 1;
+		while (width > 1 || height > 1) {
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+			levels++;
+		}
+		return levels;
+	}
+
+	void allocateTextureStorage2D(GLenum target, int levels, GLenum internalFormat, int width, int height)
+	{
+		if (GLEW_ARB_texture_storage) {
+			glTexStorage2D(target, levels, internalFormat, width, height);
+			return;
+		}
+
+		for (int level = 0; level < levels; level++) {
+			if (isBlockFormat(internalFormat)) {
+				glCompressedTexImage2D(target, level, internalFormat, width, height, 0,
+					blockLevelSize(internalFormat, width, height), NULL);
+			}
+			else {
+				glTexImage2D(target, level, internalFormat, width, height, 0,
+					pixelFormatForInternal(internalFormat), GL_UNSIGNED_BYTE, NULL);
+			}
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	}
+
+	void allocateTextureStorage3D(GLenum target, int levels, GLenum internalFormat, int width, int height, int depth)
+	{
+		if (GLEW_ARB_texture_storage) {
+			glTexStorage3D(target, levels, internalFormat, width, height, depth);
+			return;
+		}
+
+		// Solo arrays: la profundidad no se reduce con los niveles
+		for (int level = 0; level < levels; level++) {
+			if (isBlockFormat(internalFormat)) {
+				glCompressedTexImage3D(target, level, internalFormat, width, height, depth, 0,
+					blockLevelSize(internalFormat, width, height) * depth, NULL);
+			}
+			else {
+				glTexImage3D(target, level, internalFormat, width, height, depth, 0,
+					pixelFormatForInternal(internalFormat), GL_UNSIGNED_BYTE, NULL);
+			}
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	}
+
+	float maxSupportedAnisotropy()
+	{
+		if (!GLEW_EXT_texture_filter_anisotropic)
+			return 1.0f;
+		GLfloat maximum = 1.0f;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maximum);
+		return maximum;
+	}
+
+	GLuint SamplerCache::get(const SamplerState& state)
+	{
+		for (const std::pair<SamplerState, GLuint>& sampler : m_Samplers) {
+			if (sampler.first == state)
+				return sampler.second;
+		}
+
+		GLuint sampler;
+		glGenSamplers(1, &sampler);
+		glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, state.minFilter);
+		glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, state.magFilter);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, state.wrap);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, state.wrap);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R, state.wrap);
+		if (state.maxAnisotropy > 1.0f && GLEW_EXT_texture_filter_anisotropic)
+			glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT, state.maxAnisotropy);
+		m_Samplers.push_back(std::make_pair(state, sampler));
+		return sampler;
+	}
+
+	void SamplerCache::clear()
+	{
+		for (const std::pair<SamplerState, GLuint>& sampler : m_Samplers)
+			glDeleteSamplers(1, &sampler.second);
+		m_Samplers.clear();
+	}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace myopengl {
+
+	// Formatos sin comprimir para 1..4 canales de 8 bits
+	GLenum internalFormatForChannels(int channels);  // GL_R8, GL_RG8, GL_RGB8, GL_RGBA8
+	GLenum pixelFormatForChannels(int channels);     // GL_RED, GL_RG, GL_RGB, GL_RGBA
+
+	// Niveles de la cadena completa hasta 1x1
+	int mipLevelCount(int width, int height);
+
+	// Reserva todos los niveles de una vez con glTexStorage (inmutable: el driver no
+	// vuelve a comprobar si la textura está completa). Los datos se suben después con
+	// glTexSubImage / glCompressedTexSubImage. Sin ARB_texture_storage se reservan nivel
+	// a nivel con glTexImage y GL_TEXTURE_MAX_LEVEL, con el mismo resultado visible.
+	void allocateTextureStorage2D(GLenum target, int levels, GLenum internalFormat, int width, int height);
+	void allocateTextureStorage3D(GLenum target, int levels, GLenum internalFormat, int width, int height, int depth);
+
+	// Estado de muestreo; las texturas no guardan filtro ni wrap propios
+	struct SamplerState {
+		GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+		GLenum magFilter = GL_LINEAR;
+		GLenum wrap = GL_REPEAT;
+		float maxAnisotropy = 1.0f;
+
+		bool operator==(const SamplerState& other) const {
+			return minFilter == other.minFilter && magFilter == other.magFilter &&
+				wrap == other.wrap && maxAnisotropy == other.maxAnisotropy;
+		}
+	};
+
+	// Mayor anisotropía disponible (1 sin EXT_texture_filter_anisotropic)
+	float maxSupportedAnisotropy();
+
+	// Sampler objects compartidos entre todas las texturas, uno por estado distinto.
+	// Cambiar el filtrado de toda la escena es enlazar otro sampler de la caché.
+	class SamplerCache {
+	public:
+		SamplerCache() = default;
+		SamplerCache(const SamplerCache&) = delete;
+		SamplerCache& operator=(const SamplerCache&) = delete;
+
+		GLuint get(const SamplerState& state);
+		size_t size() const { return m_Samplers.size(); }
+		// Necesita el contexto de GL todavía vivo
+		void clear();
+
+	private:
+		// Hay pocos estados distintos: búsqueda lineal
+		std::vector<std::pair<SamplerState, GLuint>> m_Samplers;
+	};
+
+}
@@ -0,0 +1,472 @@
+#include "texturestreamer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+namespace myopengl {
+
+	namespace {
+
+		// Lecturas de niveles en vuelo a la vez
+		const int MaxReads = 4;
+
+		// Contenedor en la caché para una imagen; el hash de la ruta evita choques
+		// entre ficheros con el mismo nombre en carpetas distintas
+		std::string cachedContainerPath(const std::string& directory, const std::string& imagePath, bool compress)
+		{
+			char suffix[32];
+			std::snprintf(suffix, sizeof(suffix), "_%016llx%s", (unsigned long long)std::hash<std::string>()(imagePath),
+				compress ? "_bc" : "");
+			std::filesystem::path name = std::filesystem::path(imagePath).stem();
+			name += suffix;
+			name += TextureContainerExtension;
+			return (std::filesystem::path(directory) / name).string();
+		}
+
+		bool isFresh(const std::string& containerPath, const std::string& imagePath)
+		{
+			std::error_code error;
+			if (!std::filesystem::exists(containerPath, error))
+				return false;
+			return std::filesystem::last_write_time(containerPath, error) >= std::filesystem::last_write_time(imagePath, error);
+		}
+
+	}
+
+	TextureStreamer::TextureStreamer(ThreadPool& pool, size_t budgetBytes, const std::string& cacheDirectory, bool compress)
+		: m_Pool(pool), m_Budget(budgetBytes), m_CacheDirectory(cacheDirectory),
+		m_Compress(compress && GLEW_EXT_texture_compression_s3tc)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory, error);
+		if (error)
+			std::cout << "Texture streamer: cannot create " << cacheDirectory << ": " << error.message() << std::endl;
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		// Los workers leen de las proyecciones de las entradas
+		waitForWorkers();
+	}
+
+	GLuint TextureStreamer::add(const std::string& path)
+	{
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+
+		// Storage mutable a propósito: con glTexStorage no se puede liberar un nivel
+		// suelto. Filtro y wrap los pone el sampler compartido, como en el resto.
+		const unsigned char gray[4] = { 128, 128, 128, 255 };
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+
+		std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+		entry->path = path;
+		entry->texture = textureID;
+		m_Index[textureID] = m_Entries.size();
+		m_Entries.push_back(entry);
+
+		// Un .mtex ya convertido junto a la imagen se usa tal cual
+		std::string besideImage = textureContainerPath(path);
+		if (isFresh(besideImage, path)) {
+			entry->containerPath = besideImage;
+			entry->state = Converted;
+			return textureID;
+		}
+
+		entry->containerPath = cachedContainerPath(m_CacheDirectory, path, m_Compress);
+		if (isFresh(entry->containerPath, path)) {
+			entry->state = Converted;
+			return textureID;
+		}
+
+		bool compress = m_Compress;
+		m_Pool.submit([entry, compress] {
+			bool converted = convertToTextureContainer(entry->path, entry->containerPath, compress);
+			entry->state = converted ? Converted : Failed;
+		});
+		return textureID;
+	}
+
+	void TextureStreamer::remove(GLuint texture)
+	{
+		std::unordered_map<GLuint, size_t>::iterator found = m_Index.find(texture);
+		if (found == m_Index.end())
+			return;
+		size_t index = found->second;
+		std::shared_ptr<Entry> entry = m_Entries[index];
+		m_Index.erase(found);
+		if (index + 1 < m_Entries.size()) {
+			m_Entries[index] = m_Entries.back();
+			m_Index[m_Entries[index]->texture] = index;
+		}
+		m_Entries.pop_back();
+
+		if (entry->header) {
+			for (int level = entry->residentLevel; level < (int)entry->header->levels; level++)
+				m_ResidentBytes -= levelSize(*entry, level);
+		}
+		entry->texture = 0;
+		if (entry->state == Converting || entry->state == Reading) {
+			m_Retired.push_back(entry);
+			return;
+		}
+		entry->file.close();
+		entry->header = nullptr;
+		entry->levels = nullptr;
+	}
+
+	void TextureStreamer::reload(GLuint texture)
+	{
+		std::unordered_map<GLuint, size_t>::const_iterator found = m_Index.find(texture);
+		if (found != m_Index.end())
+			m_Entries[found->second]->reloadRequested = true;
+	}
+
+	void TextureStreamer::startReload(const std::shared_ptr<Entry>& entry)
+	{
+		// El contenedor nuevo va a otro fichero: el actual sigue proyectado hasta replace()
+		entry->reloadRequested = false;
+		entry->reloadPath = cachedContainerPath(m_CacheDirectory, entry->path, m_Compress) + ".reload";
+		entry->state = Converting;
+
+		bool compress = m_Compress;
+		m_Pool.submit([entry, compress] {
+			if (convertToTextureContainer(entry->path, entry->reloadPath, compress)) {
+				entry->state = Converted;
+				return;
+			}
+			// Se queda con la imagen anterior, si la había
+			entry->reloadPath.clear();
+			entry->state = entry->header ? Idle : Failed;
+		});
+	}
+
+	void TextureStreamer::replace(Entry& entry)
+	{
+		// Sin cabecera (la conversión anterior falló) no hay niveles viejos que tocar
+		TextureContainerHeader previous = {};
+		if (entry.header)
+			previous = *entry.header;
+		int residentLevel = entry.header ? entry.residentLevel : 0;
+		for (int level = residentLevel; level < (int)previous.levels; level++)
+			m_ResidentBytes -= levelSize(entry, level);
+		entry.file.close();
+		entry.header = nullptr;
+		entry.levels = nullptr;
+
+		// El contenedor convertido pasa a la caché; con el anterior cerrado ya se puede
+		// sustituir (en Windows no se puede mientras está proyectado)
+		std::string cachedPath = cachedContainerPath(m_CacheDirectory, entry.path, m_Compress);
+		std::error_code error;
+		std::filesystem::remove(cachedPath, error);
+		std::filesystem::rename(entry.reloadPath, cachedPath, error);
+		entry.containerPath = error ? entry.reloadPath : cachedPath;
+		entry.reloadPath.clear();
+		m_Reloaded++;
+
+		bool opened = openTextureContainer(entry.containerPath, entry.file, entry.header, entry.levels);
+		if (opened && previous.levels > 0 && entry.header->width == previous.width && entry.header->height == previous.height &&
+			entry.header->levels == previous.levels && entry.header->internalFormat == previous.internalFormat) {
+			// Mismo storage: solo se reescriben los niveles que ya estaban residentes
+			glBindTexture(GL_TEXTURE_2D, entry.texture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (int level = residentLevel; level < (int)previous.levels; level++) {
+				const TextureContainerLevel& l = entry.levels[level];
+				const unsigned char* pixels = entry.file.data() + l.offset;
+				if (previous.compressed)
+					glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, l.width, l.height, previous.internalFormat, (GLsizei)l.size, pixels);
+				else
+					glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, l.width, l.height, previous.format, GL_UNSIGNED_BYTE, pixels);
+				m_ResidentBytes += levelSize(entry, level);
+				m_UploadedLevels++;
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			entry.state = Idle;
+			return;
+		}
+
+		// Otro tamaño o formato: se liberan los niveles viejos y se empieza como al añadirla
+		entry.file.close();
+		entry.header = nullptr;
+		entry.levels = nullptr;
+		glBindTexture(GL_TEXTURE_2D, entry.texture);
+		for (int level = residentLevel; level < (int)previous.levels; level++) {
+			if (previous.compressed)
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, previous.internalFormat, 0, 0, 0, 0, NULL);
+			else
+				glTexImage2D(GL_TEXTURE_2D, level, previous.internalFormat, 0, 0, 0, previous.format, GL_UNSIGNED_BYTE, NULL);
+		}
+		open(entry);
+	}
+
+	void TextureStreamer::open(Entry& entry)
+	{
+		if (!openTextureContainer(entry.containerPath, entry.file, entry.header, entry.levels) ||
+			(entry.header->compressed && !GLEW_EXT_texture_compression_s3tc)) {
+			std::cout << "Failed to load texture at path: " << entry.path << std::endl;
+			entry.file.close();
+			entry.header = nullptr;
+			entry.levels = nullptr;
+			entry.state = Failed;
+			return;
+		}
+
+		// Los mips pequeños entran sin mirar el presupuesto: son los que se ven mientras
+		// llegan los demás y no se descartan nunca
+		int lastLevel = (int)entry.header->levels - 1;
+		entry.minimumLevel = lastLevel;
+		while (entry.minimumLevel > 0 &&
+			(int)std::max(entry.levels[entry.minimumLevel - 1].width, entry.levels[entry.minimumLevel - 1].height) <= MinResidentSize)
+			entry.minimumLevel--;
+
+		glBindTexture(GL_TEXTURE_2D, entry.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+		entry.residentLevel = lastLevel + 1;
+		for (int level = lastLevel; level >= entry.minimumLevel; level--)
+			uploadLevel(entry, level);
+
+		// El placeholder de 1x1 queda por debajo del nivel base: se libera
+		if (entry.minimumLevel > 0) {
+			glBindTexture(GL_TEXTURE_2D, entry.texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+		entry.wantedLevel = entry.minimumLevel;
+		entry.state = Idle;
+	}
+
+	void TextureStreamer::uploadLevel(Entry& entry, int level)
+	{
+		const TextureContainerHeader& header = *entry.header;
+		const TextureContainerLevel& l = entry.levels[level];
+		const unsigned char* pixels = entry.file.data() + l.offset;
+
+		glBindTexture(GL_TEXTURE_2D, entry.texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (header.compressed) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, header.internalFormat, l.width, l.height, 0,
+				(GLsizei)l.size, pixels);
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, level, header.internalFormat, l.width, l.height, 0,
+				header.format, GL_UNSIGNED_BYTE, pixels);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		// Solo después de subirlo: hasta entonces la textura sigue completa con el nivel anterior
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+		entry.residentLevel = level;
+		m_ResidentBytes += levelSize(entry, level);
+		m_UploadedLevels++;
+	}
+
+	void TextureStreamer::dropLevel(Entry& entry)
+	{
+		int level = entry.residentLevel;
+		const TextureContainerHeader& header = *entry.header;
+		glBindTexture(GL_TEXTURE_2D, entry.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+		// Un nivel de 0x0 devuelve su memoria al driver
+		if (header.compressed)
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, header.internalFormat, 0, 0, 0, 0, NULL);
+		else
+			glTexImage2D(GL_TEXTURE_2D, level, header.internalFormat, 0, 0, 0, header.format, GL_UNSIGNED_BYTE, NULL);
+
+		entry.residentLevel = level + 1;
+		m_ResidentBytes -= levelSize(entry, level);
+		m_EvictedLevels++;
+	}
+
+	bool TextureStreamer::makeRoom(size_t bytes, const Entry* keep)
+	{
+		while (m_ResidentBytes + bytes > m_Budget) {
+			// Primero las texturas con más resolución de la que piden; si no hay, la usada
+			// hace más tiempo. Nunca una usada tan recientemente como la que necesita sitio.
+			Entry* victim = nullptr;
+			bool victimSurplus = false;
+			for (const std::shared_ptr<Entry>& candidate : m_Entries) {
+				Entry& entry = *candidate;
+				if (&entry == keep || !entry.header || entry.residentLevel >= entry.minimumLevel)
+					continue;
+				bool surplus = entry.residentLevel < entry.wantedLevel;
+				if (!surplus && keep && entry.lastUsed >= keep->lastUsed)
+					continue;
+				if (!victim || (surplus && !victimSurplus) ||
+					(surplus == victimSurplus && entry.lastUsed < victim->lastUsed)) {
+					victim = &entry;
+					victimSurplus = surplus;
+				}
+			}
+			if (!victim)
+				return false;
+			dropLevel(*victim);
+		}
+		return true;
+	}
+
+	void TextureStreamer::request(GLuint texture, float screenPixels)
+	{
+		std::unordered_map<GLuint, size_t>::const_iterator found = m_Index.find(texture);
+		if (found == m_Index.end())
+			return;
+		Entry& entry = *m_Entries[found->second];
+		entry.lastUsed = m_Frame;
+		if (!entry.header)
+			return;
+
+		// El mip más pequeño que todavía cubre screenPixels texels de lado
+		int level = entry.minimumLevel;
+		while (level > 0 && (float)std::max(entry.levels[level].width, entry.levels[level].height) < screenPixels)
+			level--;
+		entry.wantedLevel = std::min(entry.wantedLevel, level);
+	}
+
+	void TextureStreamer::setBudget(size_t budgetBytes)
+	{
+		m_Budget = budgetBytes;
+	}
+
+	void TextureStreamer::update(double budgetMilliseconds)
+	{
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point begin = Clock::now();
+
+		for (size_t i = 0; i < m_Retired.size();) {
+			Entry& entry = *m_Retired[i];
+			if (entry.state == Converting || entry.state == Reading) {
+				i++;
+				continue;
+			}
+			entry.file.close();
+			m_Retired[i] = m_Retired.back();
+			m_Retired.pop_back();
+		}
+
+		for (const std::shared_ptr<Entry>& entry : m_Entries) {
+			if (entry->state == Converted && !entry->reloadPath.empty())
+				replace(*entry);
+			else if (entry->state == Converted)
+				open(*entry);
+		}
+
+		// Si el presupuesto ha bajado se descarta hasta volver a caber
+		makeRoom(0, nullptr);
+
+		// Niveles ya leídos, los pequeños primero
+		std::vector<Entry*> ready;
+		for (const std::shared_ptr<Entry>& entry : m_Entries) {
+			if (entry->state == Ready)
+				ready.push_back(entry.get());
+		}
+		std::sort(ready.begin(), ready.end(), [this](const Entry* a, const Entry* b) {
+			return levelSize(*a, a->readLevel) < levelSize(*b, b->readLevel);
+		});
+		bool uploaded = false;
+		for (Entry* entry : ready) {
+			if (uploaded && std::chrono::duration<double, std::milli>(Clock::now() - begin).count() >= budgetMilliseconds)
+				break;
+			// Si mientras tanto se descartó un nivel, el leído ya no es el siguiente
+			if (entry->readLevel == entry->residentLevel - 1 && entry->wantedLevel <= entry->readLevel &&
+				makeRoom(levelSize(*entry, entry->readLevel), entry)) {
+				uploadLevel(*entry, entry->readLevel);
+				uploaded = true;
+			}
+			entry->state = Idle;
+		}
+
+		// Las recargas esperan a que la entrada no tenga un worker trabajando con ella
+		for (const std::shared_ptr<Entry>& entry : m_Entries) {
+			if (entry->reloadRequested && (entry->state == Idle || entry->state == Failed))
+				startReload(entry);
+		}
+
+		// Siguientes lecturas: un nivel por textura, también los pequeños primero
+		int reading = 0;
+		std::vector<std::shared_ptr<Entry>> wanting;
+		for (const std::shared_ptr<Entry>& entry : m_Entries) {
+			if (entry->state == Reading || entry->state == Ready)
+				reading++;
+			else if (entry->state == Idle && entry->wantedLevel < entry->residentLevel &&
+				levelSize(*entry, entry->residentLevel - 1) <= m_Budget)
+				wanting.push_back(entry);
+		}
+		std::sort(wanting.begin(), wanting.end(), [this](const std::shared_ptr<Entry>& a, const std::shared_ptr<Entry>& b) {
+			return levelSize(*a, a->residentLevel - 1) < levelSize(*b, b->residentLevel - 1);
+		});
+		for (const std::shared_ptr<Entry>& entry : wanting) {
+			if (reading >= MaxReads)
+				break;
+			entry->readLevel = entry->residentLevel - 1;
+			entry->state = Reading;
+			reading++;
+
+			// El worker solo toca las páginas del nivel para que los fallos de página de la
+			// proyección no caigan en el hilo de GL al subirlo
+			std::shared_ptr<Entry> job = entry;
+			m_Pool.submit([job] {
+				const TextureContainerLevel& level = job->levels[job->readLevel];
+				const unsigned char* data = job->file.data() + level.offset;
+				volatile unsigned char sink = 0;
+				for (uint64_t offset = 0; offset < level.size; offset += 4096)
+					sink = sink + data[offset];
+				job->state = Ready;
+			});
+		}
+
+		// Las peticiones del frame que empieza sustituyen a las anteriores
+		for (const std::shared_ptr<Entry>& entry : m_Entries) {
+			if (entry->header)
+				entry->wantedLevel = entry->minimumLevel;
+		}
+		m_Frame++;
+	}
+
+	void TextureStreamer::waitForWorkers()
+	{
+		for (const std::vector<std::shared_ptr<Entry>>* entries : { &m_Entries, &m_Retired }) {
+			for (const std::shared_ptr<Entry>& entry : *entries) {
+				while (entry->state == Converting || entry->state == Reading)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+	}
+
+	void TextureStreamer::destroy()
+	{
+		waitForWorkers();
+		for (const std::shared_ptr<Entry>& entry : m_Entries) {
+			entry->file.close();
+			entry->header = nullptr;
+			entry->levels = nullptr;
+		}
+		for (const std::shared_ptr<Entry>& entry : m_Retired)
+			entry->file.close();
+		m_Entries.clear();
+		m_Index.clear();
+		m_Retired.clear();
+		m_ResidentBytes = 0;
+	}
+
+	TextureStreamingStats TextureStreamer::stats() const
+	{
+		TextureStreamingStats stats;
+		stats.residentBytes = m_ResidentBytes;
+		stats.budgetBytes = m_Budget;
+		stats.textures = (int)m_Entries.size();
+		stats.uploadedLevels = m_UploadedLevels;
+		stats.evictedLevels = m_EvictedLevels;
+		stats.reloaded = m_Reloaded;
+		for (const std::shared_ptr<Entry>& entry : m_Entries) {
+			if (entry->state == Converting || entry->state == Converted)
+				stats.pendingConversions++;
+			else if (entry->header && entry->wantedLevel < entry->residentLevel)
+				stats.pendingRequests++;
+		}
+		return stats;
+	}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "threadpool.hpp"
+#include "texturecontainer.hpp"
+#include <GL/glew.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace myopengl {
+
+	struct TextureStreamingStats {
+		size_t residentBytes = 0;
+		size_t budgetBytes = 0;
+		int textures = 0;
+		int pendingRequests = 0;    // texturas que piden un mip más grande que el residente
+		int pendingConversions = 0; // imágenes que aún se están pasando a .mtex
+		int reloaded = 0;           // recargas aplicadas, acumuladas desde el principio
+		int uploadedLevels = 0;     // acumulados desde el principio
+		int evictedLevels = 0;
+	};
+
+	// Residencia de texturas por niveles de mip contra un presupuesto de VRAM. Cada
+	// imagen se pasa una vez a un contenedor .mtex (en un worker) y se sirve desde su
+	// proyección en memoria: al principio solo están los mips pequeños y los grandes
+	// llegan de uno en uno según el tamaño en pantalla que pide request(). Cuando un
+	// nivel no cabe se descarta el mip más grande de la textura usada hace más tiempo.
+	// El nombre de cada textura no cambia; lo residente se controla con
+	// GL_TEXTURE_BASE_LEVEL.
+	class TextureStreamer {
+	public:
+		// Los mips de hasta MinResidentSize texels de lado están siempre residentes
+		static const int MinResidentSize = 64;
+
+		// compress usa BC1/BC3 en los contenedores si hay EXT_texture_compression_s3tc
+		TextureStreamer(ThreadPool& pool, size_t budgetBytes, const std::string& cacheDirectory, bool compress);
+		~TextureStreamer();
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// Devuelve enseguida una textura con un placeholder gris de 1x1
+		GLuint add(const std::string& path);
+
+		// Deja de gestionar texture y descuenta lo que tenga residente; la textura de GL es
+		// de quien la pidió y se puede borrar en cuanto vuelve
+		void remove(GLuint texture);
+
+		// Vuelve a convertir la imagen de texture en un worker (si hay una conversión o una
+		// lectura en curso, al terminar). Mientras tanto se sigue viendo la anterior; si el
+		// tamaño y el formato no cambian los niveles residentes se reescriben en su sitio.
+		void reload(GLuint texture);
+
+		// Pide que texture tenga resolución para screenPixels píxeles de lado este frame
+		void request(GLuint texture, float screenPixels);
+
+		void setBudget(size_t budgetBytes);
+		size_t budget() const { return m_Budget; }
+
+		// Sube los niveles ya leídos y lanza las siguientes lecturas, hasta gastar
+		// budgetMilliseconds (al menos un nivel por llamada). Se llama una vez por frame,
+		// antes de los request() del frame.
+		void update(double budgetMilliseconds);
+		// Espera a los workers y cierra las proyecciones; las texturas son de quien las pidió
+		void destroy();
+
+		TextureStreamingStats stats() const;
+
+	private:
+		enum EntryState { Converting, Converted, Idle, Reading, Ready, Failed };
+
+		struct Entry {
+			std::string path;
+			std::string containerPath;
+			GLuint texture = 0;
+			MappedFile file;
+			const TextureContainerHeader* header = nullptr;
+			const TextureContainerLevel* levels = nullptr;
+			int residentLevel = 0;  // mip residente más grande (GL_TEXTURE_BASE_LEVEL)
+			int minimumLevel = 0;   // el que nunca se descarta
+			int wantedLevel = 0;
+			int readLevel = 0;      // el que está leyendo el worker
+			uint64_t lastUsed = 0;
+			bool reloadRequested = false;
+			std::string reloadPath;  // contenedor nuevo mientras se reconvierte
+			std::atomic<int> state{ Converting };
+		};
+
+		void open(Entry& entry);
+		void startReload(const std::shared_ptr<Entry>& entry);
+		void replace(Entry& entry);
+		void uploadLevel(Entry& entry, int level);
+		void dropLevel(Entry& entry);
+		bool makeRoom(size_t bytes, const Entry* keep);
+		size_t levelSize(const Entry& entry, int level) const { return (size_t)entry.levels[level].size; }
+		void waitForWorkers();
+
+		ThreadPool& m_Pool;
+		size_t m_Budget;
+		std::string m_CacheDirectory;
+		bool m_Compress;
+		std::vector<std::shared_ptr<Entry>> m_Entries;
+		std::unordered_map<GLuint, size_t> m_Index;
+		// Entradas quitadas con un worker todavía convirtiendo o leyendo de su proyección
+		std::vector<std::shared_ptr<Entry>> m_Retired;
+		uint64_t m_Frame = 1;
+		size_t m_ResidentBytes = 0;
+		int m_UploadedLevels = 0;
+		int m_EvictedLevels = 0;
+		int m_Reloaded = 0;
+	};
+
+}
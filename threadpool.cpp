@@ -0,0 +1,108 @@
+#include "threadpool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace myopengl {
+
+	ThreadPool::ThreadPool(unsigned threads)
+	{
+		if (threads == 0) {
+			unsigned hardware = std::thread::hardware_concurrency();
+			threads = hardware > 1 ? hardware - 1 : 1;
+		}
+		for (unsigned i = 0; i < threads; i++)
+			m_Workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stopping = true;
+		}
+		m_Condition.notify_all();
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	void ThreadPool::submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Tasks.push_back(std::move(task));
+		}
+		m_Condition.notify_one();
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+				if (m_Stopping && m_Tasks.empty())
+					return;
+				task = std::move(m_Tasks.front());
+				m_Tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	void ThreadPool::parallelFor(size_t count, size_t minBatch, const std::function<void(size_t, size_t)>& body)
+	{
+		size_t maxChunks = (size_t)size() + 1;
+		size_t chunks = std::min(maxChunks, count / std::max<size_t>(minBatch, 1));
+		if (chunks <= 1) {
+			if (count > 0)
+				body(0, count);
+			return;
+		}
+
+		// Estado compartido: algún worker puede seguir vivo un instante después de que
+		// el llamante vea todos los bloques terminados
+		struct Job {
+			std::function<void(size_t, size_t)> body;
+			size_t count, chunkSize, chunks;
+			std::atomic<size_t> next{ 0 };
+			std::atomic<size_t> done{ 0 };
+			std::mutex mutex;
+			std::condition_variable finished;
+
+			void run()
+			{
+				size_t chunk;
+				while ((chunk = next.fetch_add(1)) < chunks) {
+					size_t begin = chunk * chunkSize;
+					body(begin, std::min(begin + chunkSize, count));
+					if (done.fetch_add(1) + 1 == chunks) {
+						std::lock_guard<std::mutex> lock(mutex);
+						finished.notify_all();
+					}
+				}
+			}
+		};
+
+		std::shared_ptr<Job> job = std::make_shared<Job>();
+		job->body = body;
+		job->count = count;
+		job->chunkSize = (count + chunks - 1) / chunks;
+		job->chunks = (count + job->chunkSize - 1) / job->chunkSize;
+
+		for (size_t i = 0; i + 1 < job->chunks; i++)
+			submit([job] { job->run(); });
+		job->run();
+
+		std::unique_lock<std::mutex> lock(job->mutex);
+		job->finished.wait(lock, [&] { return job->done.load() == job->chunks; });
+	}
+
+	ThreadPool& ThreadPool::shared()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+}
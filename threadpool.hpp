@@ -0,0 +1,41 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace myopengl {
+
+	// Hilos de trabajo persistentes con una cola FIFO de tareas
+	class ThreadPool {
+	public:
+		// threads = 0 usa hardware_concurrency() - 1 (el hilo principal también trabaja en parallelFor)
+		explicit ThreadPool(unsigned threads = 0);
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void submit(std::function<void()> task);
+
+		// Reparte [0, count) en bloques de al menos minBatch elementos y espera a que
+		// terminen todos. Con pocos elementos se ejecuta directamente en el hilo llamante.
+		void parallelFor(size_t count, size_t minBatch, const std::function<void(size_t begin, size_t end)>& body);
+
+		unsigned size() const { return (unsigned)m_Workers.size(); }
+
+		// Pool compartido por los sistemas que no necesitan uno propio
+		static ThreadPool& shared();
+
+	private:
+		void workerLoop();
+
+		std::vector<std::thread> m_Workers;
+		std::deque<std::function<void()>> m_Tasks;
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_Stopping = false;
+	};
+
+}
@@ -0,0 +1,152 @@
+#include "transforms.hpp"
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TRANSFORMS_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORMS_SSE
+#endif
+
+namespace myopengl {
+
+	void TransformSystem::resize(size_t count)
+	{
+		std::vector<float>* arrays[] = {
+			&m_PositionX, &m_PositionY, &m_PositionZ,
+			&m_ScaleX, &m_ScaleY, &m_ScaleZ,
+			&m_CosYaw, &m_SinYaw
+		};
+		for (std::vector<float>* array : arrays)
+			array->resize(count);
+		for (std::vector<float>& row : m_Rows)
+			row.resize(count);
+	}
+
+	void TransformSystem::set(size_t index, const glm::vec3& position, const glm::vec3& scale, float yaw)
+	{
+		m_PositionX[index] = position.x;
+		m_PositionY[index] = position.y;
+		m_PositionZ[index] = position.z;
+		m_ScaleX[index] = scale.x;
+		m_ScaleY[index] = scale.y;
+		m_ScaleZ[index] = scale.z;
+		// El seno y coseno propios se guardan ya calculados; el ángulo común se suma
+		// con cos(a + b) y sin(a + b) sin llamar a funciones trigonométricas por objeto
+		m_CosYaw[index] = std::cos(yaw);
+		m_SinYaw[index] = std::sin(yaw);
+	}
+
+	void TransformSystem::update(float sharedAngle, ThreadPool* pool)
+	{
+		float cosAngle = std::cos(sharedAngle);
+		float sinAngle = std::sin(sharedAngle);
+
+		if (pool && size() >= ParallelThreshold) {
+			pool->parallelFor(size(), ParallelThreshold / 4, [&](size_t begin, size_t end) {
+				updateRange(cosAngle, sinAngle, begin, end);
+			});
+		}
+		else {
+			updateRange(cosAngle, sinAngle, 0, size());
+		}
+	}
+
+	// rotY(t) * S * T(p), con c = cos(t) y s = sin(t):
+	//   |  c*sx  0   s*sz   c*sx*px + s*sz*pz |
+	//   |  0     sy  0      sy*py             |
+	//   | -s*sx  0   c*sz  -s*sx*px + c*sz*pz |
+	void TransformSystem::updateRange(float cosAngle, float sinAngle, size_t begin, size_t end)
+	{
+		float* rows[12];
+		for (int r = 0; r < 12; r++)
+			rows[r] = m_Rows[r].data();
+
+		size_t i = begin;
+
+#if defined(TRANSFORMS_AVX) || defined(TRANSFORMS_SSE)
+#if defined(TRANSFORMS_AVX)
+		typedef __m256 Lanes;
+		const size_t Width = 8;
+		auto load = [](const float* p) { return _mm256_loadu_ps(p); };
+		auto store = [](float* p, Lanes v) { _mm256_storeu_ps(p, v); };
+		auto set1 = [](float v) { return _mm256_set1_ps(v); };
+		auto add = [](Lanes a, Lanes b) { return _mm256_add_ps(a, b); };
+		auto sub = [](Lanes a, Lanes b) { return _mm256_sub_ps(a, b); };
+		auto mul = [](Lanes a, Lanes b) { return _mm256_mul_ps(a, b); };
+#else
+		typedef __m128 Lanes;
+		const size_t Width = 4;
+		auto load = [](const float* p) { return _mm_loadu_ps(p); };
+		auto store = [](float* p, Lanes v) { _mm_storeu_ps(p, v); };
+		auto set1 = [](float v) { return _mm_set1_ps(v); };
+		auto add = [](Lanes a, Lanes b) { return _mm_add_ps(a, b); };
+		auto sub = [](Lanes a, Lanes b) { return _mm_sub_ps(a, b); };
+		auto mul = [](Lanes a, Lanes b) { return _mm_mul_ps(a, b); };
+#endif
+		Lanes cosShared = set1(cosAngle);
+		Lanes sinShared = set1(sinAngle);
+		Lanes zero = set1(0.0f);
+
+		for (; i + Width <= end; i += Width) {
+			Lanes cosYaw = load(&m_CosYaw[i]);
+			Lanes sinYaw = load(&m_SinYaw[i]);
+			Lanes c = sub(mul(cosYaw, cosShared), mul(sinYaw, sinShared));
+			Lanes s = add(mul(sinYaw, cosShared), mul(cosYaw, sinShared));
+
+			Lanes sx = load(&m_ScaleX[i]);
+			Lanes sy = load(&m_ScaleY[i]);
+			Lanes sz = load(&m_ScaleZ[i]);
+			Lanes px = mul(sx, load(&m_PositionX[i]));
+			Lanes py = mul(sy, load(&m_PositionY[i]));
+			Lanes pz = mul(sz, load(&m_PositionZ[i]));
+
+			store(rows[0] + i, mul(c, sx));
+			store(rows[1] + i, zero);
+			store(rows[2] + i, mul(s, sz));
+			store(rows[3] + i, add(mul(c, px), mul(s, pz)));
+			store(rows[4] + i, zero);
+			store(rows[5] + i, sy);
+			store(rows[6] + i, zero);
+			store(rows[7] + i, py);
+			store(rows[8] + i, sub(zero, mul(s, sx)));
+			store(rows[9] + i, zero);
+			store(rows[10] + i, mul(c, sz));
+			store(rows[11] + i, sub(mul(c, pz), mul(s, px)));
+		}
+#endif
+
+		for (; i < end; i++) {
+			float c = m_CosYaw[i] * cosAngle - m_SinYaw[i] * sinAngle;
+			float s = m_SinYaw[i] * cosAngle + m_CosYaw[i] * sinAngle;
+			float px = m_ScaleX[i] * m_PositionX[i];
+			float py = m_ScaleY[i] * m_PositionY[i];
+			float pz = m_ScaleZ[i] * m_PositionZ[i];
+
+			rows[0][i] = c * m_ScaleX[i];
+			rows[1][i] = 0.0f;
+			rows[2][i] = s * m_ScaleZ[i];
+			rows[3][i] = c * px + s * pz;
+			rows[4][i] = 0.0f;
+			rows[5][i] = m_ScaleY[i];
+			rows[6][i] = 0.0f;
+			rows[7][i] = py;
+			rows[8][i] = -s * m_ScaleX[i];
+			rows[9][i] = 0.0f;
+			rows[10][i] = c * m_ScaleZ[i];
+			rows[11][i] = c * pz - s * px;
+		}
+	}
+
+	glm::mat4 TransformSystem::model(size_t index) const
+	{
+		// glm guarda columnas; la cuarta fila de una afín es (0, 0, 0, 1)
+		glm::mat4 result;
+		for (int c = 0; c < 4; c++) {
+			result[c] = glm::vec4(m_Rows[c][index], m_Rows[4 + c][index], m_Rows[8 + c][index], c == 3 ? 1.0f : 0.0f);
+		}
+		return result;
+	}
+
+}
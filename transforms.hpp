@@ -0,0 +1,44 @@
+#pragma once
+#include "threadpool.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace myopengl {
+
+	// Transformaciones de todos los objetos en SoA. La matriz de modelo se compone igual
+	// que en la escena original, rotY(yaw + ángulo común) * escala * traslación, pero
+	// directamente como afín 3x4 y en lotes SIMD, sin multiplicar matrices 4x4.
+	class TransformSystem {
+	public:
+		// A partir de este número de objetos update() reparte el trabajo entre hilos
+		static const size_t ParallelThreshold = 16384;
+
+		void resize(size_t count);
+		size_t size() const { return m_PositionX.size(); }
+
+		// yaw es una rotación propia del objeto alrededor de Y, sumada al ángulo común
+		void set(size_t index, const glm::vec3& position, const glm::vec3& scale, float yaw = 0.0f);
+
+		// Recalcula todas las matrices para el ángulo común de este frame. Sin pool
+		// (o con pocos objetos) se hace en el hilo llamante.
+		void update(float sharedAngle, ThreadPool* pool = nullptr);
+
+		// Matriz 4x4 de un objeto a partir de sus filas 3x4
+		glm::mat4 model(size_t index) const;
+		// Columna de traslación: el centro del objeto en mundo
+		glm::vec3 translation(size_t index) const
+		{
+			return glm::vec3(m_Rows[3][index], m_Rows[7][index], m_Rows[11][index]);
+		}
+
+	private:
+		void updateRange(float cosAngle, float sinAngle, size_t begin, size_t end);
+
+		std::vector<float> m_PositionX, m_PositionY, m_PositionZ;
+		std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+		std::vector<float> m_CosYaw, m_SinYaw;
+		// Fila r, columna c de la 3x4 en m_Rows[r * 4 + c]
+		std::vector<float> m_Rows[12];
+	};
+
+}